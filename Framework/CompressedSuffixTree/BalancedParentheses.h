@@ -0,0 +1,211 @@
+#pragma once
+
+#include <vector>
+#include <array>
+#include <limits>
+#include <cstdint>
+
+#include "BitVector.h"
+
+namespace CompressedSuffixTree {
+    /**
+     * For every byte, the minimum excess of its prefixes (of at least one bit) and its total excess.
+     */
+    struct ByteExcess {
+        std::array<int8_t, 256> minimum;
+        std::array<int8_t, 256> total;
+    };
+
+    inline constexpr ByteExcess computeByteExcess() noexcept {
+        ByteExcess result{};
+        for (int byte = 0; byte < 256; byte++) {
+            int excess = 0;
+            int minimum = std::numeric_limits<int>::max();
+            for (int bit = 0; bit < 8; bit++) {
+                excess += ((byte >> bit) & 1) ? 1 : -1;
+                minimum = std::min(minimum, excess);
+            }
+            result.minimum[byte] = minimum;
+            result.total[byte] = excess;
+        }
+        return result;
+    }
+
+    inline constexpr ByteExcess ByteExcessTable = computeByteExcess();
+
+    /**
+     * The topology of an ordinal tree as balanced parentheses: Every node is an opening parenthesis (1), followed by
+     * its subtrees and a closing parenthesis (0). A node is identified by the position of its opening parenthesis, so
+     * the nodes are numbered in preorder. Following
+     *      - Munro, Raman: Succinct representation of balanced parentheses and static trees (2001)
+     *      - Navarro, Sadakane: Fully functional static and dynamic succinct trees (2014) (range min-max tree)
+     *
+     * Besides rank of ones, rank of the pattern 10 counts the leaves before a position: A leaf is the only node
+     * whose opening parenthesis is directly closed.
+     *
+     * findClose searches for the first position after v at which the excess (ones minus zeros) drops below the one before v.
+     * The minimum excess of every block of 512 bits is stored in a complete binary tree, so the search skips whole subtrees
+     * of blocks in O(log n) and only scans the bytes of the first and the last block.
+     */
+    class BalancedParentheses {
+        static constexpr size_t BlockBits = BitVector::BitsPerBlock;
+
+    public:
+        BalancedParentheses() = default;
+
+        inline void open() noexcept {
+            bits.pushBack(true);
+        }
+
+        inline void close() noexcept {
+            bits.pushBack(false);
+        }
+
+        /**
+         * Computes the rank directories and the min-excess tree, must be called after the last parenthesis.
+         */
+        inline void build() noexcept {
+            bits.build();
+            const size_t numberOfWords = bits.words.size();
+            leafBlockRanks.assign(numberOfWords / BitVector::WordsPerBlock + 1, 0);
+            size_t leaves = 0;
+            for (size_t word = 0; word < numberOfWords; word++) {
+                if (word % BitVector::WordsPerBlock == 0) leafBlockRanks[word / BitVector::WordsPerBlock] = leaves;
+                leaves += std::popcount(leafPatterns(word));
+            }
+            if (numberOfWords % BitVector::WordsPerBlock == 0) leafBlockRanks.back() = leaves;
+
+            const size_t numberOfBlocks = (size() + BlockBits - 1) / BlockBits;
+            firstLeaf = 1;
+            while (firstLeaf < numberOfBlocks) firstLeaf *= 2;
+            minExcess.assign(2 * firstLeaf, std::numeric_limits<int>::max());
+            int excess = 0;
+            for (size_t i = 0; i < size(); i++) {
+                excess += bits.get(i) ? 1 : -1;
+                int& minimum = minExcess[firstLeaf + i / BlockBits];
+                minimum = std::min(minimum, excess);
+            }
+            for (size_t i = firstLeaf - 1; i > 0; i--) {
+                minExcess[i] = std::min(minExcess[2 * i], minExcess[2 * i + 1]);
+            }
+        }
+
+        inline bool isOpen(size_t i) const noexcept {
+            return bits.get(i);
+        }
+
+        /**
+         * A node is a leaf if it has no children, i.e., its parenthesis is closed right away.
+         */
+        inline bool isLeaf(size_t v) const noexcept {
+            return !bits.get(v + 1);
+        }
+
+        /**
+         * The number of ones minus the number of zeros in [0, i), i.e., the depth of the nodes that are open at i.
+         */
+        inline int excess(size_t i) const noexcept {
+            return 2 * static_cast<int64_t>(bits.rank1(i)) - static_cast<int64_t>(i);
+        }
+
+        /**
+         * The number of opening parentheses in [0, i).
+         */
+        inline size_t rank1(size_t i) const noexcept {
+            return bits.rank1(i);
+        }
+
+        /**
+         * The number of leaves that start in [0, i).
+         */
+        inline size_t leafRank(size_t i) const noexcept {
+            const size_t word = i / 64;
+            size_t result = leafBlockRanks[word / BitVector::WordsPerBlock];
+            for (size_t w = word - word % BitVector::WordsPerBlock; w < word; w++) {
+                result += std::popcount(leafPatterns(w));
+            }
+            if (i % 64 != 0) result += std::popcount(leafPatterns(word) & ((uint64_t(1) << (i % 64)) - 1));
+            return result;
+        }
+
+        /**
+         * The position of the parenthesis that closes the one at v.
+         */
+        inline size_t findClose(size_t v) const noexcept {
+            //The excess after the closing parenthesis is the excess before v.
+            const int target = excess(v);
+            int current = target + 1;
+            size_t position = v + 1;
+            //Scan the rest of the block of v.
+            const size_t blockEnd = std::min(size(), (v / BlockBits + 1) * BlockBits);
+            if (scan(position, blockEnd, current, target)) return position;
+            //The first block after it whose minimum reaches the target.
+            size_t node = firstLeaf + v / BlockBits;
+            while (true) {
+                if (node % 2 == 0 && minExcess[node + 1] <= target) {
+                    node++;
+                    break;
+                }
+                node /= 2;
+            }
+            while (node < firstLeaf) {
+                node = (minExcess[2 * node] <= target) ? 2 * node : 2 * node + 1;
+            }
+            position = (node - firstLeaf) * BlockBits;
+            current = excess(position);
+            scan(position, std::min(size(), position + BlockBits), current, target);
+            return position;
+        }
+
+        inline size_t size() const noexcept {
+            return bits.size();
+        }
+
+        inline size_t memoryUsage() const noexcept {
+            return bits.memoryUsage() + leafBlockRanks.capacity() * sizeof(uint64_t) + minExcess.capacity() * sizeof(int);
+        }
+
+    private:
+        /**
+         * The bits of word w at which the pattern 10 starts (the second bit may be in the next word).
+         */
+        inline uint64_t leafPatterns(size_t w) const noexcept {
+            const uint64_t word = bits.words[w];
+            const uint64_t next = (w + 1 < bits.words.size()) ? bits.words[w + 1] : 0;
+            return word & ~((word >> 1) | (next << 63));
+        }
+
+        /**
+         * Advances position (and the excess before it, current) until the excess after position is target or end is reached.
+         * Returns true if the target was found.
+         */
+        inline bool scan(size_t& position, const size_t end, int& current, const int target) const noexcept {
+            //Bit by bit up to the next byte boundary, then byte by byte.
+            while (position < end && position % 8 != 0) {
+                current += bits.get(position) ? 1 : -1;
+                if (current == target) return true;
+                position++;
+            }
+            while (position + 8 <= end) {
+                const uint8_t byte = bits.words[position / 64] >> (position % 64);
+                if (current + ByteExcessTable.minimum[byte] <= target) break;
+                current += ByteExcessTable.total[byte];
+                position += 8;
+            }
+            while (position < end) {
+                current += bits.get(position) ? 1 : -1;
+                if (current == target) return true;
+                position++;
+            }
+            return false;
+        }
+
+    private:
+        BitVector bits;
+        //leafBlockRanks[b] is the number of leaves that start before block b
+        std::vector<uint64_t> leafBlockRanks;
+        //The minimum excess of every block in the leaves of a complete binary tree, the inner nodes hold the minimum of their children
+        std::vector<int> minExcess;
+        size_t firstLeaf = 1;
+    };
+}
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstddef>
+
+namespace CompressedSuffixTree {
+    /**
+     * A static bit vector with constant-time rank, following the usual two-level scheme
+     *      - Jacobson: Space-efficient static trees and graphs (1989)
+     *
+     * For every block of 512 bits (8 words), the number of ones before it and the number of ones before each of its words
+     * (relative to the block, 9 bits each, packed into one word) are stored, so rank needs a single popcount.
+     * That adds 25% to the bits. Bits are appended during the construction, build() computes the directory afterwards.
+     */
+    class BitVector {
+    public:
+        static constexpr size_t WordsPerBlock = 8;
+        static constexpr size_t BitsPerBlock = 64 * WordsPerBlock;
+
+        BitVector() = default;
+
+        explicit BitVector(size_t size) :
+                words((size + 63) / 64, 0),
+                length(size) {
+        }
+
+        inline void pushBack(bool bit) noexcept {
+            if (length % 64 == 0) words.emplace_back(0);
+            if (bit) words.back() |= uint64_t(1) << (length % 64);
+            length++;
+        }
+
+        inline void set(size_t i) noexcept {
+            words[i / 64] |= uint64_t(1) << (i % 64);
+        }
+
+        inline bool get(size_t i) const noexcept {
+            return (words[i / 64] >> (i % 64)) & 1;
+        }
+
+        /**
+         * Computes the rank directory, must be called after the last bit was set.
+         */
+        inline void build() noexcept {
+            words.shrink_to_fit();
+            blockRanks.assign(words.size() / WordsPerBlock + 1, 0);
+            wordRanks.assign(words.size() / WordsPerBlock + 1, 0);
+            size_t ones = 0;
+            for (size_t word = 0; word < words.size(); word++) {
+                const size_t block = word / WordsPerBlock;
+                if (word % WordsPerBlock == 0) {
+                    blockRanks[block] = ones;
+                } else {
+                    wordRanks[block] |= (ones - blockRanks[block]) << (9 * (word % WordsPerBlock - 1));
+                }
+                ones += std::popcount(words[word]);
+            }
+            //rank1(size()) reads the entry of the word after the last one, if size() is a multiple of 64.
+            const size_t end = words.size();
+            if (end % WordsPerBlock == 0) {
+                blockRanks[end / WordsPerBlock] = ones;
+            } else {
+                wordRanks[end / WordsPerBlock] |= (ones - blockRanks[end / WordsPerBlock]) << (9 * (end % WordsPerBlock - 1));
+            }
+        }
+
+        /**
+         * The number of ones in [0, i).
+         */
+        inline size_t rank1(size_t i) const noexcept {
+            const size_t word = i / 64;
+            const size_t block = word / WordsPerBlock;
+            const size_t wordInBlock = word % WordsPerBlock;
+            size_t result = blockRanks[block];
+            if (wordInBlock != 0) result += (wordRanks[block] >> (9 * (wordInBlock - 1))) & 0x1FF;
+            if (i % 64 != 0) result += std::popcount(words[word] & ((uint64_t(1) << (i % 64)) - 1));
+            return result;
+        }
+
+        inline size_t rank0(size_t i) const noexcept {
+            return i - rank1(i);
+        }
+
+        inline size_t size() const noexcept {
+            return length;
+        }
+
+        inline size_t memoryUsage() const noexcept {
+            return words.capacity() * sizeof(uint64_t) + blockRanks.capacity() * sizeof(uint64_t) + wordRanks.capacity() * sizeof(uint64_t);
+        }
+
+    public:
+        std::vector<uint64_t> words;
+
+    private:
+        size_t length = 0;
+        //blockRanks[b] is the number of ones before block b
+        std::vector<uint64_t> blockRanks;
+        //The number of ones before word w + 1 of block b, relative to the block, in bits 9w..9w+8 of wordRanks[b]
+        std::vector<uint64_t> wordRanks;
+    };
+
+    /**
+     * An array of unsigned integers with a fixed number of bits per entry, e.g., the string depths of the inner nodes
+     * with just as many bits as the deepest one needs.
+     */
+    class IntVector {
+    public:
+        IntVector() = default;
+
+        IntVector(size_t size, uint64_t maxValue) :
+                width(std::max<int>(1, std::bit_width(maxValue))),
+                words((size * width + 63) / 64 + 1, 0),
+                length(size) {
+        }
+
+        inline void set(size_t i, uint64_t value) noexcept {
+            const size_t bit = i * width;
+            const size_t word = bit / 64;
+            const size_t offset = bit % 64;
+            const uint64_t mask = (width == 64) ? ~uint64_t(0) : (uint64_t(1) << width) - 1;
+            words[word] = (words[word] & ~(mask << offset)) | (value << offset);
+            if (offset + width > 64) {
+                words[word + 1] = (words[word + 1] & ~(mask >> (64 - offset))) | (value >> (64 - offset));
+            }
+        }
+
+        inline uint64_t get(size_t i) const noexcept {
+            const size_t bit = i * width;
+            const size_t word = bit / 64;
+            const size_t offset = bit % 64;
+            const uint64_t mask = (width == 64) ? ~uint64_t(0) : (uint64_t(1) << width) - 1;
+            uint64_t value = words[word] >> offset;
+            if (offset + width > 64) value |= words[word + 1] << (64 - offset);
+            return value & mask;
+        }
+
+        inline size_t size() const noexcept {
+            return length;
+        }
+
+        inline size_t memoryUsage() const noexcept {
+            return words.capacity() * sizeof(uint64_t);
+        }
+
+    private:
+        int width = 1;
+        std::vector<uint64_t> words;
+        size_t length = 0;
+    };
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <array>
+#include <cstdint>
+
+#include "BitVector.h"
+#include "WaveletMatrix.h"
+#include "../SuffixArray/SuffixArray.h"
+
+namespace CompressedSuffixTree {
+    /**
+     * A compressed suffix array: The Burrows-Wheeler transform of the text in a wavelet matrix and every sampleRate-th
+     * entry of the suffix array and its inverse, following
+     *      - Ferragina, Manzini: Opportunistic data structures with applications (2000)
+     *      - Navarro, Mäkinen: Compressed full-text indexes (2007)
+     *
+     * The LF mapping LF(i) = C[bwt[i]] + rank(bwt[i], i) moves from the suffix at rank i to the one that starts one position earlier.
+     * The entries of the suffix array are sampled at the text positions that are multiples of sampleRate, so sa(i) and isa(j) take at most
+     * sampleRate LF steps (each with ceil(log sigma) rank operations). Backward search (extendLeft) needs no samples at all.
+     *
+     * The sentinel is unique, so the order of the suffixes is the order of the rotations of the text, which is what LF relies on.
+     * It does not have to be the smallest character.
+     */
+    template<typename CHAR_TYPE, bool DEBUG = false>
+    class CompressedSuffixArray {
+        using CharType = CHAR_TYPE;
+        static const bool Debug = DEBUG;
+
+    public:
+        CompressedSuffixArray() = default;
+
+        /**
+         * Compresses the given suffix array, lastRank is the rank of the last suffix (the inverse suffix array is not needed).
+         */
+        CompressedSuffixArray(const SuffixArray::SuffixArray<CharType, Debug>& suffixArray, int sampleRate, size_t lastRank) :
+                n(suffixArray.n),
+                sampleRate(sampleRate),
+                lastRank(lastRank) {
+            //Map the characters to [0, sigma) in the order of the suffix array.
+            std::vector<size_t> count(256, 0);
+            for (int i = 0; i < n; i++) {
+                count[SuffixTree::orderedByte(suffixArray.text[i])]++;
+            }
+            int sigma = 0;
+            for (int c = 0; c < 256; c++) {
+                if (count[c] == 0) continue;
+                symbolOf[c] = sigma;
+                symbolsBefore.emplace_back(0);
+                sigma++;
+            }
+            size_t before = 0;
+            for (int c = 0; c < 256; c++) {
+                if (count[c] == 0) continue;
+                symbolsBefore[symbolOf[c]] = before;
+                before += count[c];
+            }
+
+            //bwt[i] is the character before suffix sa[i] (cyclically).
+            std::vector<uint8_t> bwt(n);
+            sampled = BitVector(n);
+            for (int i = 0; i < n; i++) {
+                const int suffix = suffixArray.sa[i];
+                bwt[i] = symbolOf[SuffixTree::orderedByte(suffixArray.text[(suffix == 0) ? n - 1 : suffix - 1])];
+                if (suffix % sampleRate == 0) sampled.set(i);
+            }
+            sampled.build();
+            wavelet = WaveletMatrix(bwt, sigma);
+            std::vector<uint8_t>().swap(bwt);
+
+            saSamples = IntVector((n - 1) / sampleRate + 1, n);
+            isaSamples = IntVector((n - 1) / sampleRate + 1, n);
+            for (int i = 0; i < n; i++) {
+                const int suffix = suffixArray.sa[i];
+                if (suffix % sampleRate != 0) continue;
+                saSamples.set(sampled.rank1(i), suffix);
+                isaSamples.set(suffix / sampleRate, i);
+            }
+        }
+
+        /**
+         * The rank of the suffix that starts one position before sa(i) (the last one for sa(i) = 0).
+         */
+        inline size_t lf(size_t i) const noexcept {
+            size_t rank;
+            const uint8_t symbol = wavelet.accessAndRank(i, rank);
+            return symbolsBefore[symbol] + rank;
+        }
+
+        /**
+         * Narrows the ranks [begin, end) of the suffixes that start with a string P to the ones that start with cP (backward search).
+         */
+        inline void extendLeft(CharType c, size_t& begin, size_t& end) const noexcept {
+            const uint8_t symbol = symbolOf[SuffixTree::orderedByte(c)];
+            begin = symbolsBefore[symbol] + wavelet.rank(symbol, begin);
+            end = symbolsBefore[symbol] + wavelet.rank(symbol, end);
+        }
+
+        /**
+         * The start of the suffix with rank i.
+         */
+        inline int sa(size_t i) const noexcept {
+            int steps = 0;
+            while (!sampled.get(i)) {
+                i = lf(i);
+                steps++;
+            }
+            return saSamples.get(sampled.rank1(i)) + steps;
+        }
+
+        /**
+         * The rank of the suffix that starts at position j.
+         */
+        inline size_t isa(int j) const noexcept {
+            //Start at the next sampled position (or the last one, whose rank is known) and walk back to j.
+            int position = ((j + sampleRate - 1) / sampleRate) * sampleRate;
+            size_t rank;
+            if (position >= n) {
+                position = n - 1;
+                rank = lastRank;
+            } else {
+                rank = isaSamples.get(position / sampleRate);
+            }
+            for (; position > j; position--) {
+                rank = lf(rank);
+            }
+            return rank;
+        }
+
+        inline size_t memoryUsage() const noexcept {
+            return wavelet.memoryUsage() + sampled.memoryUsage() + saSamples.memoryUsage() + isaSamples.memoryUsage() + symbolsBefore.capacity() * sizeof(size_t) + sizeof(symbolOf);
+        }
+
+    public:
+        //Text length, including the sentinel
+        int n = 0;
+        //Every sampleRate-th text position is sampled
+        int sampleRate = 1;
+
+    private:
+        //The rank of the last suffix, the sentinel
+        size_t lastRank = 0;
+        WaveletMatrix wavelet;
+        //The symbol in the wavelet matrix of every character (by orderedByte)
+        std::array<uint8_t, 256> symbolOf{};
+        //symbolsBefore[c] is the number of characters in the text that are smaller than c
+        std::vector<size_t> symbolsBefore;
+        //The ranks whose suffix starts at a multiple of sampleRate
+        BitVector sampled;
+        //The sampled suffix array entries in the order of their ranks
+        IntVector saSamples;
+        //isaSamples[k] is the rank of the suffix k * sampleRate
+        IntVector isaSamples;
+    };
+}
@@ -0,0 +1,220 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <limits>
+#include <cstdint>
+
+#include "BitVector.h"
+#include "BalancedParentheses.h"
+#include "CompressedSuffixArray.h"
+#include "../SuffixArray/SuffixArray.h"
+
+namespace CompressedSuffixTree {
+    /**
+     * A node of the compressed suffix tree: the position of its opening parenthesis.
+     */
+    using NodeIndex = size_t;
+    static constexpr NodeIndex NoNode = std::numeric_limits<NodeIndex>::max();
+
+    /**
+     * A compressed suffix tree for memory-bound inputs, following
+     *      - Sadakane: Compressed suffix trees with full functionality (2007)
+     *      - Ohlebusch, Fischer, Gog: CST++ (2010)
+     *
+     * It consists of
+     *  - the topology of the suffix tree as balanced parentheses (BalancedParentheses.h), 2 bits per node. The nodes are the lcp-intervals
+     *    of the suffix array and its leaves, the children are in lexicographic order as in the other trees.
+     *  - the string depths of the inner nodes in preorder, bit-packed with as many bits as the largest one needs.
+     *  - a compressed suffix array (CompressedSuffixArray.h) for the start positions of the leaves and the inverse.
+     * With the default sample rate, this is about 2-4 bytes per character, the suffix tree needs ~60 and the lcp-interval tree ~30.
+     *
+     * The text is not part of the index, it is only accessed to print the results (like in the other trees).
+     * The construction builds the (uncompressed) suffix array first and releases it afterwards, so the peak memory of the construction
+     * is the one of SuffixArray.h; only the tree that the queries run on is compact.
+     */
+    template<typename CHAR_TYPE, bool DEBUG = false>
+    class CompressedSuffixTree {
+        using CharType = CHAR_TYPE;
+        static const bool Debug = DEBUG;
+
+    public:
+        static constexpr int DefaultSampleRate = 32;
+
+        CompressedSuffixTree(const CharType* input, int n, int sampleRate = DefaultSampleRate) :
+                text(input),
+                n(n) {
+            SuffixArray::SuffixArray<CharType, Debug> suffixArray(input, n);
+            //Only the suffix array and the LCP array are needed from here on, release the rest as early as possible.
+            const int lastRank = suffixArray.inverseSa[n - 1];
+            std::vector<int>().swap(suffixArray.inverseSa);
+            buildTopology(suffixArray.lcp);
+            std::vector<int>().swap(suffixArray.lcp);
+            csa = CompressedSuffixArray<CharType, Debug>(suffixArray, sampleRate, lastRank);
+            if constexpr (Debug) print();
+        }
+
+        /**
+         * The nodes are the lcp-intervals of the LCP array, found with the same bottom-up traversal as in LcpIntervalTree::build.
+         * In preorder, the opening parentheses of all intervals with left bound i are directly before leaf i (outermost first) and
+         * the closing parentheses of all intervals with right bound i are directly after it.
+         *
+         * To keep the temporary memory at one integer per character, the traversal runs three times:
+         *  1. Count the intervals per left bound, so that groupStart[i] is the preorder number of the first interval with left bound i.
+         *  2. Store the string depths in preorder. The intervals are closed innermost first, so each group is filled from its end.
+         *     Afterwards, the groups start at groupStart[i] again.
+         *  3. Write the parentheses: the opening ones from the group sizes, the closing ones as the intervals are closed.
+         */
+        inline void buildTopology(const std::vector<int>& lcpArray) noexcept {
+            std::vector<int> groupStart(n + 1, 0);
+            int maxLcp = 0;
+            forEachInterval(lcpArray, [&](int, int lcp, int leftBound) {
+                groupStart[leftBound + 1]++;
+                maxLcp = std::max(maxLcp, lcp);
+            });
+            for (int i = 0; i < n; i++) {
+                groupStart[i + 1] += groupStart[i];
+            }
+            innerNodeDepths = IntVector(groupStart[n], maxLcp);
+            for (int i = 0; i < n; i++) {
+                groupStart[i] = groupStart[i + 1];
+            }
+            forEachInterval(lcpArray, [&](int, int lcp, int leftBound) {
+                innerNodeDepths.set(--groupStart[leftBound], lcp);
+            });
+            int lastLeaf = -1;
+            forEachInterval(lcpArray, [&](int rightBound, int, int) {
+                //The leaves up to the right bound come first, each after the opening parentheses of its group.
+                for (; lastLeaf < rightBound; lastLeaf++) {
+                    for (int open = groupStart[lastLeaf + 1]; open < groupStart[lastLeaf + 2]; open++) {
+                        topology.open();
+                    }
+                    topology.open();
+                    topology.close();
+                }
+                topology.close();
+            });
+            topology.build();
+        }
+
+        /**
+         * The bottom-up traversal of LcpIntervalTree::build, calls function(rightBound, lcp, leftBound) for every interval when it is closed.
+         */
+        template<typename FUNCTION>
+        inline void forEachInterval(const std::vector<int>& lcpArray, const FUNCTION& function) const noexcept {
+            struct OpenInterval {
+                int lcp;
+                int leftBound;
+            };
+            std::vector<OpenInterval> stack;
+            stack.emplace_back(0, 0);
+            for (int i = 0; i < n; i++) {
+                const int lcp = (i + 1 < n) ? lcpArray[i + 1] : -1;
+                int lastLeftBound = i;
+                while (!stack.empty() && lcp < stack.back().lcp) {
+                    const OpenInterval interval = stack.back();
+                    stack.pop_back();
+                    function(i, interval.lcp, interval.leftBound);
+                    lastLeftBound = interval.leftBound;
+                }
+                if (!stack.empty() && lcp > stack.back().lcp) {
+                    stack.emplace_back(lcp, lastLeftBound);
+                }
+            }
+        }
+
+        inline NodeIndex root() const noexcept {
+            return 0;
+        }
+
+        inline bool isLeaf(NodeIndex node) const noexcept {
+            return topology.isLeaf(node);
+        }
+
+        /**
+         * The children in lexicographic order: firstChild, then nextSibling until NoNode.
+         */
+        inline NodeIndex firstChild(NodeIndex node) const noexcept {
+            return isLeaf(node) ? NoNode : node + 1;
+        }
+
+        inline NodeIndex nextSibling(NodeIndex node) const noexcept {
+            const NodeIndex next = (isLeaf(node) ? node + 1 : topology.findClose(node)) + 1;
+            return (next < topology.size() && topology.isOpen(next)) ? next : NoNode;
+        }
+
+        /**
+         * The rank of the first suffix below the node, i.e., the left bound of its lcp-interval.
+         */
+        inline int leftBound(NodeIndex node) const noexcept {
+            return topology.leafRank(node);
+        }
+
+        /**
+         * The number of leaves below the given node, i.e., the number of occurrences of its string.
+         */
+        inline int numberOfLeaves(NodeIndex node) const noexcept {
+            if (isLeaf(node)) return 1;
+            return topology.leafRank(topology.findClose(node)) - topology.leafRank(node);
+        }
+
+        /**
+         * The string depth of an inner node, the lcp of its interval.
+         */
+        inline int innerNodeDepth(NodeIndex node) const noexcept {
+            return innerNodeDepths.get(topology.rank1(node) - topology.leafRank(node));
+        }
+
+        inline int stringDepth(NodeIndex node) const noexcept {
+            if (isLeaf(node)) return n - csa.sa(leftBound(node));
+            return innerNodeDepth(node);
+        }
+
+        /**
+         * A suffix that starts with the string of the given node.
+         */
+        inline int representedSuffix(NodeIndex node) const noexcept {
+            return csa.sa(leftBound(node));
+        }
+
+        inline size_t numberOfNodes() const noexcept {
+            return topology.size() / 2;
+        }
+
+        /**
+         * Returns the substring of the input text with length length starting at startIndex.
+         */
+        inline std::string substring(size_t startIndex, size_t length) const noexcept {
+            return std::string(text + startIndex, length);
+        }
+
+        /**
+         * The memory used by the index in bytes, the text is not counted.
+         */
+        inline size_t memoryUsage() const noexcept {
+            return topology.memoryUsage() + innerNodeDepths.memoryUsage() + csa.memoryUsage();
+        }
+
+        /**
+         * Prints all nodes in preorder with their string depths and intervals. Used for debugging.
+         */
+        inline void print() const noexcept {
+            for (NodeIndex node = 0; node < topology.size(); node++) {
+                if (!topology.isOpen(node)) continue;
+                std::cout << "Node " << node << ": depth=" << stringDepth(node) << " [" << leftBound(node) << ", " << leftBound(node) + numberOfLeaves(node) - 1 << "]"
+                          << (isLeaf(node) ? " leaf(" + std::to_string(csa.sa(leftBound(node))) + ")" : "") << std::endl;
+            }
+        }
+
+    public:
+        //The input text
+        const CharType* text;
+        //Input length
+        int n;
+        BalancedParentheses topology;
+        //The string depths of the inner nodes in preorder
+        IntVector innerNodeDepths;
+        CompressedSuffixArray<CharType, Debug> csa;
+    };
+}
@@ -0,0 +1,206 @@
+#pragma once
+
+#include <vector>
+#include <bit>
+#include <algorithm>
+#include <cstdint>
+
+#include "BitVector.h"
+
+namespace CompressedSuffixTree {
+    /**
+     * A sequence over the alphabet [0, sigma) in ceil(log sigma) bit vectors, following
+     *      - Claude, Navarro, Ordóñez: The wavelet matrix (2015)
+     *
+     * Level l stores the l-th highest bit of every symbol, in the order that results from stably partitioning the sequence
+     * by the higher bits (zeros first). After the last level, all occurrences of a symbol are contiguous and in their original order,
+     * so the rank of the symbol at position i is its final position minus the start of the symbol's range.
+     * That gives the symbol and its rank with one rank operation per level, which is exactly what the LF mapping needs.
+     * The rank of a given symbol follows its bits in the same way.
+     */
+    class WaveletMatrix {
+    public:
+        WaveletMatrix() = default;
+
+        WaveletMatrix(const std::vector<uint8_t>& sequence, int sigma) :
+                levels(std::max<int>(1, std::bit_width(static_cast<unsigned>(sigma - 1)))),
+                bits(levels),
+                zeros(levels),
+                symbolStart(sigma, 0) {
+            std::vector<uint8_t> current(sequence);
+            std::vector<uint8_t> next(sequence.size());
+            for (int level = 0; level < levels; level++) {
+                const int shift = levels - 1 - level;
+                bits[level] = BitVector(current.size());
+                size_t zeroCount = 0;
+                for (size_t i = 0; i < current.size(); i++) {
+                    if ((current[i] >> shift) & 1) {
+                        bits[level].set(i);
+                    } else {
+                        zeroCount++;
+                    }
+                }
+                bits[level].build();
+                zeros[level] = zeroCount;
+                size_t zeroPosition = 0;
+                size_t onePosition = zeroCount;
+                for (size_t i = 0; i < current.size(); i++) {
+                    if ((current[i] >> shift) & 1) {
+                        next[onePosition++] = current[i];
+                    } else {
+                        next[zeroPosition++] = current[i];
+                    }
+                }
+                current.swap(next);
+            }
+            //The symbols are sorted by their bit-reversed value after the last level, find the start of each range.
+            for (size_t i = current.size(); i > 0; i--) {
+                symbolStart[current[i - 1]] = i - 1;
+            }
+        }
+
+        /**
+         * Returns the symbol at position i and sets rank to the number of its occurrences in [0, i).
+         */
+        inline uint8_t accessAndRank(size_t i, size_t& rank) const noexcept {
+            uint8_t symbol = 0;
+            for (int level = 0; level < levels; level++) {
+                const BitVector& levelBits = bits[level];
+                if (levelBits.get(i)) {
+                    symbol = (symbol << 1) | 1;
+                    i = zeros[level] + levelBits.rank1(i);
+                } else {
+                    symbol = symbol << 1;
+                    i = levelBits.rank0(i);
+                }
+            }
+            rank = i - symbolStart[symbol];
+            return symbol;
+        }
+
+        /**
+         * The number of occurrences of symbol in [0, i).
+         */
+        inline size_t rank(uint8_t symbol, size_t i) const noexcept {
+            for (int level = 0; level < levels; level++) {
+                const BitVector& levelBits = bits[level];
+                if ((symbol >> (levels - 1 - level)) & 1) {
+                    i = zeros[level] + levelBits.rank1(i);
+                } else {
+                    i = levelBits.rank0(i);
+                }
+            }
+            return i - symbolStart[symbol];
+        }
+
+        inline size_t memoryUsage() const noexcept {
+            size_t result = zeros.capacity() * sizeof(size_t) + symbolStart.capacity() * sizeof(size_t);
+            for (const BitVector& levelBits : bits) {
+                result += levelBits.memoryUsage();
+            }
+            return result;
+        }
+
+    private:
+        int levels = 1;
+        std::vector<BitVector> bits;
+        //zeros[l] is the number of zeros on level l, the ones follow them on the next level
+        std::vector<size_t> zeros;
+        //The position of the first occurrence of each symbol after the last level
+        std::vector<size_t> symbolStart;
+    };
+
+    /**
+     * A sequence of integers in [0, 2^levels) as a wavelet matrix (see WaveletMatrix) without the symbol ranges,
+     * for alphabets as large as the sequence. It only counts: countLess(value, i) is the number of values < value in [0, i),
+     * with two rank operations per level.
+     */
+    class IntegerWaveletMatrix {
+    public:
+        IntegerWaveletMatrix() = default;
+
+        template<typename VALUE>
+        explicit IntegerWaveletMatrix(const std::vector<VALUE>& sequence) :
+                length(sequence.size()) {
+            //The values must not be negative.
+            uint64_t maxValue = 0;
+            for (const VALUE value : sequence) {
+                maxValue = std::max<uint64_t>(maxValue, value);
+            }
+            levels = std::max<int>(1, std::bit_width(maxValue));
+            bits.resize(levels);
+            zeros.resize(levels);
+            std::vector<VALUE> current(sequence);
+            std::vector<VALUE> next(sequence.size());
+            for (int level = 0; level < levels; level++) {
+                const int shift = levels - 1 - level;
+                bits[level] = BitVector(current.size());
+                size_t zeroCount = 0;
+                for (size_t i = 0; i < current.size(); i++) {
+                    if ((current[i] >> shift) & 1) {
+                        bits[level].set(i);
+                    } else {
+                        zeroCount++;
+                    }
+                }
+                bits[level].build();
+                zeros[level] = zeroCount;
+                size_t zeroPosition = 0;
+                size_t onePosition = zeroCount;
+                for (size_t i = 0; i < current.size(); i++) {
+                    if ((current[i] >> shift) & 1) {
+                        next[onePosition++] = current[i];
+                    } else {
+                        next[zeroPosition++] = current[i];
+                    }
+                }
+                current.swap(next);
+            }
+        }
+
+        /**
+         * The number of values < value in [0, i).
+         */
+        inline size_t countLess(uint64_t value, size_t i) const noexcept {
+            if (levels < 64 && (value >> levels) != 0) return i;
+            //The positions [begin, end) of the prefix on the current level, among the values whose higher bits equal those of value.
+            size_t begin = 0;
+            size_t end = i;
+            size_t result = 0;
+            for (int level = 0; level < levels; level++) {
+                const BitVector& levelBits = bits[level];
+                const size_t beginOnes = levelBits.rank1(begin);
+                const size_t endOnes = levelBits.rank1(end);
+                if ((value >> (levels - 1 - level)) & 1) {
+                    //The values with a zero here are smaller.
+                    result += (end - endOnes) - (begin - beginOnes);
+                    begin = zeros[level] + beginOnes;
+                    end = zeros[level] + endOnes;
+                } else {
+                    begin -= beginOnes;
+                    end -= endOnes;
+                }
+            }
+            return result;
+        }
+
+        inline size_t size() const noexcept {
+            return length;
+        }
+
+        inline size_t memoryUsage() const noexcept {
+            size_t result = zeros.capacity() * sizeof(size_t);
+            for (const BitVector& levelBits : bits) {
+                result += levelBits.memoryUsage();
+            }
+            return result;
+        }
+
+    private:
+        int levels = 1;
+        size_t length = 0;
+        std::vector<BitVector> bits;
+        //zeros[l] is the number of zeros on level l, the ones follow them on the next level
+        std::vector<size_t> zeros;
+    };
+}
@@ -0,0 +1,220 @@
+#pragma once
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+
+#include "Memory.h"
+
+namespace Helpers {
+    /**
+     * The running times of the repetitions of one benchmark in nanoseconds.
+     */
+    struct BenchmarkStatistics {
+        size_t repetitions = 0;
+        size_t warmup = 0;
+        double median = 0;
+        double min = 0;
+        double max = 0;
+        double mean = 0;
+        //Sample standard deviation, 0 for a single repetition
+        double stddev = 0;
+
+        BenchmarkStatistics() = default;
+
+        BenchmarkStatistics(std::vector<double> times, size_t warmup) :
+                repetitions(times.size()),
+                warmup(warmup) {
+            if (times.empty()) return;
+            std::sort(times.begin(), times.end());
+            const size_t middle = times.size() / 2;
+            median = (times.size() % 2 == 1) ? times[middle] : (times[middle - 1] + times[middle]) / 2;
+            min = times.front();
+            max = times.back();
+            for (const double time : times) mean += time;
+            mean /= times.size();
+            if (times.size() < 2) return;
+            double squares = 0;
+            for (const double time : times) squares += (time - mean) * (time - mean);
+            stddev = std::sqrt(squares / (times.size() - 1));
+        }
+    };
+
+    /**
+     * Runs run() warmup times without measuring it and then repetitions times, each measured on its own.
+     * setup() runs before every run() and is not measured, e.g., to initialize a query that run() consumes.
+     * The result of run() is kept in a volatile variable, so that the compiler cannot drop the measured work.
+     * The peaks of the memory accounting (Helpers/Memory.h) are reset before, so that afterwards they are the peaks of this benchmark.
+     */
+    template<typename SETUP, typename FUNCTION>
+    inline BenchmarkStatistics measure(size_t warmup, size_t repetitions, const SETUP& setup, const FUNCTION& run) {
+        [[maybe_unused]] static volatile size_t sink;
+        MemoryAccounting::resetPeaks();
+        for (size_t i = 0; i < warmup; i++) {
+            setup();
+            sink = static_cast<size_t>(run());
+        }
+        std::vector<double> times;
+        times.reserve(repetitions);
+        for (size_t i = 0; i < repetitions; i++) {
+            setup();
+            const auto start = std::chrono::steady_clock::now();
+            sink = static_cast<size_t>(run());
+            const auto end = std::chrono::steady_clock::now();
+            times.emplace_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+        }
+        return BenchmarkStatistics(std::move(times), warmup);
+    }
+
+    /**
+     * Same as above without a setup.
+     */
+    template<typename FUNCTION>
+    inline BenchmarkStatistics measure(size_t warmup, size_t repetitions, const FUNCTION& run) {
+        return measure(warmup, repetitions, []() {}, run);
+    }
+
+    /**
+     * Writes the results of the benchmarks, one record per measurement, in one of three formats:
+     *  - result: "RESULT key=value ..." lines like the experiments of main.cpp and the files in EvaluationResults/.
+     *    Besides the statistics in ns, the median is also given in ms under the key of the old experiments (e.g. queryTime),
+     *    so that the new lines can be compared with the old ones.
+     *  - csv: a header with the keys before the first record, then one line per record.
+     *  - json: one JSON object per line (JSON Lines), so that a file can be appended to.
+     * Every record also contains the peak RSS and the peak bytes of the accounted components during the measurement (see measure),
+     * so that memory regressions show up like time regressions.
+     * The records go to stdout or, with an output file, are appended to it (for tracking the results over time). The messages
+     * about the progress go to stdout only in the result format, otherwise to stderr, so that stdout can be piped into other tools.
+     */
+    class BenchmarkReport {
+    public:
+        using Fields = std::vector<std::pair<std::string, std::string>>;
+
+        BenchmarkReport(const std::string& format, const std::string& outputFileName, const std::string& label) :
+                format(format),
+                label(label),
+                headerWritten(false) {
+            if (outputFileName.empty()) return;
+            //A non-empty csv file already has its header.
+            std::ifstream existing(outputFileName);
+            headerWritten = existing.good() && existing.peek() != std::ifstream::traits_type::eof();
+            outputFile.open(outputFileName, std::ios::app);
+            if (!outputFile.is_open()) std::cout << "Could not open output file " << outputFileName << ", writing to stdout." << std::endl;
+        }
+
+        inline static bool isFormat(const std::string& format) noexcept {
+            return format == "result" || format == "csv" || format == "json";
+        }
+
+        /**
+         * The stream for messages about the progress.
+         */
+        inline std::ostream& log() const noexcept {
+            return (format == "result") ? std::cout : std::cerr;
+        }
+
+        /**
+         * Writes one record: the given fields (algo first), the statistics and the given fields after them (inputType, file).
+         * oldTimeKey is the key of the median in ms in the result format.
+         */
+        inline void add(const Fields& parameters, const BenchmarkStatistics& statistics, const std::string& oldTimeKey, const Fields& input) {
+            Fields fields(parameters);
+            if (format == "result") fields.emplace_back(oldTimeKey, std::to_string(static_cast<size_t>(statistics.median / 1000000)));
+            fields.emplace_back("medianTime", formatTime(statistics.median));
+            fields.emplace_back("minTime", formatTime(statistics.min));
+            fields.emplace_back("maxTime", formatTime(statistics.max));
+            fields.emplace_back("meanTime", formatTime(statistics.mean));
+            fields.emplace_back("stddevTime", formatTime(statistics.stddev));
+            fields.emplace_back("repetitions", std::to_string(statistics.repetitions));
+            fields.emplace_back("warmup", std::to_string(statistics.warmup));
+            for (const auto& field : MemoryAccounting::fields()) fields.push_back(field);
+            fields.insert(fields.end(), input.begin(), input.end());
+            fields.emplace_back("date", currentDate());
+            if (!label.empty()) fields.emplace_back("label", label);
+
+            std::ostream& output = outputFile.is_open() ? static_cast<std::ostream&>(outputFile) : std::cout;
+            if (format == "result") {
+                output << "RESULT";
+                for (const auto & [key, value] : fields) {
+                    output << " " << key << "=" << value;
+                    //The times carry their unit like the other experiments, except for the old key.
+                    if (key.ends_with("Time") && key != oldTimeKey) output << "ns";
+                }
+            } else if (format == "csv") {
+                if (!headerWritten) {
+                    for (size_t i = 0; i < fields.size(); i++) {
+                        output << (i == 0 ? "" : ",") << fields[i].first;
+                    }
+                    output << "\n";
+                    headerWritten = true;
+                }
+                for (size_t i = 0; i < fields.size(); i++) {
+                    output << (i == 0 ? "" : ",") << csvValue(fields[i].second);
+                }
+            } else {
+                output << "{";
+                for (size_t i = 0; i < fields.size(); i++) {
+                    output << (i == 0 ? "" : ",") << "\"" << fields[i].first << "\":" << jsonValue(fields[i].second);
+                }
+                output << "}";
+            }
+            output << std::endl;
+            //Show the progress when the records go to a file.
+            if (outputFile.is_open()) {
+                log() << "Measured";
+                for (const auto & [key, value] : parameters) log() << " " << key << "=" << value;
+                log() << " medianTime=" << formatTime(statistics.median) << "ns" << std::endl;
+            }
+        }
+
+    private:
+        inline static std::string formatTime(double nanoseconds) noexcept {
+            return std::to_string(static_cast<size_t>(std::llround(nanoseconds)));
+        }
+
+        inline static std::string currentDate() noexcept {
+            const std::time_t now = std::time(nullptr);
+            char buffer[32];
+            std::strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+            return buffer;
+        }
+
+        inline static bool isNumber(const std::string& value) noexcept {
+            return !value.empty() && std::all_of(value.begin(), value.end(), [](const char c) { return (c >= '0' && c <= '9') || c == '.'; })
+                   && std::count(value.begin(), value.end(), '.') <= 1 && value.front() != '.' && value.back() != '.';
+        }
+
+        inline static std::string csvValue(const std::string& value) noexcept {
+            if (value.find_first_of(",\"\n") == std::string::npos) return value;
+            std::string result = "\"";
+            for (const char c : value) {
+                if (c == '"') result += '"';
+                result += c;
+            }
+            return result + "\"";
+        }
+
+        inline static std::string jsonValue(const std::string& value) noexcept {
+            if (isNumber(value)) return value;
+            std::string result = "\"";
+            for (const char c : value) {
+                if (c == '"' || c == '\\') result += '\\';
+                result += c;
+            }
+            return result + "\"";
+        }
+
+    private:
+        std::string format;
+        //Free text that is added to every record, e.g., the commit that was measured
+        std::string label;
+        std::ofstream outputFile;
+        bool headerWritten;
+    };
+}
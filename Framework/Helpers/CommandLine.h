@@ -0,0 +1,114 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
+#include <iostream>
+
+namespace Helpers {
+    /**
+     * Optional command line arguments of the form --name=value (or only --name).
+     * They may appear anywhere after the query choice; all other arguments are positional and accessed via argv as before.
+     * A numeric option whose value is not a number ends the program with an error message.
+     */
+    class CommandLine {
+    public:
+        CommandLine(int argc, char *argv[]) {
+            for (int i = 1; i < argc; i++) {
+                const std::string argument(argv[i]);
+                if (argument.rfind("--", 0) != 0) continue;
+                const size_t separator = argument.find('=');
+                if (separator == std::string::npos) {
+                    options.emplace_back(argument.substr(2), "");
+                } else {
+                    options.emplace_back(argument.substr(2, separator - 2), argument.substr(separator + 1));
+                }
+            }
+        }
+
+        inline bool has(const std::string& name) const noexcept {
+            for (const auto & [key, value] : options) {
+                if (key == name) return true;
+            }
+            return false;
+        }
+
+        /**
+         * Returns the value of the given option or defaultValue if it was not given.
+         */
+        inline std::string get(const std::string& name, const std::string& defaultValue) const noexcept {
+            for (const auto & [key, value] : options) {
+                if (key == name) return value;
+            }
+            return defaultValue;
+        }
+
+        /**
+         * Returns the numeric value of the given option or defaultValue if it was not given.
+         */
+        inline size_t getNumber(const std::string& name, size_t defaultValue) const {
+            const std::string value = get(name, "");
+            if (value.empty()) return defaultValue;
+            return parseNumber(name, value);
+        }
+
+        /**
+         * Returns the comma-separated numbers of the given option, where a-b stands for all numbers from a to b,
+         * or defaultValues if it was not given. E.g., --lengths=1000,5000-5002 gives 1000, 5000, 5001, 5002.
+         */
+        inline std::vector<size_t> getNumbers(const std::string& name, const std::vector<size_t>& defaultValues) const {
+            const std::string value = get(name, "");
+            if (value.empty()) return defaultValues;
+            std::vector<size_t> result;
+            size_t begin = 0;
+            while (begin <= value.size()) {
+                const size_t end = std::min(value.find(',', begin), value.size());
+                const std::string item = value.substr(begin, end - begin);
+                const size_t range = item.find('-');
+                if (range == std::string::npos) {
+                    result.emplace_back(parseNumber(name, item));
+                } else {
+                    const size_t last = parseNumber(name, item.substr(range + 1));
+                    for (size_t number = parseNumber(name, item.substr(0, range)); number <= last; number++) {
+                        result.emplace_back(number);
+                    }
+                }
+                begin = end + 1;
+            }
+            return result;
+        }
+
+        /**
+         * Sets the value of the given option, e.g., to vary it in an experiment.
+         */
+        inline void set(const std::string& name, const std::string& value) {
+            for (auto & [key, oldValue] : options) {
+                if (key == name) {
+                    oldValue = value;
+                    return;
+                }
+            }
+            options.emplace_back(name, value);
+        }
+
+    private:
+        /**
+         * The unsigned number that text consists of. Otherwise, e.g., for --threads=abc, reports the option and exits,
+         * since none of the modes can run with a wrong number.
+         */
+        inline static size_t parseNumber(const std::string& name, const std::string& text) {
+            size_t number = 0;
+            const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), number);
+            if (error != std::errc() || end != text.data() + text.size()) {
+                std::cout << "Invalid value '" << text << "', expecting a number for --" << name << "." << std::endl;
+                std::exit(1);
+            }
+            return number;
+        }
+
+        std::vector<std::pair<std::string, std::string>> options;
+    };
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace Helpers {
+    /**
+     * A view of a text that ends with a sentinel: text[length - 1] is the sentinel, it is part of the view.
+     * This is exactly what the suffix tree and the suffix array expect as their input.
+     */
+    struct TextView {
+        const char* text;
+        //Number of characters including the sentinel.
+        size_t length;
+
+        /**
+         * The view of the same text without its first offset characters. The sentinel is kept.
+         */
+        inline TextView suffix(size_t offset) const noexcept {
+            return TextView{text + offset, length - offset};
+        }
+    };
+
+    /**
+     * Maps a file read-only into memory instead of copying it into a string.
+     *
+     * The mapping is always at least one byte longer than the file and everything behind the end of the file is zero,
+     * so the file contents are followed by a '\0' sentinel without writing anything:
+     * The part of the last page behind the end of the file is zero-filled by the kernel. If the file ends exactly at a
+     * page boundary, the anonymous (zero) page that was reserved behind it is kept.
+     */
+    class MappedFile {
+    public:
+        MappedFile(const std::string& fileName) :
+                data(nullptr),
+                fileSize(0),
+                mappingSize(0) {
+            const int file = open(fileName.c_str(), O_RDONLY);
+            if (file < 0) return;
+            struct stat fileStatus;
+            if (fstat(file, &fileStatus) == 0) {
+                fileSize = fileStatus.st_size;
+                const size_t pageSize = sysconf(_SC_PAGESIZE);
+                mappingSize = (fileSize / pageSize + 1) * pageSize;
+                //Reserve zero pages for the file and the sentinel, then map the file over them.
+                void* reserved = mmap(nullptr, mappingSize, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                if (reserved != MAP_FAILED) {
+                    if (fileSize == 0 || mmap(reserved, fileSize, PROT_READ, MAP_PRIVATE | MAP_FIXED, file, 0) != MAP_FAILED) {
+                        data = static_cast<const char*>(reserved);
+                    } else {
+                        munmap(reserved, mappingSize);
+                    }
+                }
+            }
+            close(file);
+        }
+
+        ~MappedFile() {
+            if (data != nullptr) munmap(const_cast<char*>(data), mappingSize);
+        }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        /**
+         * Checks if the file could be opened and mapped.
+         */
+        inline bool isOpen() const noexcept {
+            return data != nullptr;
+        }
+
+        /**
+         * The file contents followed by the '\0' sentinel.
+         */
+        inline TextView view() const noexcept {
+            return TextView{data, fileSize + 1};
+        }
+
+    private:
+        const char* data;
+        size_t fileSize;
+        size_t mappingSize;
+    };
+}
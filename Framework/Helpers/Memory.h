@@ -0,0 +1,199 @@
+#pragma once
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include <utility>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+namespace Helpers {
+    /**
+     * The data structures whose memory is accounted, see MemoryAccounting.
+     */
+    enum class MemoryComponent : size_t {
+        //The NodeArena of the suffix trees (its reservation, see NodeArena.h)
+        NodeArena,
+        //The child containers that allocate: the std::map of MapChildren, the tables of AdaptiveChildren
+        Children,
+        //The lists of suffixes below the inner nodes of RepeatQuery (suffixesBelowInnerNode)
+        SuffixLists,
+        //The candidates of the topk queries
+        Candidates,
+        //The length index of the topk queries (Query/TopKLengthIndex.h)
+        LengthIndex,
+        //The number of documents of every node of a generalized suffix tree (Query/DocumentCounts.h)
+        DocumentCounts
+    };
+    static constexpr size_t NumberOfMemoryComponents = 6;
+
+    /**
+     * Counts the bytes that are currently allocated for every MemoryComponent and the peak since the last resetPeaks().
+     * The counters are global and atomic (relaxed), so containers on any thread can report to them. They are only touched on
+     * allocations and deallocations, never on element accesses, and the containers that are accounted allocate rarely
+     * (the arena once, the candidate buffers once per thread) or already pay for a heap allocation (std::map nodes, suffix lists).
+     */
+    class MemoryAccounting {
+        struct alignas(64) Counter {
+            std::atomic<int64_t> current{0};
+            std::atomic<int64_t> peak{0};
+        };
+
+    public:
+        inline static void allocated(MemoryComponent component, size_t bytes) noexcept {
+            Counter& counter = counters()[static_cast<size_t>(component)];
+            const int64_t current = counter.current.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+            int64_t peak = counter.peak.load(std::memory_order_relaxed);
+            while (current > peak && !counter.peak.compare_exchange_weak(peak, current, std::memory_order_relaxed));
+        }
+
+        inline static void released(MemoryComponent component, size_t bytes) noexcept {
+            counters()[static_cast<size_t>(component)].current.fetch_sub(bytes, std::memory_order_relaxed);
+        }
+
+        inline static size_t current(MemoryComponent component) noexcept {
+            return std::max<int64_t>(counters()[static_cast<size_t>(component)].current.load(std::memory_order_relaxed), 0);
+        }
+
+        inline static size_t peak(MemoryComponent component) noexcept {
+            return std::max<int64_t>(counters()[static_cast<size_t>(component)].peak.load(std::memory_order_relaxed), 0);
+        }
+
+        /**
+         * Starts a new measurement: the peaks are set to the current values. Also resets the peak RSS of the process (see resetPeakRss).
+         */
+        inline static void resetPeaks() noexcept {
+            for (Counter& counter : counters()) {
+                counter.peak.store(counter.current.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            }
+            resetPeakRss();
+        }
+
+        inline static const char* name(MemoryComponent component) noexcept {
+            switch (component) {
+                case MemoryComponent::NodeArena: return "nodeArena";
+                case MemoryComponent::Children: return "children";
+                case MemoryComponent::SuffixLists: return "suffixLists";
+                case MemoryComponent::Candidates: return "candidates";
+                case MemoryComponent::LengthIndex: return "lengthIndex";
+                case MemoryComponent::DocumentCounts: return "documentCounts";
+            }
+            return "";
+        }
+
+        /**
+         * The resident set size of the process in bytes (VmRSS of /proc/self/status), 0 if it cannot be read.
+         */
+        inline static size_t currentRss() noexcept {
+            return readStatus("VmRSS:");
+        }
+
+        /**
+         * The largest resident set size of the process in bytes (VmHWM of /proc/self/status), 0 if it cannot be read.
+         */
+        inline static size_t peakRss() noexcept {
+            return readStatus("VmHWM:");
+        }
+
+        /**
+         * Sets the peak RSS to the current RSS (by writing 5 to /proc/self/clear_refs, Linux 4.0+), so that the peak of the next
+         * measurement does not include the earlier ones. Does nothing if that is not possible.
+         */
+        inline static void resetPeakRss() noexcept {
+            std::ofstream clearRefs("/proc/self/clear_refs");
+            if (clearRefs.is_open()) clearRefs << "5" << std::flush;
+        }
+
+        /**
+         * The peak RSS and the peak of every component since the last resetPeaks(), as key value pairs in bytes:
+         * peakRss, nodeArenaBytes, childrenBytes, suffixListsBytes, candidatesBytes, lengthIndexBytes and documentCountsBytes.
+         */
+        inline static std::vector<std::pair<std::string, std::string>> fields() {
+            std::vector<std::pair<std::string, std::string>> result;
+            result.emplace_back("peakRss", std::to_string(peakRss()));
+            for (size_t i = 0; i < NumberOfMemoryComponents; i++) {
+                const MemoryComponent component = static_cast<MemoryComponent>(i);
+                result.emplace_back(std::string(name(component)) + "Bytes", std::to_string(peak(component)));
+            }
+            return result;
+        }
+
+        /**
+         * The fields as " key=value" pairs for the RESULT lines.
+         */
+        inline static std::string resultFields() {
+            std::string result;
+            for (const auto & [key, value] : fields()) result += " " + key + "=" + value;
+            return result;
+        }
+
+    private:
+        inline static std::array<Counter, NumberOfMemoryComponents>& counters() noexcept {
+            static std::array<Counter, NumberOfMemoryComponents> counters;
+            return counters;
+        }
+
+        inline static size_t readStatus(const std::string& key) noexcept {
+            std::ifstream status("/proc/self/status");
+            std::string line;
+            while (std::getline(status, line)) {
+                if (line.compare(0, key.size(), key) != 0) continue;
+                //The value is given in kB.
+                return std::strtoull(line.c_str() + key.size(), nullptr, 10) * 1024;
+            }
+            return 0;
+        }
+    };
+
+    /**
+     * A std::allocator that reports its allocations to MemoryAccounting under COMPONENT.
+     * It is stateless, so containers with it have the same size and behavior as with std::allocator.
+     */
+    template<typename T, MemoryComponent COMPONENT>
+    class CountingAllocator {
+    public:
+        using value_type = T;
+
+        template<typename U>
+        struct rebind {
+            using other = CountingAllocator<U, COMPONENT>;
+        };
+
+        CountingAllocator() noexcept = default;
+
+        template<typename U>
+        CountingAllocator(const CountingAllocator<U, COMPONENT>&) noexcept {}
+
+        inline T* allocate(size_t n) {
+            T* result = std::allocator<T>().allocate(n);
+            MemoryAccounting::allocated(COMPONENT, n * sizeof(T));
+            return result;
+        }
+
+        inline void deallocate(T* pointer, size_t n) noexcept {
+            MemoryAccounting::released(COMPONENT, n * sizeof(T));
+            std::allocator<T>().deallocate(pointer, n);
+        }
+
+        template<typename U>
+        inline bool operator==(const CountingAllocator<U, COMPONENT>&) const noexcept {
+            return true;
+        }
+
+        template<typename U>
+        inline bool operator!=(const CountingAllocator<U, COMPONENT>&) const noexcept {
+            return false;
+        }
+    };
+
+    /**
+     * A std::vector whose memory is accounted under COMPONENT.
+     */
+    template<typename T, MemoryComponent COMPONENT>
+    using CountedVector = std::vector<T, CountingAllocator<T, COMPONENT>>;
+}
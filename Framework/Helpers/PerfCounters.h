@@ -0,0 +1,219 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+namespace Helpers {
+    /**
+     * The hardware events that PerfCounters counts.
+     */
+    enum class PerfEvent : size_t { Cycles, Instructions, LlcMisses, DtlbMisses, BranchMisses };
+    static constexpr size_t NumberOfPerfEvents = 5;
+
+    /**
+     * The values of all counters at one point in time, or the difference between two points.
+     */
+    struct PerfSample {
+        std::array<uint64_t, NumberOfPerfEvents> values{};
+
+        inline uint64_t operator[](PerfEvent event) const noexcept {
+            return values[static_cast<size_t>(event)];
+        }
+
+        inline PerfSample operator-(const PerfSample& other) const noexcept {
+            PerfSample result;
+            for (size_t i = 0; i < NumberOfPerfEvents; i++) {
+                result.values[i] = values[i] - other.values[i];
+            }
+            return result;
+        }
+
+        inline PerfSample& operator+=(const PerfSample& other) noexcept {
+            for (size_t i = 0; i < NumberOfPerfEvents; i++) {
+                values[i] += other.values[i];
+            }
+            return *this;
+        }
+    };
+
+    /**
+     * Hardware performance counters of the calling thread, read with the Linux perf_event_open interface.
+     *
+     * All events are opened as one group, so they are scheduled onto the PMU together and count exactly the same instructions.
+     * If the PMU has fewer counters than events, the kernel multiplexes the group and the values are scaled by the fraction of the time
+     * that it was running. Only user space is counted, which is allowed with the default perf_event_paranoid setting of 2.
+     * Events that cannot be opened (no PMU in a VM, no permission, an event that the CPU does not have) are reported as unavailable,
+     * everything else keeps working. The counters belong to the thread that constructed them: work on other threads is not counted.
+     */
+    class PerfCounters {
+        //The layout of a read with PERF_FORMAT_GROUP | PERF_FORMAT_ID | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING
+        struct GroupReading {
+            uint64_t numberOfEvents;
+            uint64_t timeEnabled;
+            uint64_t timeRunning;
+            struct {
+                uint64_t value;
+                uint64_t id;
+            } events[NumberOfPerfEvents];
+        };
+
+    public:
+        PerfCounters() {
+            fds.fill(-1);
+            ids.fill(0);
+            for (size_t i = 0; i < NumberOfPerfEvents; i++) {
+                perf_event_attr attributes;
+                std::memset(&attributes, 0, sizeof(attributes));
+                attributes.size = sizeof(attributes);
+                setEvent(static_cast<PerfEvent>(i), attributes);
+                attributes.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+                attributes.exclude_kernel = 1;
+                attributes.exclude_hv = 1;
+                //The first event that can be opened leads the group, it starts disabled and enables the whole group below.
+                attributes.disabled = (leader == -1);
+                fds[i] = syscall(SYS_perf_event_open, &attributes, 0, -1, leader, 0);
+                if (fds[i] < 0) {
+                    fds[i] = -1;
+                    continue;
+                }
+                if (leader == -1) leader = fds[i];
+                ioctl(fds[i], PERF_EVENT_IOC_ID, &ids[i]);
+            }
+            if (leader == -1) return;
+            ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+
+        PerfCounters(const PerfCounters&) = delete;
+        PerfCounters& operator=(const PerfCounters&) = delete;
+
+        ~PerfCounters() {
+            for (const int fd : fds) {
+                if (fd != -1) close(fd);
+            }
+        }
+
+        inline bool isAvailable(PerfEvent event) const noexcept {
+            return fds[static_cast<size_t>(event)] != -1;
+        }
+
+        inline bool isAvailable() const noexcept {
+            return leader != -1;
+        }
+
+        /**
+         * The current values of all counters, 0 for the unavailable ones.
+         */
+        inline PerfSample read() const noexcept {
+            PerfSample sample;
+            if (leader == -1) return sample;
+            GroupReading reading;
+            if (::read(leader, &reading, sizeof(reading)) <= 0 || reading.timeRunning == 0) return sample;
+            const double scale = reading.timeEnabled / (double) reading.timeRunning;
+            for (uint64_t e = 0; e < reading.numberOfEvents && e < NumberOfPerfEvents; e++) {
+                for (size_t i = 0; i < NumberOfPerfEvents; i++) {
+                    if (fds[i] == -1 || ids[i] != reading.events[e].id) continue;
+                    sample.values[i] = (reading.timeRunning == reading.timeEnabled) ? reading.events[e].value : static_cast<uint64_t>(reading.events[e].value * scale);
+                }
+            }
+            return sample;
+        }
+
+        inline static const char* name(PerfEvent event) noexcept {
+            switch (event) {
+                case PerfEvent::Cycles: return "cycles";
+                case PerfEvent::Instructions: return "instructions";
+                case PerfEvent::LlcMisses: return "LLC-misses";
+                case PerfEvent::DtlbMisses: return "dTLB-misses";
+                case PerfEvent::BranchMisses: return "branch-misses";
+            }
+            return "";
+        }
+
+    private:
+        inline static void setEvent(PerfEvent event, perf_event_attr& attributes) noexcept {
+            attributes.type = PERF_TYPE_HARDWARE;
+            switch (event) {
+                case PerfEvent::Cycles: attributes.config = PERF_COUNT_HW_CPU_CYCLES; break;
+                case PerfEvent::Instructions: attributes.config = PERF_COUNT_HW_INSTRUCTIONS; break;
+                case PerfEvent::LlcMisses: attributes.config = PERF_COUNT_HW_CACHE_MISSES; break;
+                case PerfEvent::BranchMisses: attributes.config = PERF_COUNT_HW_BRANCH_MISSES; break;
+                case PerfEvent::DtlbMisses:
+                    attributes.type = PERF_TYPE_HW_CACHE;
+                    attributes.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+                    break;
+            }
+        }
+
+    private:
+        int leader = -1;
+        std::array<int, NumberOfPerfEvents> fds;
+        std::array<uint64_t, NumberOfPerfEvents> ids;
+    };
+
+    /**
+     * The wall-clock time and the counters of a phase, summed up over all of its runs.
+     */
+    class PerfPhase {
+    public:
+        inline void start(const PerfCounters& counters) noexcept {
+            runs++;
+            startTime = std::chrono::steady_clock::now();
+            startSample = counters.read();
+        }
+
+        inline void end(const PerfCounters& counters) noexcept {
+            //Read the counters first, so that the time of the phase includes the read at its start but not the one at its end.
+            total += counters.read() - startSample;
+            nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime).count();
+        }
+
+        inline size_t numberOfRuns() const noexcept {
+            return runs;
+        }
+
+        /**
+         * Prints the time in ms and the counters of the phase divided by divisor (e.g. the number of queries for the average per query),
+         * followed by the instructions per cycle and the misses per 1000 instructions.
+         */
+        inline void print(std::ostream& out, const std::string& name, const PerfCounters& counters, double divisor = 1) const noexcept {
+            if (divisor == 0) divisor = 1;
+            out << name << nanoseconds / divisor / 1000000.0 << "ms";
+            for (size_t i = 0; i < NumberOfPerfEvents; i++) {
+                const PerfEvent event = static_cast<PerfEvent>(i);
+                out << " " << PerfCounters::name(event) << "=";
+                if (counters.isAvailable(event)) {
+                    out << static_cast<uint64_t>(total[event] / divisor);
+                } else {
+                    out << "n/a";
+                }
+            }
+            const uint64_t instructions = total[PerfEvent::Instructions];
+            if (counters.isAvailable(PerfEvent::Cycles) && counters.isAvailable(PerfEvent::Instructions) && total[PerfEvent::Cycles] > 0) {
+                out << " IPC=" << instructions / (double) total[PerfEvent::Cycles];
+            }
+            if (counters.isAvailable(PerfEvent::Instructions) && instructions > 0) {
+                for (const PerfEvent event : {PerfEvent::LlcMisses, PerfEvent::DtlbMisses, PerfEvent::BranchMisses}) {
+                    if (counters.isAvailable(event)) out << " " << PerfCounters::name(event) << "/kI=" << 1000.0 * total[event] / instructions;
+                }
+            }
+            out << std::endl;
+        }
+
+    private:
+        size_t runs = 0;
+        uint64_t nanoseconds = 0;
+        PerfSample total;
+        std::chrono::steady_clock::time_point startTime;
+        PerfSample startSample;
+    };
+}
@@ -0,0 +1,316 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <cctype>
+#include <csignal>
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "ThreadPool.h"
+
+namespace Helpers {
+    /**
+     * A request of the query server protocol. Every request is one line:
+     *  - "topk l k": the k-th most frequent substring of length l
+     *  - "repeat": the longest square
+     *  - "shutdown": answers the requests before and stops the server
+     * Empty lines are ignored, everything else is answered with an error.
+     */
+    struct ServerRequest {
+        enum class Type { TopK, Repeat, Shutdown, Invalid };
+        Type type;
+        size_t l;
+        size_t k;
+        //The number of the request in its connection, starting at 0
+        size_t id;
+        std::chrono::steady_clock::time_point received;
+    };
+
+    /**
+     * The answer of a request: the substring [start, start + length) of the text, or an error message if found is false.
+     */
+    struct ServerAnswer {
+        bool found;
+        size_t start;
+        size_t length;
+        std::string error;
+        //Time to compute the answer in microseconds
+        size_t queryTime;
+    };
+
+    /**
+     * Answers the requests of a connection (stdin/stdout or a Unix domain socket) against a prebuilt index.
+     *
+     * The requests are pipelined in three stages that run concurrently:
+     *  - A reader thread reads and parses the requests.
+     *  - The calling thread takes all requests that have arrived so far and answers them with the thread pool.
+     *    A single request is answered as soon as it arrives, so batching only happens under load.
+     *  - A writer thread formats and writes the responses in the order of the requests.
+     * Every response is one line of the form "RESULT request=i query=topk l=.. k=.. start=.. latency=..us queryTime=..us solution=..",
+     * where latency is the time from parsing the request to writing its response. Line breaks, tabs, backslashes and zero bytes in the
+     * solution are escaped as \n, \r, \t, \\ and \0. Errors are answered with "ERROR request=i message=..".
+     */
+    class QueryServer {
+        //The largest number of requests that are answered at once
+        static constexpr size_t MaxBatchSize = 4096;
+
+        struct Response {
+            ServerRequest request;
+            ServerAnswer answer;
+        };
+
+    public:
+        /**
+         * The statistics of one connection.
+         */
+        struct Statistics {
+            size_t requests = 0;
+            size_t time = 0;//milliseconds
+            std::vector<size_t> latencies;//microseconds, in the order of the requests
+            bool shutdown = false;
+        };
+
+        QueryServer(const char* text, size_t threads) :
+                text(text),
+                pool(threads) {
+            //A client that disconnects must not kill the server, the writer notices the failed write instead.
+            std::signal(SIGPIPE, SIG_IGN);
+        }
+
+        inline size_t numberOfThreads() const noexcept {
+            return pool.size();
+        }
+
+        /**
+         * Answers all requests read from inputFd on outputFd until the input ends or a shutdown request arrives.
+         * execute(request, thread) answers a topk or repeat request, thread in [0, numberOfThreads()) identifies the executing thread.
+         */
+        template<typename EXECUTE>
+        inline Statistics serve(int inputFd, int outputFd, const EXECUTE& execute) {
+            Statistics statistics;
+            const auto start = std::chrono::steady_clock::now();
+            std::deque<ServerRequest> requests;
+            bool inputDone = false;
+            std::deque<Response> responses;
+            bool outputDone = false;
+            bool writeFailed = false;
+            std::mutex mutex;
+            std::condition_variable requestsAvailable;
+            std::condition_variable responsesAvailable;
+
+            std::thread reader([&]() {
+                std::string line;
+                std::vector<char> buffer(1 << 16);
+                size_t id = 0;
+                bool shutdown = false;
+                while (!shutdown) {
+                    const ssize_t bytes = read(inputFd, buffer.data(), buffer.size());
+                    if (bytes < 0 && errno == EINTR) continue;
+                    if (bytes <= 0) break;
+                    std::vector<ServerRequest> parsed;
+                    for (ssize_t i = 0; i < bytes && !shutdown; i++) {
+                        if (buffer[i] != '\n') {
+                            line.push_back(buffer[i]);
+                            continue;
+                        }
+                        if (parseRequest(line, id, parsed)) {
+                            id++;
+                            shutdown = parsed.back().type == ServerRequest::Type::Shutdown;
+                        }
+                        line.clear();
+                    }
+                    std::lock_guard<std::mutex> lock(mutex);
+                    requests.insert(requests.end(), parsed.begin(), parsed.end());
+                    requestsAvailable.notify_one();
+                }
+                std::vector<ServerRequest> parsed;
+                if (!shutdown && parseRequest(line, id, parsed)) id++;
+                std::lock_guard<std::mutex> lock(mutex);
+                requests.insert(requests.end(), parsed.begin(), parsed.end());
+                inputDone = true;
+                requestsAvailable.notify_one();
+            });
+
+            std::thread writer([&]() {
+                std::string output;
+                while (true) {
+                    std::deque<Response> batch;
+                    {
+                        std::unique_lock<std::mutex> lock(mutex);
+                        responsesAvailable.wait(lock, [&]() { return !responses.empty() || outputDone; });
+                        if (responses.empty()) return;
+                        batch.swap(responses);
+                    }
+                    output.clear();
+                    for (const Response& response : batch) {
+                        const size_t latency = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - response.request.received).count();
+                        formatResponse(response, latency, output);
+                        statistics.latencies.emplace_back(latency);
+                    }
+                    if (!writeFailed && !writeAll(outputFd, output)) writeFailed = true;
+                }
+            });
+
+            std::vector<ServerRequest> batch;
+            std::vector<ServerAnswer> answers;
+            while (true) {
+                batch.clear();
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    requestsAvailable.wait(lock, [&]() { return !requests.empty() || inputDone; });
+                    if (requests.empty()) break;
+                    const size_t size = std::min(requests.size(), MaxBatchSize);
+                    batch.assign(requests.begin(), requests.begin() + size);
+                    requests.erase(requests.begin(), requests.begin() + size);
+                }
+                answers.assign(batch.size(), ServerAnswer{false, 0, 0, "", 0});
+                pool.parallelFor(batch.size(), [&](size_t i, size_t thread) {
+                    const ServerRequest& request = batch[i];
+                    if (request.type == ServerRequest::Type::Invalid) {
+                        answers[i].error = "expecting 'topk l k' with l, k >= 1, 'repeat' or 'shutdown'";
+                    } else if (request.type != ServerRequest::Type::Shutdown) {
+                        const auto queryStart = std::chrono::steady_clock::now();
+                        answers[i] = execute(request, thread);
+                        answers[i].queryTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - queryStart).count();
+                    }
+                });
+                std::lock_guard<std::mutex> lock(mutex);
+                for (size_t i = 0; i < batch.size(); i++) {
+                    statistics.shutdown |= batch[i].type == ServerRequest::Type::Shutdown;
+                    responses.emplace_back(batch[i], std::move(answers[i]));
+                }
+                responsesAvailable.notify_one();
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                outputDone = true;
+                responsesAvailable.notify_one();
+            }
+            reader.join();
+            writer.join();
+            statistics.requests = statistics.latencies.size();
+            statistics.time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+            return statistics;
+        }
+
+        /**
+         * Creates a Unix domain socket at path that accepts connections. Returns its file descriptor or -1.
+         */
+        inline static int listenOnSocket(const std::string& path) noexcept {
+            sockaddr_un address{};
+            if (path.size() >= sizeof(address.sun_path)) {
+                std::cerr << "The socket path " << path << " is too long." << std::endl;
+                return -1;
+            }
+            const int socketFd = socket(AF_UNIX, SOCK_STREAM, 0);
+            if (socketFd < 0) {
+                std::cerr << "Could not create socket: " << std::strerror(errno) << std::endl;
+                return -1;
+            }
+            address.sun_family = AF_UNIX;
+            std::strcpy(address.sun_path, path.c_str());
+            unlink(path.c_str());
+            if (bind(socketFd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0 || listen(socketFd, 16) < 0) {
+                std::cerr << "Could not listen on " << path << ": " << std::strerror(errno) << std::endl;
+                close(socketFd);
+                return -1;
+            }
+            return socketFd;
+        }
+
+    private:
+        /**
+         * Parses a line into a request and appends it to requests. Returns false for empty lines, which are no requests.
+         */
+        inline static bool parseRequest(std::string line, const size_t id, std::vector<ServerRequest>& requests) noexcept {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            std::vector<std::string> words;
+            size_t position = 0;
+            while (position < line.size()) {
+                while (position < line.size() && std::isspace(static_cast<unsigned char>(line[position]))) position++;
+                const size_t begin = position;
+                while (position < line.size() && !std::isspace(static_cast<unsigned char>(line[position]))) position++;
+                if (position > begin) words.emplace_back(line.substr(begin, position - begin));
+            }
+            if (words.empty()) return false;
+            ServerRequest request{ServerRequest::Type::Invalid, 0, 0, id, std::chrono::steady_clock::now()};
+            if (words[0] == "topk" && words.size() == 3 && isNumber(words[1]) && isNumber(words[2])) {
+                request.l = std::stoul(words[1]);
+                request.k = std::stoul(words[2]);
+                if (request.l >= 1 && request.k >= 1) request.type = ServerRequest::Type::TopK;
+            } else if (words[0] == "repeat" && words.size() == 1) {
+                request.type = ServerRequest::Type::Repeat;
+            } else if (words[0] == "shutdown" && words.size() == 1) {
+                request.type = ServerRequest::Type::Shutdown;
+            }
+            requests.emplace_back(request);
+            return true;
+        }
+
+        inline static bool isNumber(const std::string& word) noexcept {
+            return word.size() <= 18 && std::all_of(word.begin(), word.end(), [](const char c) { return std::isdigit(static_cast<unsigned char>(c)); });
+        }
+
+        inline void formatResponse(const Response& response, const size_t latency, std::string& output) const noexcept {
+            const ServerRequest& request = response.request;
+            const ServerAnswer& answer = response.answer;
+            if (request.type == ServerRequest::Type::Shutdown) {
+                output += "RESULT request=" + std::to_string(request.id) + " query=shutdown\n";
+                return;
+            }
+            if (!answer.found) {
+                output += "ERROR request=" + std::to_string(request.id) + " message=" + answer.error + "\n";
+                return;
+            }
+            output += "RESULT request=" + std::to_string(request.id);
+            if (request.type == ServerRequest::Type::TopK) {
+                output += " query=topk l=" + std::to_string(request.l) + " k=" + std::to_string(request.k);
+            } else {
+                output += " query=repeat length=" + std::to_string(answer.length);
+            }
+            output += " start=" + std::to_string(answer.start)
+                    + " latency=" + std::to_string(latency) + "us"
+                    + " queryTime=" + std::to_string(answer.queryTime) + "us"
+                    + " solution=";
+            for (size_t i = answer.start; i < answer.start + answer.length; i++) {
+                switch (text[i]) {
+                    case '\n': output += "\\n"; break;
+                    case '\r': output += "\\r"; break;
+                    case '\t': output += "\\t"; break;
+                    case '\\': output += "\\\\"; break;
+                    case '\0': output += "\\0"; break;
+                    default: output += text[i];
+                }
+            }
+            output += '\n';
+        }
+
+        inline static bool writeAll(int fd, const std::string& output) noexcept {
+            size_t written = 0;
+            while (written < output.size()) {
+                const ssize_t bytes = write(fd, output.data() + written, output.size() - written);
+                if (bytes < 0 && errno == EINTR) continue;
+                if (bytes <= 0) return false;
+                written += bytes;
+            }
+            return true;
+        }
+
+    private:
+        //The indexed text, for the solutions
+        const char* text;
+        ThreadPool pool;
+    };
+}
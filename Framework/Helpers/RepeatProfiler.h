@@ -1,6 +1,8 @@
 #include <chrono>
 
 #include "Timer.h"
+#include "PerfCounters.h"
+#include "Trace.h"
 
 namespace Query {
     class RepeatNoProfiler {
@@ -116,4 +118,165 @@ namespace Query {
         size_t numberOfPairCalls;
         size_t numberOfMerges;
     };
+
+    /**
+     * A drop-in replacement for RepeatProfiler that also reads the hardware performance counters (Helpers/PerfCounters.h) in every phase:
+     * cycles, instructions, LLC misses, dTLB misses and branch misses, e.g., to see whether collectSuffixesBelow (the merge phase) is bound
+     * by cache misses or by the allocations of its vectors.
+     * The inner node, merge and pair phases run once per inner node and each costs two reads of the counters (system calls), so
+     * the times are even more inflated than with RepeatProfiler. The counters only count user space, so the reads hardly show up in them:
+     * Compare the counters of the phases, not the times. Only the thread that constructed the query is counted, run the query with one thread.
+     */
+    class RepeatPerfProfiler {
+    public:
+        inline void startStringDepth() noexcept {
+            stringDepth.start(counters);
+        }
+
+        inline void endStringDepth() noexcept {
+            stringDepth.end(counters);
+        }
+
+        inline void startCollectInnerNodes() noexcept {
+            collectInnerNodes.start(counters);
+        }
+
+        inline void endCollectInnerNodes() noexcept {
+            collectInnerNodes.end(counters);
+        }
+
+        inline void startActualQuery() noexcept {
+            actualQuery.start(counters);
+        }
+
+        inline void endActualQuery() noexcept {
+            actualQuery.end(counters);
+        }
+
+        inline void startInnerNodePhase() noexcept {
+            innerNodePhase.start(counters);
+        }
+
+        inline void endInnerNodePhase() noexcept {
+            innerNodePhase.end(counters);
+        }
+
+        inline void startPairPhase() noexcept {
+            pairPhase.start(counters);
+        }
+
+        inline void endPairPhase() noexcept {
+            pairPhase.end(counters);
+        }
+
+        inline void startMergePhase() noexcept {
+            mergePhase.start(counters);
+        }
+
+        inline void endMergePhase() noexcept {
+            mergePhase.end(counters);
+        }
+
+        inline void print(std::ostream& out = std::cout) const noexcept {
+            out << "Repeat Query evaluation run"
+                << (counters.isAvailable() ? "." : ", the performance counters are not available (see /proc/sys/kernel/perf_event_paranoid).") << std::endl;
+            stringDepth.print(out, "  String depth:        ", counters);
+            collectInnerNodes.print(out, "  Collect inner nodes: ", counters);
+            actualQuery.print(out, "  Actual query:        ", counters);
+            out << "    Inner node phases: " << innerNodePhase.numberOfRuns() << ", pair calls: " << pairPhase.numberOfRuns() << ", merges: " << mergePhase.numberOfRuns() << std::endl;
+            innerNodePhase.print(out, "    -- inner node phases: ", counters);
+            pairPhase.print(out, "    -- pair calls:        ", counters);
+            mergePhase.print(out, "    -- merges:            ", counters);
+        }
+
+    private:
+        Helpers::PerfCounters counters;
+
+        Helpers::PerfPhase stringDepth;
+        Helpers::PerfPhase collectInnerNodes;
+        Helpers::PerfPhase actualQuery;
+        Helpers::PerfPhase innerNodePhase;
+        Helpers::PerfPhase pairPhase;
+        Helpers::PerfPhase mergePhase;
+    };
+
+    /**
+     * The profiler for production runs: It traces the phases with the shared tracer (Helpers/Trace.h). The inner node, merge and pair phases
+     * run once per inner node, so only every DefaultNodeSampleRate-th of them is timed (see setNodeSampleRate), the others cost
+     * a countdown. Unlike RepeatProfiler, it is thread-safe.
+     * print() prints the latency histograms of the phases of all queries so far.
+     */
+    class RepeatTraceProfiler {
+        enum Phase : uint32_t { StringDepth, CollectInnerNodes, ActualQuery, InnerNodePhase, PairPhase, MergePhase };
+
+    public:
+        static constexpr uint32_t DefaultNodeSampleRate = 64;
+
+        inline static Helpers::Tracer& tracer() {
+            static Helpers::Tracer tracer("repeat", {{"stringDepth"}, {"collectInnerNodes"}, {"actualQuery"},
+                                                     {"innerNodePhase", DefaultNodeSampleRate}, {"pairPhase", DefaultNodeSampleRate}, {"mergePhase", DefaultNodeSampleRate}});
+            return tracer;
+        }
+
+        /**
+         * Times every sampleRate-th run of the phases per inner node, 1 times all of them.
+         */
+        inline static void setNodeSampleRate(uint32_t sampleRate) noexcept {
+            for (const Phase phase : {InnerNodePhase, PairPhase, MergePhase}) {
+                tracer().setSampleRate(phase, sampleRate);
+            }
+        }
+
+        inline void startStringDepth() noexcept {
+            tracer().start(StringDepth);
+        }
+
+        inline void endStringDepth() noexcept {
+            tracer().end(StringDepth);
+        }
+
+        inline void startCollectInnerNodes() noexcept {
+            tracer().start(CollectInnerNodes);
+        }
+
+        inline void endCollectInnerNodes() noexcept {
+            tracer().end(CollectInnerNodes);
+        }
+
+        inline void startActualQuery() noexcept {
+            tracer().start(ActualQuery);
+        }
+
+        inline void endActualQuery() noexcept {
+            tracer().end(ActualQuery);
+        }
+
+        inline void startInnerNodePhase() noexcept {
+            tracer().start(InnerNodePhase);
+        }
+
+        inline void endInnerNodePhase() noexcept {
+            tracer().end(InnerNodePhase);
+        }
+
+        inline void startPairPhase() noexcept {
+            tracer().start(PairPhase);
+        }
+
+        inline void endPairPhase() noexcept {
+            tracer().end(PairPhase);
+        }
+
+        inline void startMergePhase() noexcept {
+            tracer().start(MergePhase);
+        }
+
+        inline void endMergePhase() noexcept {
+            tracer().end(MergePhase);
+        }
+
+        inline void print(std::ostream& out = std::cout) const {
+            tracer().print(out);
+        }
+    };
 }
\ No newline at end of file
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <algorithm>
+
+namespace Helpers {
+    /**
+     * A fixed set of worker threads that run parallel loops.
+     *
+     * numberOfThreads includes the calling thread: it participates in every loop, so a pool with one thread runs everything
+     * on the calling thread without any synchronization.
+     * The iterations of a loop are handed out one by one (dynamic scheduling), so tasks of different size are balanced automatically.
+     */
+    class ThreadPool {
+    public:
+        ThreadPool(size_t numberOfThreads) :
+                numberOfThreads(std::max<size_t>(numberOfThreads, 1)),
+                generation(0),
+                numberOfTasks(0),
+                nextTask(0),
+                busyWorkers(0),
+                terminate(false) {
+            for (size_t thread = 1; thread < this->numberOfThreads; thread++) {
+                workers.emplace_back([this, thread]() { workerLoop(thread); });
+            }
+        }
+
+        ~ThreadPool() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                terminate = true;
+            }
+            wakeUp.notify_all();
+            for (std::thread& worker : workers) {
+                worker.join();
+            }
+        }
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        inline size_t size() const noexcept {
+            return numberOfThreads;
+        }
+
+        /**
+         * Calls function(task, thread) for all task in [0, tasks) and returns when all calls are done.
+         * thread in [0, size()) identifies the executing thread, e.g., to use per-thread scratch memory.
+         */
+        template<typename FUNCTION>
+        inline void parallelFor(size_t tasks, const FUNCTION& function) {
+            if (numberOfThreads == 1 || tasks <= 1) {
+                for (size_t task = 0; task < tasks; task++) function(task, 0);
+                return;
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                job = function;
+                numberOfTasks = tasks;
+                nextTask = 0;
+                busyWorkers = workers.size();
+                generation++;
+            }
+            wakeUp.notify_all();
+            runTasks(0);
+            std::unique_lock<std::mutex> lock(mutex);
+            done.wait(lock, [this]() { return busyWorkers == 0; });
+            job = nullptr;
+        }
+
+    private:
+        inline void runTasks(size_t thread) {
+            while (true) {
+                const size_t task = nextTask.fetch_add(1, std::memory_order_relaxed);
+                if (task >= numberOfTasks) return;
+                job(task, thread);
+            }
+        }
+
+        inline void workerLoop(size_t thread) {
+            size_t seenGeneration = 0;
+            while (true) {
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    wakeUp.wait(lock, [&]() { return terminate || generation != seenGeneration; });
+                    if (terminate) return;
+                    seenGeneration = generation;
+                }
+                runTasks(thread);
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    busyWorkers--;
+                }
+                done.notify_one();
+            }
+        }
+
+    private:
+        size_t numberOfThreads;
+        std::vector<std::thread> workers;
+        std::mutex mutex;
+        std::condition_variable wakeUp;
+        std::condition_variable done;
+        //The current loop
+        std::function<void(size_t, size_t)> job;
+        size_t generation;
+        size_t numberOfTasks;
+        std::atomic<size_t> nextTask;
+        size_t busyWorkers;
+        bool terminate;
+    };
+}
@@ -24,6 +24,11 @@ namespace Helpers {
             return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
         }
 
+        inline size_t getNanoseconds() {
+            std::chrono::time_point<std::chrono::high_resolution_clock> end = std::chrono::high_resolution_clock::now();
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+        }
+
     private:
         std::chrono::time_point<std::chrono::high_resolution_clock> start;
     };
@@ -1,6 +1,8 @@
 #include <chrono>
 
 #include "Timer.h"
+#include "PerfCounters.h"
+#include "Trace.h"
 
 namespace Query {
     class TopKNoProfiler {
@@ -93,4 +95,150 @@ namespace Query {
 
         size_t numberOfQueries;
     };
+
+    /**
+     * A drop-in replacement for TopKProfiler that also reads the hardware performance counters (Helpers/PerfCounters.h) in every phase:
+     * cycles, instructions, LLC misses, dTLB misses and branch misses. It shows whether collectingBfs is bound by cache or TLB misses of
+     * the node accesses or by mispredicted branches, and whether the selection of the k best candidates matters at all.
+     * Each phase costs two reads of the counters (system calls), which is negligible for whole queries. Like TopKProfiler, it is not thread-safe,
+     * and only the thread that constructed the query is counted.
+     */
+    class TopKPerfProfiler {
+    public:
+        TopKPerfProfiler() :
+            numberOfQueries(0) {}
+
+        inline void startInitialization() noexcept {
+            initialization.start(counters);
+        }
+
+        inline void endInitialization() noexcept {
+            initialization.end(counters);
+        }
+
+        inline void startNewQuery() noexcept {
+            numberOfQueries++;
+            query.start(counters);
+        }
+
+        inline void endCurrentQuery() noexcept {
+            query.end(counters);
+        }
+
+        inline void startCollectCandidates() noexcept {
+            collectCandidates.start(counters);
+        }
+
+        inline void endCollectCandidates() noexcept {
+            collectCandidates.end(counters);
+        }
+
+        inline void startSortCandidates() noexcept {
+            sortCandidates.start(counters);
+        }
+
+        inline void endSortCandidates() noexcept {
+            sortCandidates.end(counters);
+        }
+
+        inline void startReconstructSolution() noexcept {
+            reconstructSolution.start(counters);
+        }
+
+        inline void endReconstructSolution() noexcept {
+            reconstructSolution.end(counters);
+        }
+
+        /**
+         * Starts the counting of the queries anew, e.g., for the next query length. The initialization is kept.
+         */
+        inline void reset() noexcept {
+            query = Helpers::PerfPhase();
+            collectCandidates = Helpers::PerfPhase();
+            sortCandidates = Helpers::PerfPhase();
+            reconstructSolution = Helpers::PerfPhase();
+            numberOfQueries = 0;
+        }
+
+        inline void print(std::ostream& out = std::cout) const noexcept {
+            out << "TopK Query evaluation run for " << numberOfQueries << " queries"
+                << (counters.isAvailable() ? "." : ", the performance counters are not available (see /proc/sys/kernel/perf_event_paranoid).") << std::endl;
+            initialization.print(out, "  Initialization:         ", counters);
+            out << "  Avg. per query:" << std::endl;
+            query.print(out, "    Total query:          ", counters, numberOfQueries);
+            collectCandidates.print(out, "    Collect candidates:   ", counters, numberOfQueries);
+            sortCandidates.print(out, "    Sort candidates:      ", counters, numberOfQueries);
+            reconstructSolution.print(out, "    Reconstruct solution: ", counters, numberOfQueries);
+        }
+
+    private:
+        Helpers::PerfCounters counters;
+
+        Helpers::PerfPhase initialization;
+        Helpers::PerfPhase query;
+        Helpers::PerfPhase collectCandidates;
+        Helpers::PerfPhase sortCandidates;
+        Helpers::PerfPhase reconstructSolution;
+
+        size_t numberOfQueries;
+    };
+
+    /**
+     * The profiler for production runs: It traces the phases of all queries with the shared tracer (Helpers/Trace.h), which costs
+     * a few time stamp counter reads per query. Unlike TopKProfiler, it is thread-safe, so the queries may run concurrently.
+     * print() prints the latency histograms of the phases of all queries so far (p50/p90/p99/max per query).
+     */
+    class TopKTraceProfiler {
+        enum Phase : uint32_t { Initialization, Query, CollectCandidates, SortCandidates, ReconstructSolution };
+
+    public:
+        inline static Helpers::Tracer& tracer() {
+            static Helpers::Tracer tracer("topk", {{"initialization"}, {"query"}, {"collectCandidates"}, {"sortCandidates"}, {"reconstructSolution"}});
+            return tracer;
+        }
+
+        inline void startInitialization() noexcept {
+            tracer().start(Initialization);
+        }
+
+        inline void endInitialization() noexcept {
+            tracer().end(Initialization);
+        }
+
+        inline void startNewQuery() noexcept {
+            tracer().start(Query);
+        }
+
+        inline void endCurrentQuery() noexcept {
+            tracer().end(Query);
+        }
+
+        inline void startCollectCandidates() noexcept {
+            tracer().start(CollectCandidates);
+        }
+
+        inline void endCollectCandidates() noexcept {
+            tracer().end(CollectCandidates);
+        }
+
+        inline void startSortCandidates() noexcept {
+            tracer().start(SortCandidates);
+        }
+
+        inline void endSortCandidates() noexcept {
+            tracer().end(SortCandidates);
+        }
+
+        inline void startReconstructSolution() noexcept {
+            tracer().start(ReconstructSolution);
+        }
+
+        inline void endReconstructSolution() noexcept {
+            tracer().end(ReconstructSolution);
+        }
+
+        inline void print(std::ostream& out = std::cout) const {
+            tracer().print(out);
+        }
+    };
 }
\ No newline at end of file
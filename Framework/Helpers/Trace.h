@@ -0,0 +1,320 @@
+#pragma once
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <array>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace Helpers {
+    /**
+     * Timestamps for the tracing: the time stamp counter on x86 (a few ns per read, no system call), nanoseconds of steady_clock elsewhere.
+     * The ticks are only converted to time when the trace is printed or exported, so the hot path never divides.
+     */
+    class TraceClock {
+    public:
+        inline static uint64_t now() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+            return __rdtsc();
+#else
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+        }
+    };
+
+    /**
+     * A histogram of latencies in ticks with logarithmic buckets and SubBuckets linear sub-buckets each, like HdrHistogram:
+     * Recording is a shift and an increment, and every percentile is accurate up to 1/SubBuckets of its value.
+     */
+    class LatencyHistogram {
+        static constexpr int SubBits = 4;
+        static constexpr uint64_t SubBuckets = 1 << SubBits;
+        static constexpr size_t NumberOfBuckets = (64 - SubBits + 1) * SubBuckets;
+
+    public:
+        inline void record(uint64_t value) noexcept {
+            counts[bucketOf(value)]++;
+            count++;
+            sum += value;
+            max = std::max(max, value);
+        }
+
+        inline void merge(const LatencyHistogram& other) noexcept {
+            for (size_t i = 0; i < NumberOfBuckets; i++) {
+                counts[i] += other.counts[i];
+            }
+            count += other.count;
+            sum += other.sum;
+            max = std::max(max, other.max);
+        }
+
+        inline uint64_t size() const noexcept {
+            return count;
+        }
+
+        inline uint64_t maximum() const noexcept {
+            return max;
+        }
+
+        inline double mean() const noexcept {
+            return (count == 0) ? 0 : sum / (double) count;
+        }
+
+        /**
+         * The smallest value that is at least as large as the fraction p of all values (within the accuracy of the buckets).
+         */
+        inline uint64_t percentile(double p) const noexcept {
+            if (count == 0) return 0;
+            const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(p * count + 0.5));
+            uint64_t seen = 0;
+            for (size_t i = 0; i < NumberOfBuckets; i++) {
+                seen += counts[i];
+                if (seen >= rank) return std::min(upperBound(i), max);
+            }
+            return max;
+        }
+
+    private:
+        inline static size_t bucketOf(uint64_t value) noexcept {
+            if (value < SubBuckets) return value;
+            const int shift = 63 - __builtin_clzll(value) - SubBits;
+            return (shift + 1) * SubBuckets + ((value >> shift) - SubBuckets);
+        }
+
+        inline static uint64_t upperBound(size_t bucket) noexcept {
+            if (bucket < SubBuckets) return bucket;
+            const int shift = bucket / SubBuckets - 1;
+            return ((bucket % SubBuckets + SubBuckets + 1) << shift) - 1;
+        }
+
+    private:
+        std::array<uint64_t, NumberOfBuckets> counts{};
+        uint64_t count = 0;
+        uint64_t sum = 0;
+        uint64_t max = 0;
+    };
+
+    /**
+     * A phase of the tracing. Only every sampleRate-th run of the phase is timed, the others only count it.
+     */
+    struct TracePhase {
+        std::string name;
+        uint32_t sampleRate = 1;
+    };
+
+    /**
+     * Always-on tracing of the phases of the queries:
+     *  - start(phase) and end(phase) read the time stamp counter, nothing else. Every thread has its own state (found with one thread_local
+     *    comparison), so there is no synchronization at all on the hot path and the tracer can be shared by concurrent queries.
+     *  - Phases that run per node (thousands of times per query) are sampled: between two samples, start and end only count down.
+     *  - The durations go into a histogram per phase and thread, and the last EventsPerThread sampled runs into a ring buffer per thread,
+     *    so the memory is bounded no matter how long the process runs.
+     * The histograms of all threads are merged when they are printed (p50/p90/p99/max), the ring buffers can be exported as
+     * Chrome trace JSON (chrome://tracing, Perfetto). Printing and exporting must not run concurrently with the traced phases.
+     * A phase must not be started again on the same thread before it ended, nesting different phases is fine.
+     */
+    class Tracer {
+        static constexpr size_t EventsPerThread = 1 << 16;
+
+        struct Event {
+            uint32_t phase;
+            uint64_t start;
+            uint64_t duration;
+        };
+
+        struct ThreadState {
+            ThreadState(uint32_t thread, const std::vector<TracePhase>& phases) :
+                    thread(thread),
+                    untilSample(phases.size(), 1),
+                    calls(phases.size(), 0),
+                    openSince(phases.size(), 0),
+                    histograms(phases.size()),
+                    events(EventsPerThread),
+                    numberOfEvents(0) {
+            }
+
+            uint32_t thread;
+            //Countdown to the next sampled run of each phase
+            std::vector<uint32_t> untilSample;
+            std::vector<uint64_t> calls;
+            //The start of the running sample of each phase, 0 if the current run is not sampled
+            std::vector<uint64_t> openSince;
+            std::vector<LatencyHistogram> histograms;
+            std::vector<Event> events;
+            uint64_t numberOfEvents;
+        };
+
+    public:
+        Tracer(const std::string& name, std::vector<TracePhase> phases) :
+                name(name),
+                phases(std::move(phases)),
+                id(nextId()),
+                startTicks(TraceClock::now()),
+                startTime(std::chrono::steady_clock::now()) {
+        }
+
+        Tracer(const Tracer&) = delete;
+        Tracer& operator=(const Tracer&) = delete;
+
+        inline void setSampleRate(uint32_t phase, uint32_t sampleRate) noexcept {
+            phases[phase].sampleRate = std::max<uint32_t>(sampleRate, 1);
+        }
+
+        inline void start(uint32_t phase) noexcept {
+            ThreadState& state = threadState();
+            state.calls[phase]++;
+            if (--state.untilSample[phase] != 0) {
+                state.openSince[phase] = 0;
+                return;
+            }
+            state.untilSample[phase] = phases[phase].sampleRate;
+            state.openSince[phase] = TraceClock::now();
+        }
+
+        inline void end(uint32_t phase) noexcept {
+            ThreadState& state = threadState();
+            const uint64_t since = state.openSince[phase];
+            if (since == 0) return;
+            const uint64_t end = TraceClock::now();
+            state.openSince[phase] = 0;
+            state.histograms[phase].record(end - since);
+            state.events[state.numberOfEvents++ % EventsPerThread] = Event{phase, since, end - since};
+        }
+
+        /**
+         * Prints one line per phase that ran: "TRACE tracer=.. phase=.. calls=.. samples=.. p50=..us p90=..us p99=..us max=..us total=..ms",
+         * where total is the estimated time of all runs (mean of the samples times the calls).
+         */
+        inline void print(std::ostream& out) const {
+            std::lock_guard<std::mutex> lock(mutex);
+            const double ticksPerMicrosecond = calibrate() * 1000;
+            for (size_t phase = 0; phase < phases.size(); phase++) {
+                LatencyHistogram histogram;
+                uint64_t calls = 0;
+                for (const auto& state : states) {
+                    histogram.merge(state->histograms[phase]);
+                    calls += state->calls[phase];
+                }
+                if (calls == 0) continue;
+                out << "TRACE tracer=" << name
+                    << " phase=" << phases[phase].name
+                    << " calls=" << calls
+                    << " samples=" << histogram.size()
+                    << " p50=" << histogram.percentile(0.5) / ticksPerMicrosecond << "us"
+                    << " p90=" << histogram.percentile(0.9) / ticksPerMicrosecond << "us"
+                    << " p99=" << histogram.percentile(0.99) / ticksPerMicrosecond << "us"
+                    << " max=" << histogram.maximum() / ticksPerMicrosecond << "us"
+                    << " total=" << histogram.mean() * calls / ticksPerMicrosecond / 1000 << "ms" << std::endl;
+            }
+        }
+
+        /**
+         * Writes the sampled runs in the ring buffers as Chrome trace JSON ("X" events in microseconds since the creation of the tracer).
+         * Returns false if the file could not be written.
+         */
+        inline bool writeChromeTrace(const std::string& fileName) const {
+            return writeChromeTrace(fileName, {this});
+        }
+
+        /**
+         * Writes the traces of several tracers into one file, each tracer is shown as a process with its name.
+         * The timestamps of all tracers are relative to the creation of the oldest one.
+         */
+        inline static bool writeChromeTrace(const std::string& fileName, const std::vector<const Tracer*>& tracers) {
+            std::ofstream file(fileName);
+            if (!file.is_open()) return false;
+            file << "{\"traceEvents\":[";
+            uint64_t originTicks = UINT64_MAX;
+            for (const Tracer* tracer : tracers) {
+                originTicks = std::min(originTicks, tracer->startTicks);
+            }
+            bool first = true;
+            for (size_t i = 0; i < tracers.size(); i++) {
+                tracers[i]->writeChromeTraceEvents(file, i + 1, originTicks, first);
+            }
+            file << "\n]}" << std::endl;
+            return file.good();
+        }
+
+    private:
+        inline void writeChromeTraceEvents(std::ostream& out, size_t pid, uint64_t originTicks, bool& first) const {
+            std::lock_guard<std::mutex> lock(mutex);
+            const double ticksPerMicrosecond = calibrate() * 1000;
+            out << (first ? "\n" : ",\n")
+                << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"args\":{\"name\":\"" << name << "\"}}";
+            first = false;
+            for (const auto& state : states) {
+                const uint64_t numberOfEvents = std::min<uint64_t>(state->numberOfEvents, EventsPerThread);
+                for (uint64_t i = state->numberOfEvents - numberOfEvents; i < state->numberOfEvents; i++) {
+                    const Event& event = state->events[i % EventsPerThread];
+                    out << ",\n{\"name\":\"" << phases[event.phase].name << "\",\"cat\":\"" << name << "\",\"ph\":\"X\""
+                        << ",\"ts\":" << (event.start - originTicks) / ticksPerMicrosecond
+                        << ",\"dur\":" << event.duration / ticksPerMicrosecond
+                        << ",\"pid\":" << pid << ",\"tid\":" << state->thread << "}";
+                }
+            }
+        }
+
+        inline static uint64_t nextId() noexcept {
+            static std::atomic<uint64_t> ids(1);
+            return ids++;
+        }
+
+        /**
+         * The state of the calling thread. The last one is cached per thread, so only the first call of a thread takes the lock.
+         * The cache is keyed by the id of the tracer, which is never reused.
+         */
+        inline ThreadState& threadState() {
+            struct Cache {
+                uint64_t tracer = 0;
+                ThreadState* state = nullptr;
+            };
+            static thread_local Cache cache;
+            if (cache.tracer == id) return *cache.state;
+            std::lock_guard<std::mutex> lock(mutex);
+            const std::thread::id thread = std::this_thread::get_id();
+            size_t i = 0;
+            while (i < states.size() && threads[i] != thread) i++;
+            if (i == states.size()) {
+                states.emplace_back(std::make_unique<ThreadState>(states.size(), phases));
+                threads.emplace_back(thread);
+            }
+            cache = Cache{id, states[i].get()};
+            return *states[i];
+        }
+
+        /**
+         * Ticks per nanosecond, measured against steady_clock since the creation of the tracer (at least 1ms).
+         */
+        inline double calibrate() const noexcept {
+            std::chrono::steady_clock::time_point now;
+            uint64_t ticks;
+            do {
+                now = std::chrono::steady_clock::now();
+                ticks = TraceClock::now();
+            } while (now - startTime < std::chrono::milliseconds(1));
+            return (ticks - startTicks) / (double) std::chrono::duration_cast<std::chrono::nanoseconds>(now - startTime).count();
+        }
+
+    private:
+        std::string name;
+        std::vector<TracePhase> phases;
+        uint64_t id;
+        uint64_t startTicks;
+        std::chrono::steady_clock::time_point startTime;
+        mutable std::mutex mutex;
+        std::vector<std::unique_ptr<ThreadState>> states;
+        std::vector<std::thread::id> threads;
+    };
+}
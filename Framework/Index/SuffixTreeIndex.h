@@ -0,0 +1,317 @@
+#pragma once
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <span>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+#include "../UkkonenSuffixTree/NodeArena.h"
+#include "../Helpers/MappedFile.h"
+
+namespace Index {
+    using SuffixTree::NodeIndex;
+
+    /**
+     * A suffix tree index is a suffix tree whose query annotations were already computed, stored in one binary file:
+     *
+     *     [Header][text][IndexNode x numberOfNodes][ChildEntry x numberOfChildEntries][NodeIndex x numberOfSortedInnerNodes]
+     *
+     * The file is position-independent: nodes reference each other by NodeIndex (the index is the position in the node section,
+     * which is the position in the NodeArena of the original tree) and their children by an offset relative to the node itself.
+     * Therefore, the file is mapped and queried directly, nothing is read, allocated or fixed up when it is opened.
+     *
+     * The nodes carry the annotation that all queries share (UkkonenSuffixTree/Annotation.h). The query that the index was built for (QueryType)
+     * only decides about the last section:
+     *  - TopK: no sorted inner nodes, the index answers topk queries.
+     *  - Repeat: the inner nodes sorted by RepeatQuery, the index answers repeat and topk queries.
+     * Sections start at multiples of 8 bytes, all values are stored in the byte order of the machine that built the index.
+     */
+    static constexpr char Magic[8] = {'T', 'X', 'T', 'I', 'N', 'D', 'E', 'X'};
+    //Increase for every change of the format.
+    static constexpr uint32_t Version = 2;
+
+    enum class QueryType : uint32_t {
+        TopK = 1,
+        Repeat = 2
+    };
+
+    inline const char* queryTypeName(QueryType queryType) noexcept {
+        return queryType == QueryType::TopK ? "topk" : "repeat";
+    }
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        QueryType queryType;
+        uint32_t characterSize;
+        uint32_t nodeSize;
+        //Length of the text including the sentinel.
+        uint64_t textLength;
+        uint64_t numberOfNodes;
+        uint64_t numberOfChildEntries;
+        uint64_t numberOfSortedInnerNodes;
+        uint64_t textOffset;
+        uint64_t nodesOffset;
+        uint64_t childrenOffset;
+        uint64_t sortedInnerNodesOffset;
+        uint64_t fileSize;
+    };
+
+    /**
+     * One child of a node, the same (key, child) pair that the child containers yield.
+     */
+    template<typename CHAR_TYPE>
+    struct ChildEntry {
+        CHAR_TYPE key;
+        NodeIndex child;
+    };
+
+    /**
+     * The children of an IndexNode, in key order. The entries are found at a fixed distance from the node (in 4-byte words).
+     * Must be the first member of IndexNode, the distance is measured from the start of the node.
+     */
+    template<typename CHAR_TYPE>
+    class IndexChildren {
+        using Entry = ChildEntry<CHAR_TYPE>;
+
+    public:
+        inline const Entry* begin() const noexcept {
+            return reinterpret_cast<const Entry*>(reinterpret_cast<const uint32_t*>(this) + offset);
+        }
+
+        inline const Entry* end() const noexcept {
+            return begin() + count;
+        }
+
+        inline size_t size() const noexcept {
+            return count;
+        }
+
+        inline bool empty() const noexcept {
+            return count == 0;
+        }
+
+    public:
+        int32_t offset;
+        uint32_t count;
+    };
+
+    /**
+     * A node of the index, offers the same members as SuffixTree::Node to the queries.
+     */
+    template<typename CHAR_TYPE>
+    struct IndexNode {
+        inline bool hasChildren() const noexcept {
+            return !children.empty();
+        }
+
+        IndexChildren<CHAR_TYPE> children;
+        int startIndex;
+        int endIndex;
+        int numberOfLeaves;
+        int stringDepth;
+        int representedSuffix;
+    };
+
+    inline constexpr uint64_t alignedOffset(uint64_t offset) noexcept {
+        return (offset + 7) / 8 * 8;
+    }
+
+    /**
+     * Sets the offsets of all sections and the file size from the sizes in the header.
+     */
+    template<typename CHAR_TYPE>
+    inline void computeLayout(Header& header) noexcept {
+        header.textOffset = alignedOffset(sizeof(Header));
+        header.nodesOffset = alignedOffset(header.textOffset + header.textLength * sizeof(CHAR_TYPE));
+        header.childrenOffset = alignedOffset(header.nodesOffset + header.numberOfNodes * sizeof(IndexNode<CHAR_TYPE>));
+        header.sortedInnerNodesOffset = alignedOffset(header.childrenOffset + header.numberOfChildEntries * sizeof(ChildEntry<CHAR_TYPE>));
+        header.fileSize = header.sortedInnerNodesOffset + header.numberOfSortedInnerNodes * sizeof(NodeIndex);
+    }
+
+    /**
+     * Writes the given tree, after the initialization of a query of type queryType, as index to fileName.
+     * For repeat queries, sortedInnerNodes are the inner nodes sorted by the query.
+     * Returns false if the file could not be written.
+     */
+    template<typename TREE>
+    inline bool writeIndex(const std::string& fileName, const TREE& tree, QueryType queryType, const std::vector<NodeIndex>& sortedInnerNodes) {
+        using CharType = std::remove_cv_t<std::remove_pointer_t<decltype(tree.text)>>;
+        using Node = IndexNode<CharType>;
+        using Entry = ChildEntry<CharType>;
+        static_assert(std::is_same_v<typename TREE::Index, int>, "Index files store 32-bit positions, trees of larger texts cannot be stored.");
+        static_assert(std::is_trivially_copyable_v<Node> && std::is_standard_layout_v<Node>, "Index nodes are mapped, they must not need construction.");
+        static_assert(sizeof(Node) % 4 == 0 && sizeof(Entry) % 4 == 0, "Child offsets are measured in 4-byte words.");
+
+        Header header;
+        std::memcpy(header.magic, Magic, sizeof(Magic));
+        header.version = Version;
+        header.queryType = queryType;
+        header.characterSize = sizeof(CharType);
+        header.nodeSize = sizeof(Node);
+        header.textLength = tree.n;
+        header.numberOfNodes = tree.numberOfNodes();
+        header.numberOfChildEntries = 0;
+        for (NodeIndex node = 0; node < header.numberOfNodes; node++) {
+            header.numberOfChildEntries += tree.getNode(node).children.size();
+        }
+        header.numberOfSortedInnerNodes = sortedInnerNodes.size();
+        computeLayout<CharType>(header);
+        //The children of a node must be reachable with a 32-bit word offset.
+        if (header.sortedInnerNodesOffset / 4 > static_cast<uint64_t>(std::numeric_limits<int32_t>::max())) return false;
+
+        std::ofstream file(fileName, std::ios::binary | std::ios::trunc);
+        if (!file) return false;
+        const auto writeAt = [&](uint64_t offset, const void* data, size_t size) {
+            //Zero padding up to the start of the section.
+            static const char Padding[8] = {};
+            file.write(Padding, offset - file.tellp());
+            file.write(reinterpret_cast<const char*>(data), size);
+        };
+        writeAt(0, &header, sizeof(Header));
+        writeAt(header.textOffset, tree.text, header.textLength * sizeof(CharType));
+
+        //The children of all nodes are stored consecutively in node order.
+        uint64_t firstEntry = 0;
+        for (NodeIndex index = 0; index < header.numberOfNodes; index++) {
+            const auto& node = tree.getNode(index);
+            Node indexNode;
+            const uint64_t nodeOffset = header.nodesOffset + index * sizeof(Node);
+            const uint64_t entryOffset = header.childrenOffset + firstEntry * sizeof(Entry);
+            indexNode.children.offset = static_cast<int32_t>((static_cast<int64_t>(entryOffset) - static_cast<int64_t>(nodeOffset)) / 4);
+            indexNode.children.count = node.children.size();
+            indexNode.startIndex = node.startIndex;
+            indexNode.endIndex = node.endIndex;
+            indexNode.numberOfLeaves = node.numberOfLeaves;
+            indexNode.stringDepth = node.stringDepth;
+            indexNode.representedSuffix = node.representedSuffix;
+            writeAt(nodeOffset, &indexNode, sizeof(Node));
+            firstEntry += indexNode.children.count;
+        }
+        writeAt(header.childrenOffset, nullptr, 0);
+        for (NodeIndex index = 0; index < header.numberOfNodes; index++) {
+            for (const auto& [key, child] : tree.getNode(index).children) {
+                Entry entry;
+                //Clear the padding, the file should only depend on the tree.
+                std::memset(&entry, 0, sizeof(Entry));
+                entry.key = key;
+                entry.child = child;
+                file.write(reinterpret_cast<const char*>(&entry), sizeof(Entry));
+            }
+        }
+        writeAt(header.sortedInnerNodesOffset, sortedInnerNodes.data(), sortedInnerNodes.size() * sizeof(NodeIndex));
+        return static_cast<bool>(file);
+    }
+
+    /**
+     * A suffix tree index that is mapped from its file. It offers the same interface to the queries as SuffixTree,
+     * but all nodes are read-only and already annotated.
+     */
+    template<typename CHAR_TYPE>
+    class MappedSuffixTree {
+        using CharType = CHAR_TYPE;
+
+    public:
+        using NodeType = IndexNode<CharType>;
+        //Index files store 32-bit positions and node indices.
+        using Index = int;
+        using NodeIndex = SuffixTree::NodeIndex;
+        static constexpr NodeIndex NoNode = SuffixTree::NoNode;
+        static constexpr NodeIndex Root = 0;
+        //The annotations were computed when the index was built, the queries must not compute them again.
+        static constexpr bool IsAnnotated = true;
+        static constexpr bool IsGrowing = false;
+
+        MappedSuffixTree(const std::string& fileName) :
+                file(fileName),
+                valid(false),
+                text(nullptr),
+                n(0),
+                nodes(nullptr),
+                nodeCount(0) {
+            if (!file.isOpen()) {
+                std::cout << "ERROR: Could not open index file " << fileName << "." << std::endl;
+                return;
+            }
+            const Helpers::TextView contents = file.view();
+            const uint64_t fileSize = contents.length - 1;
+            if (fileSize < sizeof(Header)) {
+                std::cout << "ERROR: " << fileName << " is not an index file." << std::endl;
+                return;
+            }
+            std::memcpy(&header, contents.text, sizeof(Header));
+            if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0) {
+                std::cout << "ERROR: " << fileName << " is not an index file." << std::endl;
+                return;
+            }
+            if (header.version != Version) {
+                std::cout << "ERROR: Index file " << fileName << " has version " << header.version << ", expecting version " << Version << ". Rebuild the index." << std::endl;
+                return;
+            }
+            Header expectedLayout = header;
+            computeLayout<CharType>(expectedLayout);
+            if (header.characterSize != sizeof(CharType) || header.nodeSize != sizeof(NodeType) || header.numberOfNodes == 0
+                    || std::memcmp(&header, &expectedLayout, sizeof(Header)) != 0 || header.fileSize != fileSize) {
+                std::cout << "ERROR: Index file " << fileName << " is corrupt or was built on an incompatible machine." << std::endl;
+                return;
+            }
+            text = reinterpret_cast<const CharType*>(contents.text + header.textOffset);
+            n = header.textLength;
+            nodes = reinterpret_cast<const NodeType*>(contents.text + header.nodesOffset);
+            nodeCount = header.numberOfNodes;
+            sortedInnerNodes = std::span<const NodeIndex>(reinterpret_cast<const NodeIndex*>(contents.text + header.sortedInnerNodesOffset), header.numberOfSortedInnerNodes);
+            valid = true;
+        }
+
+        /**
+         * Checks if the index could be mapped and has the expected format.
+         */
+        inline bool isValid() const noexcept {
+            return valid;
+        }
+
+        /**
+         * The query type whose annotations the index contains.
+         */
+        inline QueryType queryType() const noexcept {
+            return header.queryType;
+        }
+
+        inline const NodeType& getNode(NodeIndex index) const noexcept {
+            return nodes[index];
+        }
+
+        inline size_t numberOfNodes() const noexcept {
+            return nodeCount;
+        }
+
+        /**
+         * Returns the substring of the indexed text with length length starting at startIndex.
+         */
+        inline std::string substring(size_t startIndex, size_t length) const noexcept {
+            return std::string(text + startIndex, length);
+        }
+
+    private:
+        Helpers::MappedFile file;
+        Header header;
+        bool valid;
+
+    public:
+        //The indexed text, including the sentinel.
+        const CharType* text;
+        //Text length
+        int n;
+        //For repeat indices, the inner nodes sorted by RepeatQuery.
+        std::span<const NodeIndex> sortedInnerNodes;
+
+    private:
+        const NodeType* nodes;
+        size_t nodeCount;
+    };
+}
@@ -0,0 +1,208 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <array>
+#include <bit>
+#include <limits>
+#include <algorithm>
+
+#include "../CompressedSuffixTree/CompressedSuffixTree.h"
+
+namespace Query {
+    /**
+     * The repeat query of RepeatQuery.h on the compressed suffix tree.
+     *
+     * The solution is the inner node with the largest string depth l whose interval contains a pair of suffixes p and p + l,
+     * ties broken by bfs order, i.e., by tree depth and then by preorder (the children are in lexicographic order).
+     * The smallest such p is the start of the square.
+     *
+     * Sorting all inner nodes by string depth like SuffixArrayRepeatQuery would need more memory than the compressed tree itself.
+     * Instead, the nodes are processed in bands of string depths from the top, found by scanning the parentheses:
+     *  - A band is either small enough to be collected and sorted, or it is split in half (upper half first).
+     *  - A single string depth with too many nodes is scanned in preorder, keeping the best node so far.
+     * The first band with a pair contains the solution.
+     *
+     * A node is tested in one of two ways, whichever is cheaper:
+     *  - Are there two suffixes p and p + l in its interval? That costs one lookup in the compressed suffix array per suffix.
+     *  - The string s of the node is the a of the square: Backward search of s from the interval of s gives the interval of ss in 2l rank operations.
+     *    Only the suffixes in there are looked up.
+     */
+    template<typename CHAR_TYPE, CHAR_TYPE SENTINEL, typename PROFILER, bool DEBUG = false>
+    class CompressedRepeatQuery {
+        using CharType = CHAR_TYPE;
+        using Profiler = PROFILER;
+        using Tree = CompressedSuffixTree::CompressedSuffixTree<CHAR_TYPE, DEBUG>;
+        using NodeIndex = CompressedSuffixTree::NodeIndex;
+        static const CharType Sentinel = SENTINEL;
+        static const bool Debug = DEBUG;
+
+        struct InnerNode {
+            int depth;//string depth
+            int treeDepth;
+            NodeIndex position;
+            int leftBound;
+        };
+
+    public:
+        CompressedRepeatQuery(const Tree* tree) :
+            tree(tree),
+            maxCollectedNodes(std::max<size_t>(4096, tree->numberOfNodes() / 64)) {
+            //Nothing to collect, see above.
+            profiler.startCollectInnerNodes();
+            profiler.endCollectInnerNodes();
+        }
+
+        /**
+         * Returns the start index and the length of the repetition (length of aa).
+         */
+        inline std::pair<size_t, size_t> runQuery() noexcept {
+            profiler.startActualQuery();
+            bestDepth = 0;
+            bestStart = -1;
+            //The inner nodes by the number of bits of their string depth. The root (string depth 0) cannot contain a square.
+            std::array<size_t, 33> bandSizes{};
+            forEachInnerNode([&](const InnerNode& node) {
+                bandSizes[std::bit_width(static_cast<unsigned>(node.depth))]++;
+            });
+            for (int bits = 32; bits >= 1; bits--) {
+                if (bandSizes[bits] == 0) continue;
+                if (searchBand(int64_t(1) << (bits - 1), int64_t(1) << bits, bandSizes[bits])) break;
+            }
+            profiler.endActualQuery();
+            if (bestStart == -1) return std::make_pair(0, 0);
+            return std::make_pair(bestStart, 2 * bestDepth);
+        }
+
+    private:
+        /**
+         * Calls function for every inner node in preorder.
+         */
+        template<typename FUNCTION>
+        inline void forEachInnerNode(const FUNCTION& function) const noexcept {
+            const CompressedSuffixTree::BalancedParentheses& topology = tree->topology;
+            InnerNode node{0, 0, 0, 0};
+            size_t innerRank = 0;
+            for (NodeIndex position = 0; position < topology.size(); position++) {
+                if (!topology.isOpen(position)) {
+                    node.treeDepth--;
+                    continue;
+                }
+                if (topology.isLeaf(position)) {
+                    node.leftBound++;
+                    position++;
+                    continue;
+                }
+                node.treeDepth++;
+                node.depth = tree->innerNodeDepths.get(innerRank++);
+                node.position = position;
+                function(node);
+            }
+        }
+
+        /**
+         * Searches the size inner nodes with string depths in [low, high) for the solution, returns true if it was found.
+         */
+        inline bool searchBand(const int64_t low, const int64_t high, const size_t size) noexcept {
+            if (size <= maxCollectedNodes) {
+                std::vector<InnerNode> nodes;
+                nodes.reserve(size);
+                forEachInnerNode([&](const InnerNode& node) {
+                    if (node.depth >= low && node.depth < high) nodes.emplace_back(node);
+                });
+                std::sort(nodes.begin(), nodes.end(), [](const InnerNode& left, const InnerNode& right) {
+                    if (left.depth != right.depth) return left.depth > right.depth;
+                    if (left.treeDepth != right.treeDepth) return left.treeDepth < right.treeDepth;
+                    return left.position < right.position;
+                });
+                for (const InnerNode& node : nodes) {
+                    if (testNode(node)) return true;
+                }
+                return false;
+            }
+            if (high - low == 1) {
+                //All nodes have the same string depth. In preorder, only a node with a smaller tree depth can beat the best one so far.
+                int bestTreeDepth = std::numeric_limits<int>::max();
+                forEachInnerNode([&](const InnerNode& node) {
+                    if (node.depth == low && node.treeDepth < bestTreeDepth && testNode(node)) bestTreeDepth = node.treeDepth;
+                });
+                return bestStart != -1;
+            }
+            const int64_t middle = low + (high - low) / 2;
+            size_t upperSize = 0;
+            forEachInnerNode([&](const InnerNode& node) {
+                if (node.depth >= middle && node.depth < high) upperSize++;
+            });
+            if (upperSize > 0 && searchBand(middle, high, upperSize)) return true;
+            return size > upperSize && searchBand(low, middle, size - upperSize);
+        }
+
+        /**
+         * Tests the given node for a pair. If there is one, it becomes the solution and true is returned.
+         */
+        inline bool testNode(const InnerNode& node) noexcept {
+            profiler.startInnerNodePhase();
+            profiler.startPairPhase();
+            const int size = tree->numberOfLeaves(node.position);
+            const int startIndex = (static_cast<int64_t>(size) * tree->csa.sampleRate <= 4 * static_cast<int64_t>(node.depth))
+                ? findPairInInterval(node.leftBound, node.leftBound + size - 1, node.depth)
+                : findPairByBackwardSearch(node.leftBound, node.leftBound + size, node.depth);
+            profiler.endPairPhase();
+            profiler.endInnerNodePhase();
+            if (startIndex == -1) return false;
+            bestDepth = node.depth;
+            bestStart = startIndex;
+            return true;
+        }
+
+        /**
+         * Returns the smallest p among the suffixes with ranks leftBound..rightBound whose suffix p + depth is in there as well, -1 if there is none.
+         * Only the starts of the suffixes are needed: After sorting them, the pairs are found with two pointers.
+         */
+        inline int findPairInInterval(const int leftBound, const int rightBound, const int depth) noexcept {
+            starts.clear();
+            for (int rank = leftBound; rank <= rightBound; rank++) {
+                starts.emplace_back(tree->csa.sa(rank));
+            }
+            std::sort(starts.begin(), starts.end());
+            size_t partner = 0;
+            for (const int start : starts) {
+                while (partner < starts.size() && starts[partner] < start + depth) partner++;
+                if (partner == starts.size()) break;
+                if (starts[partner] == start + depth) return start;
+            }
+            return -1;
+        }
+
+        /**
+         * The same as findPairInInterval for the ranks [begin, end): The suffixes that start with the string s of the node are the ranks begin..end-1,
+         * the ones that start with ss are found by extending them to the left by s.
+         */
+        inline int findPairByBackwardSearch(size_t begin, size_t end, const int depth) const noexcept {
+            const int suffix = tree->csa.sa(begin);
+            for (int i = depth - 1; i >= 0 && begin < end; i--) {
+                tree->csa.extendLeft(tree->text[suffix + i], begin, end);
+            }
+            int startIndex = -1;
+            for (size_t rank = begin; rank < end; rank++) {
+                const int start = tree->csa.sa(rank);
+                if (startIndex == -1 || start < startIndex) startIndex = start;
+            }
+            return startIndex;
+        }
+
+    public:
+        const Tree* tree;
+
+        Profiler profiler;
+
+    private:
+        //The largest band of nodes that is collected and sorted
+        size_t maxCollectedNodes;
+        //The starts of the suffixes of the node that is tested
+        std::vector<int> starts;
+        //The solution found so far
+        int bestDepth = 0;
+        int bestStart = -1;
+    };
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <queue>
+#include <algorithm>
+
+#include "TopKQuery.h"
+#include "../CompressedSuffixTree/CompressedSuffixTree.h"
+
+namespace Query {
+    /**
+     * The topk query of TopKQuery.h on the compressed suffix tree.
+     *
+     * The bfs is the same as in SuffixArrayTopKQuery, so are the candidates and their order. The difference is the cost of the accesses:
+     * Children are found with findClose and the start of a suffix takes up to sampleRate LF steps. Therefore, a candidate only stores
+     * the rank of one of its suffixes, and only the start of the solution is looked up. The start of a leaf is still needed to know whether
+     * its suffix is long enough.
+     */
+    template<typename CHAR_TYPE, CHAR_TYPE SENTINEL, typename PROFILER, bool DEBUG = false>
+    class CompressedTopKQuery {
+        using CharType = CHAR_TYPE;
+        using Profiler = PROFILER;
+        using Tree = CompressedSuffixTree::CompressedSuffixTree<CHAR_TYPE, DEBUG>;
+        using NodeIndex = CompressedSuffixTree::NodeIndex;
+        static const CharType Sentinel = SENTINEL;
+        static const bool Debug = DEBUG;
+
+        /**
+         * A candidate with occurences occurrences, the suffix with rank rank starts with it.
+         */
+        struct RankCandidate {
+            int occurences;
+            int rank;
+        };
+
+    public:
+        //The result of a query for which there are fewer than k substrings of length l.
+        static constexpr int NoSolution = -1;
+
+        CompressedTopKQuery(const Tree* tree) :
+            tree(tree) {
+            //All information that the queries need is already part of the tree.
+            profiler.startInitialization();
+            profiler.endInitialization();
+        }
+
+        /**
+         * Runs a query for the given length l and finds the k-th most frequent substring.
+         * Returns the start index of the substring or NoSolution if there are fewer than k substrings of length l.
+         */
+        inline int runQuery(int l, int k) noexcept {
+            profiler.startNewQuery();
+            if constexpr (Debug) std::cout << "Running topk query with l = " << l << " and k = " << k << std::endl;
+            if (k < 1) {
+                profiler.endCurrentQuery();
+                return NoSolution;
+            }
+
+            profiler.startCollectCandidates();
+            std::vector<RankCandidate> candidates;
+            collectingBfs(candidates, l);
+            profiler.endCollectCandidates();
+
+            profiler.startSortCandidates();
+            //The k-th candidate by descending occurrences, ties in bfs order, as in TopKQuery.
+            const std::vector<size_t> best = TopKQuery<CharType, Sentinel, Profiler, Debug>::selectBest(candidates.size(), k, [&](const size_t left, const size_t right) {
+                if (candidates[left].occurences != candidates[right].occurences) return candidates[left].occurences > candidates[right].occurences;
+                return left < right;
+            });
+            profiler.endSortCandidates();
+            if (best.size() < static_cast<size_t>(k)) {
+                //There are fewer than k distinct substrings of length l.
+                profiler.endCurrentQuery();
+                return NoSolution;
+            }
+
+            profiler.startReconstructSolution();
+            const RankCandidate& solution = candidates[best[k - 1]];
+            const int startPosition = tree->csa.sa(solution.rank);
+            if constexpr (Debug) std::cout << "Found suffix (" << startPosition << ", " << startPosition + l << ") with #occ: " << solution.occurences << std::endl;
+            profiler.endReconstructSolution();
+            profiler.endCurrentQuery();
+            return startPosition;
+        }
+
+        /**
+         * Collects the highest nodes with string depth >= length in bfs order, see TopKQuery::collectingBfs.
+         */
+        inline void collectingBfs(std::vector<RankCandidate>& candidates, const int length) const noexcept {
+            std::queue<NodeIndex> queue;
+            queue.push(tree->root());
+            while (!queue.empty()) {
+                const NodeIndex node = queue.front();
+                queue.pop();
+                if (tree->isLeaf(node)) {
+                    //A leaf is a candidate of its own if its suffix is long enough.
+                    const int rank = tree->leftBound(node);
+                    if (tree->csa.sa(rank) + length < tree->n) candidates.emplace_back(1, rank);
+                } else if (tree->innerNodeDepth(node) >= length) {
+                    candidates.emplace_back(tree->numberOfLeaves(node), tree->leftBound(node));
+                } else {
+                    for (NodeIndex child = tree->firstChild(node); child != CompressedSuffixTree::NoNode; child = tree->nextSibling(child)) {
+                        queue.push(child);
+                    }
+                }
+            }
+        }
+
+    public:
+        const Tree* tree;
+
+        Profiler profiler;
+    };
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+
+#include "../Helpers/Memory.h"
+
+namespace Query {
+    /**
+     * The documents of a generalized suffix tree and the number of distinct documents below every node, following
+     *      - Hui: Color set size problem with applications to string matching (1992)
+     *
+     * The documents are concatenated, each one followed by the separator, the last one by the sentinel. A substring of the text that
+     * contains a separator spans two documents and is not a substring of the collection. All documents share one separator instead of
+     * one distinct separator each, which a byte alphabet does not have for large collections: the tree then also has paths through
+     * the separators, but all substrings that do not span documents are the same. The queries cut every candidate at the end of its
+     * document (documentEnd) and never see the others.
+     *
+     * Counting the documents of every node does not need a set per node:
+     *  - Visit the leaves in dfs order. If the previous leaf of the same document is p, the leaf u and p are both below their lowest common
+     *    ancestor and all nodes above it, so the document is counted twice there: add one duplicate to lca(p, u).
+     *  - Every document with c leaves below a node has c - 1 consecutive pairs below it whose lca is also below it (or the node itself),
+     *    so the number of documents of a node is its number of leaves minus the duplicates in its subtree.
+     * The lca is the deepest node on the current dfs path that was entered before p was visited, a binary search over the entry times of
+     * the path. The pass takes O(n log n) time and one count per node and one leaf rank per document of memory.
+     *
+     * The counts are indexed by the nodes of the tree they were computed on, so a frozen tree needs its own (see FrozenSuffixTree.h).
+     * They are accounted as MemoryComponent::DocumentCounts (Helpers/Memory.h).
+     */
+    template<typename TREE>
+    class DocumentCounts {
+        using Tree = TREE;
+        using NodeIndex = typename Tree::NodeIndex;
+
+        struct StackEntry {
+            NodeIndex node;
+            //True when all children of node were visited.
+            bool leaving;
+        };
+
+        struct PathEntry {
+            NodeIndex node;
+            //The number of leaves visited before the node was entered.
+            size_t entered;
+            //The duplicates in the subtree of the node that were found so far.
+            size_t duplicates;
+        };
+
+    public:
+        using Index = typename Tree::Index;
+        //No leaf of the document was visited yet.
+        static constexpr size_t NoLeaf = static_cast<size_t>(-1);
+
+        /**
+         * Counts the documents of all nodes of the given annotated tree, whose text is the concatenation of documents that start at
+         * documentStarts (ascending, the first one at 0).
+         */
+        DocumentCounts(const Tree& tree, std::vector<Index> documentStarts) :
+                documentStarts(std::move(documentStarts)),
+                textLength(tree.n),
+                counts(tree.numberOfNodes()) {
+            std::vector<size_t> lastLeaf(numberOfDocuments(), NoLeaf);
+            std::vector<PathEntry> path;
+            std::vector<StackEntry> stack;
+            stack.emplace_back(StackEntry{Tree::Root, false});
+            size_t leaves = 0;
+            while (!stack.empty()) {
+                const StackEntry entry = stack.back();
+                stack.pop_back();
+                const auto& node = tree.getNode(entry.node);
+                if (entry.leaving) {
+                    const PathEntry finished = path.back();
+                    path.pop_back();
+                    counts[entry.node] = node.numberOfLeaves - static_cast<Index>(finished.duplicates);
+                    if (!path.empty()) path.back().duplicates += finished.duplicates;
+                    continue;
+                }
+                if (!node.hasChildren()) {
+                    counts[entry.node] = 1;
+                    const size_t document = documentOf(node.representedSuffix);
+                    if (lastLeaf[document] != NoLeaf) {
+                        //The deepest node on the path that was entered before the previous leaf of the document is their lca.
+                        const auto lca = std::upper_bound(path.begin(), path.end(), lastLeaf[document], [](const size_t leaf, const PathEntry& pathEntry) {
+                            return leaf < pathEntry.entered;
+                        }) - 1;
+                        lca->duplicates++;
+                    }
+                    lastLeaf[document] = leaves++;
+                    continue;
+                }
+                path.emplace_back(PathEntry{entry.node, leaves, 0});
+                stack.emplace_back(StackEntry{entry.node, true});
+                //Push the children in reverse order, so that they are visited in lexicographic order.
+                const size_t firstChild = stack.size();
+                for (const auto & [key, child] : node.children) {
+                    stack.emplace_back(StackEntry{child, false});
+                }
+                std::reverse(stack.begin() + firstChild, stack.end());
+            }
+        }
+
+        /**
+         * The number of distinct documents that contain the path label of the given node (or any prefix of it that is a candidate).
+         */
+        inline Index count(NodeIndex node) const noexcept {
+            return counts[node];
+        }
+
+        inline size_t numberOfDocuments() const noexcept {
+            return documentStarts.size();
+        }
+
+        /**
+         * The document that contains the given position of the text.
+         */
+        inline size_t documentOf(Index position) const noexcept {
+            return std::upper_bound(documentStarts.begin(), documentStarts.end(), position) - documentStarts.begin() - 1;
+        }
+
+        /**
+         * The position of the separator (or the sentinel) after the document that contains the given position.
+         * A substring that starts at position has to end before it.
+         */
+        inline Index documentEnd(Index position) const noexcept {
+            const size_t document = documentOf(position);
+            return (document + 1 < numberOfDocuments()) ? documentStarts[document + 1] - 1 : textLength - 1;
+        }
+
+    private:
+        //The start of every document in the text.
+        std::vector<Index> documentStarts;
+        Index textLength;
+        //The number of documents of every node.
+        Helpers::CountedVector<Index, Helpers::MemoryComponent::DocumentCounts> counts;
+    };
+}
@@ -0,0 +1,227 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+#include "../SuffixArray/SuffixArray.h"
+#include "../SuffixArray/LcpIntervalTree.h"
+
+namespace Query {
+    /**
+     * The repeat query in linear time: The length of the longest square is found with the LZ77 factorization of the text
+     * and the crossing squares of Main and Lorentz, following
+     *      - Crochemore: Recherche linéaire d'un carré dans un mot (1983)
+     *      - Main: Detecting leftmost maximal periodicities (1989)
+     *      - Crochemore, Ilie: Computing longest previous factor in linear time and applications (2008) (factorization from the suffix array)
+     *
+     * Let f_1 f_2 ... f_z be the LZ77 factorization: f_i is the longest prefix of the remaining text that starts at an earlier position (or one new character).
+     * Consider the leftmost occurrence of a square aa and the factor f_i that contains its last character:
+     *  - It cannot lie inside f_i, since f_i occurs earlier.
+     *  - Its center cannot lie before f_{i-1}: Then f_{i-1} and the next character would occur |a| positions earlier, so f_{i-1} would be longer.
+     * Therefore, it crosses the start of f_i and |a| <= |f_{i-1}| + |f_i|. All squares that cross the start of f_i within this window are found
+     * with four Z-functions (see crossingSquare), the windows have total length O(n).
+     *
+     * The longest square has the same length as the solution of RepeatQuery. To return the same square, only the lcp-intervals with this lcp are tested
+     * like in SuffixArrayRepeatQuery, in bfs order. They are disjoint, so that takes linear time as well.
+     */
+    template<typename CHAR_TYPE, CHAR_TYPE SENTINEL, typename PROFILER, bool DEBUG = false>
+    class LzRepeatQuery {
+        using CharType = CHAR_TYPE;
+        using Profiler = PROFILER;
+        using Tree = SuffixArray::LcpIntervalTree<CHAR_TYPE, DEBUG>;
+        static const CharType Sentinel = SENTINEL;
+        static const bool Debug = DEBUG;
+
+    public:
+        LzRepeatQuery(const Tree* tree) :
+            tree(tree),
+            text(tree->suffixArray->text),
+            n(tree->n) {
+        }
+
+        /**
+         * Returns the start index and the length of the repetition (length of aa).
+         */
+        inline std::pair<size_t, size_t> runQuery() noexcept {
+            profiler.startActualQuery();
+            profiler.startCollectInnerNodes();
+            computeFactorization();
+            profiler.endCollectInnerNodes();
+            profiler.startInnerNodePhase();
+            int half = 0;
+            for (size_t i = 1; i < factorStarts.size(); i++) {
+                const int previousStart = factorStarts[i - 1];
+                const int start = factorStarts[i];
+                const int end = (i + 1 < factorStarts.size()) ? factorStarts[i + 1] : n;
+                const int windowStart = std::max(0, previousStart - (end - previousStart));
+                half = std::max(half, crossingSquare(windowStart, start, end));
+            }
+            profiler.endInnerNodePhase();
+            if constexpr (Debug) std::cout << "Longest square has half length " << half << ", " << factorStarts.size() << " factors." << std::endl;
+            std::pair<size_t, size_t> result(0, 0);
+            if (half > 0) {
+                profiler.startPairPhase();
+                result = firstSquare(half);
+                profiler.endPairPhase();
+            }
+            profiler.endActualQuery();
+            return result;
+        }
+
+    private:
+        /**
+         * Computes the start positions of the LZ77 factors (with self-reference).
+         * The longest previous factor at position j is the longer lcp of suffix j with the closest suffixes in the suffix array
+         * (before and after it) that start before j. The lcps are computed by comparing characters, the total is linear since the factors are disjoint.
+         */
+        inline void computeFactorization() noexcept {
+            const std::vector<int>& sa = tree->suffixArray->sa;
+            //previous[j] and next[j]: the closest suffixes before / after suffix j in the suffix array that start before j, -1 if there is none.
+            std::vector<int> previous(n, -1);
+            std::vector<int> next(n, -1);
+            std::vector<int> stack;
+            for (int rank = 0; rank < n; rank++) {
+                const int suffix = sa[rank];
+                while (!stack.empty() && stack.back() > suffix) {
+                    next[stack.back()] = suffix;
+                    stack.pop_back();
+                }
+                if (!stack.empty()) previous[suffix] = stack.back();
+                stack.emplace_back(suffix);
+            }
+            std::vector<int>().swap(stack);
+            factorStarts.clear();
+            for (int j = 0; j < n;) {
+                factorStarts.emplace_back(j);
+                const int length = std::max(commonPrefix(previous[j], j), commonPrefix(next[j], j));
+                j += std::max(length, 1);
+            }
+        }
+
+        /**
+         * The length of the longest common prefix of the suffixes earlier < j and j, 0 if earlier is -1.
+         */
+        inline int commonPrefix(const int earlier, const int j) const noexcept {
+            if (earlier == -1) return 0;
+            int length = 0;
+            while (j + length < n && text[earlier + length] == text[j + length]) length++;
+            return length;
+        }
+
+        /**
+         * Returns the largest |a| of a square aa in text[windowStart..windowEnd) that contains the characters at split - 1 and split, 0 if there is none.
+         * With u = text[windowStart..split) and v = text[split..windowEnd), a square with |a| = l starting at x is either
+         *  - centered in v (x + l >= split): text[x..split) is a common suffix of u and text[..split + l) and text[split..x + l) a common prefix of v and v[l..], or
+         *  - centered in u (x + l < split): text[x + l..split) is a common suffix of u and u[..split - l) and text[split..x + 2l) a common prefix of v and text[split - l..split).
+         * All four lengths are given by Z-functions, see
+         *      - Main, Lorentz: An O(n log n) algorithm for finding all repetitions in a string (1984)
+         */
+        inline int crossingSquare(const int windowStart, const int split, const int windowEnd) noexcept {
+            const int nu = split - windowStart;
+            const int nv = windowEnd - split;
+            //u reversed and v as integers, -1 separates two strings in a Z-function input.
+            const auto uReversed = [&](int i) { return static_cast<int>(text[split - 1 - i]); };
+            const auto vForward = [&](int i) { return static_cast<int>(text[split + i]); };
+            //Z-function of v: common prefix of v and v[l..].
+            computeZ(zv, nv, vForward);
+            //Z-function of reversed u: common suffix of u and u[..split - l).
+            computeZ(zu, nu, uReversed);
+            //Z-function of reversed u # reversed v: common suffix of u and text[..split + l) (the latter within v).
+            computeZ(zuv, nu + 1 + nv, [&](int i) {
+                if (i < nu) return uReversed(i);
+                if (i == nu) return -1;
+                return static_cast<int>(text[windowEnd - 1 - (i - nu - 1)]);
+            });
+            //Z-function of v # u: common prefix of v and text[split - l..split).
+            computeZ(zvu, nv + 1 + nu, [&](int i) {
+                if (i < nv) return vForward(i);
+                if (i == nv) return -1;
+                return static_cast<int>(text[windowStart + (i - nv - 1)]);
+            });
+            const auto valueAt = [](const std::vector<int>& z, int i) {
+                return (i >= 0 && i < static_cast<int>(z.size())) ? z[i] : 0;
+            };
+            int best = 0;
+            //Centered in v, l - k2 <= |text[x..split)| <= min(l, k1) and at least 1.
+            for (int l = nv; l > best; l--) {
+                const int k1 = valueAt(zuv, nu + 1 + (nv - l));
+                const int k2 = valueAt(zv, l);
+                if (std::max(1, l - k2) <= std::min(l, k1)) best = l;
+            }
+            //Centered in u, l - k2 <= |text[x + l..split)| <= min(l - 1, k1) and at least 1.
+            for (int l = nu; l > best; l--) {
+                const int k1 = valueAt(zu, l);
+                const int k2 = valueAt(zvu, nv + 1 + (nu - l));
+                if (std::max(1, l - k2) <= std::min(l - 1, k1)) best = l;
+            }
+            return best;
+        }
+
+        /**
+         * Computes the Z-function of the string of the given length whose characters are returned by at:
+         * z[i] is the length of the longest common prefix of the string and its suffix i, z[0] = length.
+         */
+        template<typename AT>
+        static inline void computeZ(std::vector<int>& z, const int length, const AT& at) noexcept {
+            z.assign(length, 0);
+            if (length == 0) return;
+            z[0] = length;
+            for (int i = 1, left = 0, right = 0; i < length; i++) {
+                if (i < right) z[i] = std::min(right - i, z[i - left]);
+                while (i + z[i] < length && at(z[i]) == at(i + z[i])) z[i]++;
+                if (i + z[i] > right) {
+                    left = i;
+                    right = i + z[i];
+                }
+            }
+        }
+
+        /**
+         * Finds the first lcp-interval with the given lcp in bfs order that contains a pair p, p + lcp and returns the smallest such p,
+         * exactly as SuffixArrayRepeatQuery does for the first lcp that has such a pair.
+         */
+        inline std::pair<size_t, size_t> firstSquare(const int half) const noexcept {
+            const std::vector<int>& sa = tree->suffixArray->sa;
+            const std::vector<int>& inverseSa = tree->suffixArray->inverseSa;
+            //The vector itself is the bfs queue. Intervals with lcp >= half have no children of interest.
+            std::vector<SuffixArray::ChildIndex> queue;
+            queue.emplace_back(tree->root);
+            for (size_t i = 0; i < queue.size(); i++) {
+                const SuffixArray::Interval& interval = tree->intervals[queue[i]];
+                if (interval.lcp == half) {
+                    int startIndex = -1;
+                    for (int rank = interval.leftBound; rank <= interval.rightBound; rank++) {
+                        const int suffix = sa[rank];
+                        if (suffix + half >= n) continue;
+                        const int partnerRank = inverseSa[suffix + half];
+                        if (partnerRank >= interval.leftBound && partnerRank <= interval.rightBound && (startIndex == -1 || suffix < startIndex)) {
+                            startIndex = suffix;
+                        }
+                    }
+                    if (startIndex != -1) return std::make_pair(startIndex, 2 * half);
+                    continue;
+                }
+                if (interval.lcp > half) continue;
+                for (const SuffixArray::ChildIndex* child = tree->childrenOfBegin(queue[i]); child != tree->childrenOfEnd(queue[i]); child++) {
+                    if (!Tree::isLeaf(*child)) queue.emplace_back(*child);
+                }
+            }
+            return std::make_pair(0, 0);
+        }
+
+    public:
+        const Tree* tree;
+        const CharType* text;
+        //Text length, including the sentinel
+        int n;
+        //Start positions of the LZ77 factors
+        std::vector<int> factorStarts;
+
+        Profiler profiler;
+
+    private:
+        //Buffers for the Z-functions of one window
+        std::vector<int> zu, zv, zuv, zvu;
+    };
+}
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+#include <cstddef>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "../UkkonenSuffixTree/SuffixTree.h"
+#include "../UkkonenSuffixTree/Node.h"
+
+namespace Query {
+    /**
+     * Counts and locates the occurrences of a pattern P in the text of a suffix tree.
+     *
+     * The occurrences of P are the suffixes that start with P, so they are the leaves below the highest node whose path label starts with P:
+     *  - From the root, the child for the next character of P is found with getChild, and the edge into it is compared to the next characters of P,
+     *    16 characters at once with SSE2 (see commonPrefixLength). A mismatch means that P does not occur. This takes O(|P|) time.
+     *  - count returns the number of leaves below that node (the shared annotation, see UkkonenSuffixTree/Annotation.h), O(|P|) in total.
+     *  - locate returns the leaves below the node as Occurrences, which enumerates them lazily with a dfs, O(|P| + occ) for all of them.
+     * Neither the tree nor the query are modified, so any number of threads may run queries concurrently.
+     *
+     * The query needs the edges of the tree (startIndex, endIndex) and the child lookup by character, so it runs on the suffix tree
+     * as it was constructed, not on the frozen tree or an index.
+     */
+    template<typename CHAR_TYPE, bool DEBUG = false, typename CHILDREN = SuffixTree::AdaptiveChildren<CHAR_TYPE>, typename INDEX = int, typename TREE = SuffixTree::SuffixTree<CHAR_TYPE, DEBUG, CHILDREN, INDEX>>
+    class PatternQuery {
+        using CharType = CHAR_TYPE;
+        using Tree = TREE;
+        using NodeType = typename Tree::NodeType;
+        using NodeIndex = typename Tree::NodeIndex;
+        static const bool Debug = DEBUG;
+        static_assert(std::is_same_v<INDEX, typename Tree::Index>, "The query must use the position type of the tree.");
+
+    public:
+        using Index = INDEX;
+
+        /**
+         * The start positions of the occurrences of a pattern, enumerated lazily in the lexicographic order of their suffixes.
+         * Only the path from the node of the pattern to the current leaf is kept on the stack, so stopping early costs nothing.
+         */
+        class Occurrences {
+        public:
+            Occurrences(const Tree* tree, NodeIndex node) :
+                    tree(tree),
+                    total((node == Tree::NoNode) ? 0 : tree->getNode(node).numberOfLeaves) {
+                if (node != Tree::NoNode) stack.emplace_back(node);
+            }
+
+            /**
+             * The number of all occurrences, including those that next already returned.
+             */
+            inline Index size() const noexcept {
+                return total;
+            }
+
+            /**
+             * Sets position to the start of the next occurrence. Returns false if there are no more occurrences.
+             */
+            inline bool next(Index& position) {
+                while (!stack.empty()) {
+                    const NodeType& node = tree->getNode(stack.back());
+                    stack.pop_back();
+                    if (!node.hasChildren()) {
+                        position = node.representedSuffix;
+                        return true;
+                    }
+                    //Push the children in reverse order, so that they are visited in lexicographic order.
+                    const size_t firstChild = stack.size();
+                    for (const auto & [key, child] : node.children) {
+                        stack.emplace_back(child);
+                    }
+                    std::reverse(stack.begin() + firstChild, stack.end());
+                }
+                return false;
+            }
+
+        private:
+            const Tree* tree;
+            Index total;
+            std::vector<NodeIndex> stack;
+        };
+
+        /**
+         * Generates a new query, the tree is annotated if that has not happened yet (only numberOfLeaves and representedSuffix are used).
+         */
+        PatternQuery(Tree* tree) :
+            tree(tree) {
+            if constexpr (!Tree::IsAnnotated) tree->annotate();
+        }
+
+        /**
+         * The number of occurrences of the pattern of the given length in the text.
+         */
+        inline Index count(const CharType* pattern, size_t length) const noexcept {
+            const NodeIndex node = find(pattern, length);
+            return (node == Tree::NoNode) ? 0 : tree->getNode(node).numberOfLeaves;
+        }
+
+        /**
+         * The start positions of all occurrences of the pattern of the given length in the text.
+         */
+        inline Occurrences locate(const CharType* pattern, size_t length) const {
+            return Occurrences(tree, find(pattern, length));
+        }
+
+        /**
+         * Returns the highest node whose path label starts with the pattern of the given length, or NoNode if the pattern does not occur.
+         * The pattern ends on the edge into the node (or at the node).
+         */
+        inline NodeIndex find(const CharType* pattern, size_t length) const noexcept {
+            //The dense child containers only have slots for the characters of the text's alphabet.
+            if constexpr (requires { typename CHILDREN::Alphabet; }) {
+                if (!CHILDREN::Alphabet::contains(pattern, length)) return Tree::NoNode;
+            }
+            NodeIndex index = Tree::Root;
+            size_t matched = 0;
+            while (matched < length) {
+                const NodeIndex child = tree->getNode(index).getChild(pattern[matched]);
+                if (child == Tree::NoNode) return Tree::NoNode;
+                const NodeType& node = tree->getNode(child);
+                //The edge of a leaf ends with the sentinel, which no pattern contains, so it never matches beyond the text.
+                const size_t compared = std::min<size_t>(node.getSubstringLength(tree->currentEnd), length - matched);
+                if (commonPrefixLength(tree->text + node.startIndex, pattern + matched, compared) < compared) return Tree::NoNode;
+                matched += compared;
+                index = child;
+            }
+            return index;
+        }
+
+        /**
+         * The length of the longest common prefix of left and right, at most length.
+         * For single-byte characters, 16 characters are compared at once and the first mismatch is found in the movemask.
+         * Only whole blocks of 16 characters within length are loaded, so nothing behind the text or the pattern is read.
+         */
+        inline static size_t commonPrefixLength(const CharType* left, const CharType* right, size_t length) noexcept {
+            size_t i = 0;
+#ifdef __SSE2__
+            if constexpr (sizeof(CharType) == 1) {
+                for (; i + 16 <= length; i += 16) {
+                    const __m128i leftBlock = _mm_loadu_si128(reinterpret_cast<const __m128i*>(left + i));
+                    const __m128i rightBlock = _mm_loadu_si128(reinterpret_cast<const __m128i*>(right + i));
+                    const unsigned mismatches = ~static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(leftBlock, rightBlock))) & 0xFFFF;
+                    if (mismatches != 0) return i + __builtin_ctz(mismatches);
+                }
+            }
+#endif
+            for (; i < length; i++) {
+                if (left[i] != right[i]) return i;
+            }
+            return length;
+        }
+
+    public:
+        //The suffix tree.
+        Tree* tree;
+    };
+}
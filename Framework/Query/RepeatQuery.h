@@ -7,6 +7,8 @@
 
 #include "../UkkonenSuffixTree/SuffixTree.h"
 #include "../UkkonenSuffixTree/Node.h"
+#include "../Helpers/ThreadPool.h"
+#include "../Helpers/Memory.h"
 
 namespace Query {
     /**
@@ -34,12 +36,21 @@ namespace Query {
      *  - Because we consider inner nodes by descending string depth, the first witness is the result.
      *  - Return the suffix start position.
      */
-    template<typename CHAR_TYPE, CHAR_TYPE SENTINEL, typename PROFILER, bool DEBUG = false>
+    template<typename CHAR_TYPE, CHAR_TYPE SENTINEL, typename PROFILER, bool DEBUG = false, typename CHILDREN = SuffixTree::AdaptiveChildren<CHAR_TYPE>, typename INDEX = int, typename TREE = SuffixTree::SuffixTree<CHAR_TYPE, DEBUG, CHILDREN, INDEX>>
     class RepeatQuery {
         using CharType = CHAR_TYPE;
         using Profiler = PROFILER;
+        using Children = CHILDREN;
+        using Tree = TREE;//The suffix tree, its frozen copy (see UkkonenSuffixTree/FrozenSuffixTree.h) or a mapped index of it (see Index/SuffixTreeIndex.h).
+        using NodeType = typename Tree::NodeType;
+        using Index = INDEX;//The position type of the tree, see SuffixTree.h.
+        using NodeIndex = typename Tree::NodeIndex;
+        //A sorted list of the suffixes below an inner node.
+        using SuffixList = Helpers::CountedVector<size_t, Helpers::MemoryComponent::SuffixLists>;
         static const CharType Sentinel = SENTINEL;
         static const bool Debug = DEBUG;
+        //Minimum number of inner nodes per task of the parallel query.
+        static constexpr size_t MinNodesPerTask = 64;
 
     public:
         /**
@@ -48,21 +59,29 @@ namespace Query {
          * generation if my suffix tree would be used only for this query type.
          * Therefore, they are here and counted as preprocessing time.
          */
-        RepeatQuery(SuffixTree::SuffixTree<CharType, Debug>* tree) :
+        RepeatQuery(Tree* tree) :
             tree(tree) {
-            //precompute number of leaves under each node.
-            profiler.startStringDepth();
-            calculateStringDepths();
-            profiler.endStringDepth();
-            //collect all inner nodes in sorted order
+            if constexpr (!Tree::IsAnnotated) {
+                //precompute the string depth of each node, shared with the other queries on the tree.
+                profiler.startStringDepth();
+                tree->annotate();
+                profiler.endStringDepth();
+            }
             profiler.startCollectInnerNodes();
-            collectInnerNodes();
+            if constexpr (requires { tree->sortedInnerNodes; }) {
+                //A mapped index already contains the sorted inner nodes.
+                sortedInnerNodes.assign(tree->sortedInnerNodes.begin(), tree->sortedInnerNodes.end());
+                rankInnerNodes();
+            } else {
+                //collect all inner nodes in sorted order
+                collectInnerNodes();
+            }
             profiler.endCollectInnerNodes();
             if constexpr (Debug) {
                 std::cout << std::endl << std::endl << std::endl << "Done with query preprocessing. Tree is:" << std::endl;
-                tree->root.print(4);
-                for (SuffixTree::Node<CharType>* innerNode : sortedInnerNodes) {
-                    std::cout << "d=" << innerNode->stringDepth << ",c=" << tree->text[innerNode->startIndex] << std::endl;
+                tree->printNode(tree->Root, 4);
+                for (const NodeIndex innerNode : sortedInnerNodes) {
+                    std::cout << "d=" << tree->getNode(innerNode).stringDepth << ",c=" << tree->text[tree->getNode(innerNode).startIndex] << std::endl;
                 }
                 std::cout << std::endl;
             }
@@ -77,16 +96,17 @@ namespace Query {
         inline std::pair<size_t, size_t> runQuery() noexcept {
             profiler.startActualQuery();
             //iterate over all inner nodes, they are already in sorted order.
-            for (SuffixTree::Node<CharType>* innerNode : sortedInnerNodes) {
+            for (const NodeIndex innerNodeIndex : sortedInnerNodes) {
+                const NodeType* innerNode = &tree->getNode(innerNodeIndex);
                 profiler.startInnerNodePhase();
                 //get all the suffixes below the inner node using the DP-merging approach described above
                 profiler.startMergePhase();
-                collectSuffixesBelow(innerNode);
-                std::vector<size_t> leaves = suffixesBelowInnerNode[innerNode->representedSuffix];
+                collectSuffixesBelow(innerNodeIndex);
+                const SuffixList& leaves = suffixesBelowInnerNode[rankOfInnerNode[innerNodeIndex]];
                 profiler.endMergePhase();
                 profiler.startPairPhase();
                 //find a pair of suffix indices below innerNode whose difference is the innerNode's string depth.
-                int startIndex = findPair(leaves, innerNode->stringDepth);
+                Index startIndex = findPair(leaves, innerNode->stringDepth);
                 profiler.endPairPhase();
                 if (startIndex != -1) {
                     profiler.endInnerNodePhase();
@@ -101,12 +121,49 @@ namespace Query {
             return std::make_pair(0, 0);
         }
 
+        /**
+         * The same query with the inner nodes of one string depth (a depth band) processed concurrently on the thread pool.
+         * The nodes of a band are independent: the lists of their children were completed in earlier bands and each node writes only its own list.
+         * After a band, the first of its nodes in the sorted order that has a pair is the solution, just as in the sequential query.
+         */
+        inline std::pair<size_t, size_t> runQuery(Helpers::ThreadPool& pool) noexcept {
+            profiler.startActualQuery();
+            //Start index of the pair of each node of the current band, -1 if it has none.
+            std::vector<Index> startIndices;
+            for (size_t first = 0; first < sortedInnerNodes.size();) {
+                const Index depth = tree->getNode(sortedInnerNodes[first]).stringDepth;
+                //The root cannot contain a pair.
+                if (depth == 0) break;
+                size_t last = first;
+                while (last < sortedInnerNodes.size() && tree->getNode(sortedInnerNodes[last]).stringDepth == depth) last++;
+                startIndices.assign(last - first, -1);
+                //Small bands are not worth waking up the threads, they run as a single task.
+                const size_t numberOfTasks = std::min(4 * pool.size(), (last - first + MinNodesPerTask - 1) / MinNodesPerTask);
+                const size_t nodesPerTask = (last - first + numberOfTasks - 1) / numberOfTasks;
+                pool.parallelFor(numberOfTasks, [&](size_t task, size_t) {
+                    for (size_t i = first + task * nodesPerTask; i < std::min(last, first + (task + 1) * nodesPerTask); i++) {
+                        collectSuffixesBelow(sortedInnerNodes[i]);
+                        startIndices[i - first] = findPair(suffixesBelowInnerNode[rankOfInnerNode[sortedInnerNodes[i]]], depth);
+                    }
+                });
+                for (const Index startIndex : startIndices) {
+                    if (startIndex != -1) {
+                        profiler.endActualQuery();
+                        return std::make_pair(startIndex, 2 * depth);
+                    }
+                }
+                first = last;
+            }
+            profiler.endActualQuery();
+            return std::make_pair(0, 0);
+        }
+
         /**
          * In the sorted list of suffix indices leaves, finds a pair of values with the given difference, if it exists.
          *
          * Returns if a result was found and the lexicographically smaller suffix index
          */
-        inline int findPair(std::vector<size_t> &leaves, size_t difference) const noexcept {
+        inline Index findPair(const SuffixList& leaves, size_t difference) const noexcept {
             /**
              * Instead of the simple O(n log n)-approach (for each element, binary-search for the counterpart),
              * I use this O(n) algorithm that I found at
@@ -143,16 +200,16 @@ namespace Query {
          * Therefore, it is sufficient to iteratively merge all those lists.
          * This could probably be made more efficient using k-way merging, but I don't have that much time for now.
          *
-         * The resulting list will be stored into suffixesBelowInnerNode[innerNode->representedSuffix]
+         * The resulting list will be stored into suffixesBelowInnerNode[rankOfInnerNode[innerNodeIndex]]
          */
-        inline void collectSuffixesBelow(SuffixTree::Node<CharType>* innerNode) noexcept {
-            std::vector<size_t> suffixes;
+        inline void collectSuffixesBelow(const NodeIndex innerNodeIndex) noexcept {
+            SuffixList suffixes;
             //index of the list in suffixesBelowInnerNode that the list must be stored in
-            const size_t currentIndex = innerNode->representedSuffix;
-            for (const auto & [key, child] : innerNode->children) {
-                if (child->hasChildren()) {
+            const size_t currentIndex = rankOfInnerNode[innerNodeIndex];
+            for (const auto & [key, child] : tree->getNode(innerNodeIndex).children) {
+                if (tree->getNode(child).hasChildren()) {
                     //child is inner node, reuse previously generated list and merge with current list
-                    const size_t childIndex = child->representedSuffix;
+                    const size_t childIndex = rankOfInnerNode[child];
                     suffixes.clear();
                     //merge the two lists into suffixes
                     std::merge(suffixesBelowInnerNode[currentIndex].begin(), suffixesBelowInnerNode[currentIndex].end(), suffixesBelowInnerNode[childIndex].begin(), suffixesBelowInnerNode[childIndex].end(), std::back_inserter(suffixes));
@@ -161,7 +218,8 @@ namespace Query {
                     std::copy(suffixes.begin(), suffixes.end(), std::back_inserter(suffixesBelowInnerNode[currentIndex]));
                 } else {
                     //child is leaf, insert its suffix only.
-                    suffixesBelowInnerNode[currentIndex].insert(std::upper_bound(suffixesBelowInnerNode[currentIndex].begin(), suffixesBelowInnerNode[currentIndex].end(), child->representedSuffix), child->representedSuffix);
+                    const size_t childSuffix = tree->getNode(child).representedSuffix;
+                    suffixesBelowInnerNode[currentIndex].insert(std::upper_bound(suffixesBelowInnerNode[currentIndex].begin(), suffixesBelowInnerNode[currentIndex].end(), childSuffix), childSuffix);
                 }
             }
         }
@@ -173,14 +231,15 @@ namespace Query {
             //reserve sufficient space to avoid reallocation
             sortedInnerNodes.reserve(tree->n);
             //start bfs in the tree (needed to preserve lexicographic order)
-            std::queue<SuffixTree::Node<CharType>*> queue;
-            queue.push(&tree->root);
+            std::queue<NodeIndex> queue;
+            queue.push(tree->Root);
             while (!queue.empty()) {
-                SuffixTree::Node<CharType>* node = queue.front();
+                const NodeIndex index = queue.front();
+                const NodeType* node = &tree->getNode(index);
                 queue.pop();
                 if (node->hasChildren()) {
                     //inner node, enter as inner node
-                    sortedInnerNodes.emplace_back(node);
+                    sortedInnerNodes.emplace_back(index);
                     //enqueue the children
                     for (const auto & [key, child] : node->children) {
                         queue.push(child);
@@ -191,44 +250,34 @@ namespace Query {
             //reduce container size to save some time during stable-sort
             sortedInnerNodes.shrink_to_fit();
             //stable-sort by suffix depths (descending), stable-sort to preserve lexicographic ordering
-            std::stable_sort(sortedInnerNodes.begin(), sortedInnerNodes.end(), [](const SuffixTree::Node<CharType>* left, const SuffixTree::Node<CharType>* right){
-                return left->stringDepth > right->stringDepth;
+            std::stable_sort(sortedInnerNodes.begin(), sortedInnerNodes.end(), [&](const NodeIndex left, const NodeIndex right){
+                return tree->getNode(left).stringDepth > tree->getNode(right).stringDepth;
             });
-            //prepare DP-memory container size
-            suffixesBelowInnerNode.resize(sortedInnerNodes.size());
-                for (size_t i = 0; i < sortedInnerNodes.size(); i++) {
-                    sortedInnerNodes[i]->representedSuffix = i;
-                }
-        }
-
-        /**
-         * Annotates every node with its string depth.
-         */
-        inline void calculateStringDepths() noexcept {
-            stringDepthDfs(&tree->root, 0);
+            rankInnerNodes();
         }
 
         /**
-         * Recursively annotates each node with its string depth using depth first search.
-         *
-         * Annotates each node with the suffix it represents. That will be used as ID  to access
-         * the precomputed list of suffixes below inner nodes during the dynamic program part.
+         * Numbers the inner nodes by their position in sortedInnerNodes. The rank is the ID of the list of suffixes below the node
+         * in the dynamic program, and prepares the DP-memory container size.
          */
-        inline void stringDepthDfs(SuffixTree::Node<CharType>* node, size_t depth) noexcept {
-            node->stringDepth = depth + *node->endIndex - node->startIndex;
-            node->representedSuffix = *node->endIndex - node->stringDepth;
-            for (const auto & [key, child] : node->children) {
-                stringDepthDfs(child, node->stringDepth);
+        inline void rankInnerNodes() {
+            rankOfInnerNode.assign(tree->numberOfNodes(), 0);
+            for (size_t i = 0; i < sortedInnerNodes.size(); i++) {
+                rankOfInnerNode[sortedInnerNodes[i]] = i;
             }
+            suffixesBelowInnerNode.resize(sortedInnerNodes.size());
         }
 
     public:
-        SuffixTree::SuffixTree<CharType, Debug>* tree;
+        Tree* tree;
         //List of all inner nodes, sorted by their string depths
-        std::vector<SuffixTree::Node<CharType>*> sortedInnerNodes;
+        std::vector<NodeIndex> sortedInnerNodes;
+        //The position of every inner node in sortedInnerNodes (0 for leaves). Kept here instead of in the nodes, whose annotations are shared with the other queries.
+        std::vector<NodeIndex> rankOfInnerNode;
         //Memory-vector for the dynamic program for suffix-collection.
-        //If it was computed, the list of suffixes for an innerNode is accessible at suffixesBelowInnerNode[innerNode->representedSuffix]
-        std::vector<std::vector<size_t>> suffixesBelowInnerNode;
+        //If it was computed, the list of suffixes for an innerNode is accessible at suffixesBelowInnerNode[rankOfInnerNode[innerNode]]
+        //The lists are accounted as MemoryComponent::SuffixLists (Helpers/Memory.h).
+        Helpers::CountedVector<SuffixList, Helpers::MemoryComponent::SuffixLists> suffixesBelowInnerNode;
 
         Profiler profiler;
     };
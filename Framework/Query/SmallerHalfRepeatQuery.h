@@ -0,0 +1,272 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+
+#include "../UkkonenSuffixTree/SuffixTree.h"
+#include "../UkkonenSuffixTree/Node.h"
+#include "../Helpers/ThreadPool.h"
+
+namespace Query {
+    /**
+     * The repeat query of RepeatQuery.h with the smaller-half trick of Stoye and Gusfield
+     * (Stoye, Gusfield: Simple and flexible detection of contiguous repeats using a suffix tree, 1998) instead of merged suffix lists.
+     * It returns the same square as RepeatQuery.
+     *
+     * As in RepeatQuery, a square aa with |a| = d starts at p iff the suffixes p and p + d are both below the inner node with
+     * string depth d and path label a. Here, the suffixes below a node are not collected at all:
+     *  - A dfs numbers the leaves in lexicographic order (their rank). The leaves below a node have consecutive ranks, so checking if a suffix is below
+     *    a node takes constant time with the rank of each suffix.
+     *  - A square is branching if the suffixes p and p + d are below different children of the node. Every branching square has one of its two suffixes below a child
+     *    that is not the child with the most leaves, so it is found by testing only the suffixes below the smaller children (both p + d and p - d).
+     *    Every suffix is below a smaller child of at most log n of its ancestors, so testing all nodes takes O(n log n) time.
+     *  - Every square that is not branching can be shifted to the right within its run until it is branching, which yields a square of the same length.
+     *    Therefore, the largest string depth d of a node with a branching square is the length of the solution.
+     *  - Only for the nodes with string depth d, all suffixes are tested to find the same square as RepeatQuery: The first of these nodes in bfs order
+     *    that has a square and the smallest start position of a square below it. These nodes are disjoint, so that takes O(n) time.
+     *
+     * The memory is linear: the ranks, the suffixes by rank and the rank ranges of all nodes.
+     */
+    template<typename CHAR_TYPE, CHAR_TYPE SENTINEL, typename PROFILER, bool DEBUG = false, typename CHILDREN = SuffixTree::AdaptiveChildren<CHAR_TYPE>, typename INDEX = int, typename TREE = SuffixTree::SuffixTree<CHAR_TYPE, DEBUG, CHILDREN, INDEX>>
+    class SmallerHalfRepeatQuery {
+        using CharType = CHAR_TYPE;
+        using Profiler = PROFILER;
+        using Children = CHILDREN;
+        using Tree = TREE;//The suffix tree or its frozen copy (see UkkonenSuffixTree/FrozenSuffixTree.h).
+        using NodeType = typename Tree::NodeType;
+        using Index = INDEX;//The position type of the tree, see SuffixTree.h.
+        using NodeIndex = typename Tree::NodeIndex;
+        static const CharType Sentinel = SENTINEL;
+        static const bool Debug = DEBUG;
+        //Minimum number of inner nodes per task of the parallel query.
+        static constexpr size_t MinNodesPerTask = 64;
+
+    public:
+        /**
+         * Numbers the leaves and sorts the inner nodes by string depth. Counted as preprocessing, like for RepeatQuery.
+         */
+        SmallerHalfRepeatQuery(Tree* tree) :
+            tree(tree) {
+            profiler.startStringDepth();
+            if constexpr (!Tree::IsAnnotated) tree->annotate();
+            numberLeaves();
+            profiler.endStringDepth();
+            profiler.startCollectInnerNodes();
+            sortInnerNodes();
+            profiler.endCollectInnerNodes();
+        }
+
+        /**
+         * Returns the start index and the length of the repetition (length of aa).
+         */
+        inline std::pair<size_t, size_t> runQuery() noexcept {
+            profiler.startActualQuery();
+            //The inner nodes are sorted by descending string depth, find the first depth with a branching square.
+            for (size_t first = 0; first < sortedInnerNodes.size();) {
+                const Index depth = tree->getNode(sortedInnerNodes[first]).stringDepth;
+                //The root cannot contain a square.
+                if (depth == 0) break;
+                size_t last = first;
+                bool found = false;
+                for (; last < sortedInnerNodes.size() && tree->getNode(sortedInnerNodes[last]).stringDepth == depth; last++) {
+                    profiler.startInnerNodePhase();
+                    found = found || hasBranchingSquare(sortedInnerNodes[last], depth);
+                    profiler.endInnerNodePhase();
+                }
+                if (found) {
+                    profiler.startPairPhase();
+                    const std::pair<size_t, size_t> result = firstSquare(first, last, depth);
+                    profiler.endPairPhase();
+                    profiler.endActualQuery();
+                    return result;
+                }
+                first = last;
+            }
+            profiler.endActualQuery();
+            return std::make_pair(0, 0);
+        }
+
+        /**
+         * The same query with the inner nodes of one string depth tested concurrently on the thread pool, the nodes are only read.
+         */
+        inline std::pair<size_t, size_t> runQuery(Helpers::ThreadPool& pool) noexcept {
+            profiler.startActualQuery();
+            for (size_t first = 0; first < sortedInnerNodes.size();) {
+                const Index depth = tree->getNode(sortedInnerNodes[first]).stringDepth;
+                if (depth == 0) break;
+                size_t last = first;
+                while (last < sortedInnerNodes.size() && tree->getNode(sortedInnerNodes[last]).stringDepth == depth) last++;
+                //Small bands are not worth waking up the threads, they run as a single task.
+                const size_t numberOfTasks = std::min(4 * pool.size(), (last - first + MinNodesPerTask - 1) / MinNodesPerTask);
+                const size_t nodesPerTask = (last - first + numberOfTasks - 1) / numberOfTasks;
+                std::atomic<bool> found(false);
+                pool.parallelFor(numberOfTasks, [&](size_t task, size_t) {
+                    for (size_t i = first + task * nodesPerTask; i < std::min(last, first + (task + 1) * nodesPerTask) && !found.load(std::memory_order_relaxed); i++) {
+                        if (hasBranchingSquare(sortedInnerNodes[i], depth)) found.store(true, std::memory_order_relaxed);
+                    }
+                });
+                if (found) {
+                    const std::pair<size_t, size_t> result = firstSquare(first, last, depth);
+                    profiler.endActualQuery();
+                    return result;
+                }
+                first = last;
+            }
+            profiler.endActualQuery();
+            return std::make_pair(0, 0);
+        }
+
+    private:
+        /**
+         * Checks if there is a suffix p below a child of the node (except for the child with the most leaves)
+         * such that p + depth or p - depth is below the node, too.
+         */
+        inline bool hasBranchingSquare(const NodeIndex index, const Index depth) const noexcept {
+            const NodeType& node = tree->getNode(index);
+            NodeIndex largestChild = Tree::NoNode;
+            Index largestChildSize = 0;
+            for (const auto & [key, child] : node.children) {
+                const Index childSize = lastRank[child] - firstRank[child] + 1;
+                if (childSize > largestChildSize) {
+                    largestChild = child;
+                    largestChildSize = childSize;
+                }
+            }
+            for (const auto & [key, child] : node.children) {
+                if (child == largestChild) continue;
+                for (Index rank = firstRank[child]; rank <= lastRank[child]; rank++) {
+                    const Index suffix = suffixOfRank[rank];
+                    if (suffix + depth < tree->n && isBelow(suffix + depth, index)) return true;
+                    if (suffix >= depth && isBelow(suffix - depth, index)) return true;
+                }
+            }
+            return false;
+        }
+
+        /**
+         * Among the inner nodes sortedInnerNodes[first..last-1] (all with the given string depth), finds the first one in bfs order
+         * with a square and returns the smallest start position of a square below it together with the length of the square.
+         */
+        inline std::pair<size_t, size_t> firstSquare(const size_t first, const size_t last, const Index depth) const noexcept {
+            NodeIndex bestNode = Tree::NoNode;
+            Index bestStart = -1;
+            for (size_t i = first; i < last; i++) {
+                const NodeIndex index = sortedInnerNodes[i];
+                //The bfs visits nodes by their depth in the tree and lexicographically (by rank) within one depth.
+                if (bestNode != Tree::NoNode && (treeDepth[index] > treeDepth[bestNode] || (treeDepth[index] == treeDepth[bestNode] && firstRank[index] > firstRank[bestNode]))) continue;
+                Index start = -1;
+                for (Index rank = firstRank[index]; rank <= lastRank[index]; rank++) {
+                    const Index suffix = suffixOfRank[rank];
+                    if (suffix + depth < tree->n && isBelow(suffix + depth, index) && (start == -1 || suffix < start)) {
+                        start = suffix;
+                    }
+                }
+                if (start != -1) {
+                    bestNode = index;
+                    bestStart = start;
+                }
+            }
+            return std::make_pair(bestStart, 2 * depth);
+        }
+
+        /**
+         * Checks if the leaf of the given suffix is below the node.
+         */
+        inline bool isBelow(const Index suffix, const NodeIndex node) const noexcept {
+            const Index rank = rankOfSuffix[suffix];
+            return rank >= firstRank[node] && rank <= lastRank[node];
+        }
+
+        /**
+         * Numbers the leaves in lexicographic order with an iterative dfs.
+         * Every node gets the range of the ranks of the leaves below it and its depth in the tree.
+         * The string depths are the shared annotation of the tree (see UkkonenSuffixTree/Annotation.h), computed before.
+         */
+        inline void numberLeaves() noexcept {
+            struct StackEntry {
+                NodeIndex node;
+                Index treeDepth;
+                bool leaving;
+            };
+            const size_t numberOfNodes = tree->numberOfNodes();
+            firstRank.assign(numberOfNodes, 0);
+            lastRank.assign(numberOfNodes, 0);
+            treeDepth.assign(numberOfNodes, 0);
+            rankOfSuffix.assign(tree->n, 0);
+            suffixOfRank.assign(tree->n, 0);
+            Index nextRank = 0;
+            std::vector<StackEntry> stack;
+            stack.emplace_back(tree->Root, 0, false);
+            while (!stack.empty()) {
+                const StackEntry entry = stack.back();
+                stack.pop_back();
+                if (entry.leaving) {
+                    lastRank[entry.node] = nextRank - 1;
+                    continue;
+                }
+                const NodeType& node = tree->getNode(entry.node);
+                firstRank[entry.node] = nextRank;
+                treeDepth[entry.node] = entry.treeDepth;
+                if (!node.hasChildren()) {
+                    const Index suffix = node.representedSuffix;
+                    rankOfSuffix[suffix] = nextRank;
+                    suffixOfRank[nextRank] = suffix;
+                    lastRank[entry.node] = nextRank++;
+                    continue;
+                }
+                stack.emplace_back(entry.node, entry.treeDepth, true);
+                //Push the children in reverse order, so that they are visited in lexicographic order.
+                const size_t firstChild = stack.size();
+                for (const auto & [key, child] : node.children) {
+                    stack.emplace_back(child, entry.treeDepth + 1, false);
+                }
+                std::reverse(stack.begin() + firstChild, stack.end());
+            }
+        }
+
+        /**
+         * Sorts the inner nodes by descending string depth with a counting sort.
+         */
+        inline void sortInnerNodes() noexcept {
+            Index maxDepth = 0;
+            size_t numberOfInnerNodes = 0;
+            for (NodeIndex index = 0; index < tree->numberOfNodes(); index++) {
+                const NodeType& node = tree->getNode(index);
+                if (!node.hasChildren()) continue;
+                maxDepth = std::max(maxDepth, node.stringDepth);
+                numberOfInnerNodes++;
+            }
+            //position[maxDepth - d] is the first position of the inner nodes with string depth d in the sorted order.
+            std::vector<size_t> position(maxDepth + 2, 0);
+            for (NodeIndex index = 0; index < tree->numberOfNodes(); index++) {
+                const NodeType& node = tree->getNode(index);
+                if (node.hasChildren()) position[maxDepth - node.stringDepth + 1]++;
+            }
+            for (Index i = 1; i <= maxDepth + 1; i++) {
+                position[i] += position[i - 1];
+            }
+            sortedInnerNodes.resize(numberOfInnerNodes);
+            for (NodeIndex index = 0; index < tree->numberOfNodes(); index++) {
+                const NodeType& node = tree->getNode(index);
+                if (node.hasChildren()) sortedInnerNodes[position[maxDepth - node.stringDepth]++] = index;
+            }
+        }
+
+    public:
+        Tree* tree;
+        //All inner nodes, sorted by descending string depth
+        std::vector<NodeIndex> sortedInnerNodes;
+        //The leaves below a node have the ranks firstRank[node]..lastRank[node].
+        std::vector<Index> firstRank;
+        std::vector<Index> lastRank;
+        //Number of edges from the root to the node, to get the bfs order of nodes.
+        std::vector<Index> treeDepth;
+        //The lexicographic rank of each suffix and its inverse.
+        std::vector<Index> rankOfSuffix;
+        std::vector<Index> suffixOfRank;
+
+        Profiler profiler;
+    };
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <queue>
+#include <algorithm>
+
+#include "../SuffixArray/SuffixArray.h"
+#include "../SuffixArray/LcpIntervalTree.h"
+
+namespace Query {
+    /**
+     * The repeat query of RepeatQuery.h on the lcp-interval tree of a suffix array instead of the suffix tree.
+     *
+     * The idea is the same: A square aa with |a| = l starts at p iff the suffixes p and p + l are in the same interval
+     * with lcp l. The intervals are considered in the same order as the inner nodes of the suffix tree (by descending lcp, ties in bfs order),
+     * so the first interval with such a pair is the solution.
+     *
+     * The suffixes below an interval do not need to be merged, they are simply sa[leftBound..rightBound].
+     * For each of them, the inverse suffix array tells in constant time whether suffix p + l is in the interval, too.
+     * The smallest such p is the solution, which is the same one that RepeatQuery::findPair returns.
+     */
+    template<typename CHAR_TYPE, CHAR_TYPE SENTINEL, typename PROFILER, bool DEBUG = false>
+    class SuffixArrayRepeatQuery {
+        using CharType = CHAR_TYPE;
+        using Profiler = PROFILER;
+        using Tree = SuffixArray::LcpIntervalTree<CHAR_TYPE, DEBUG>;
+        static const CharType Sentinel = SENTINEL;
+        static const bool Debug = DEBUG;
+
+    public:
+        SuffixArrayRepeatQuery(const Tree* tree) :
+            tree(tree) {
+            profiler.startCollectInnerNodes();
+            collectIntervals();
+            profiler.endCollectInnerNodes();
+        }
+
+        /**
+         * Returns the start index and the length of the repetition (length of aa).
+         */
+        inline std::pair<size_t, size_t> runQuery() noexcept {
+            profiler.startActualQuery();
+            const std::vector<int>& sa = tree->suffixArray->sa;
+            const std::vector<int>& inverseSa = tree->suffixArray->inverseSa;
+            for (const SuffixArray::ChildIndex index : sortedIntervals) {
+                const SuffixArray::Interval& interval = tree->intervals[index];
+                //The root (lcp 0) cannot contain a square.
+                if (interval.lcp == 0) break;
+                profiler.startInnerNodePhase();
+                profiler.startPairPhase();
+                int startIndex = -1;
+                for (int rank = interval.leftBound; rank <= interval.rightBound; rank++) {
+                    const int suffix = sa[rank];
+                    if (suffix + interval.lcp >= tree->n) continue;
+                    const int partnerRank = inverseSa[suffix + interval.lcp];
+                    if (partnerRank >= interval.leftBound && partnerRank <= interval.rightBound && (startIndex == -1 || suffix < startIndex)) {
+                        startIndex = suffix;
+                    }
+                }
+                profiler.endPairPhase();
+                profiler.endInnerNodePhase();
+                if (startIndex != -1) {
+                    profiler.endActualQuery();
+                    return std::make_pair(startIndex, 2 * interval.lcp);
+                }
+            }
+            profiler.endActualQuery();
+            return std::make_pair(0, 0);
+        }
+
+        /**
+         * Collects all intervals in bfs order and sorts them by descending lcp, see RepeatQuery::collectInnerNodes.
+         * Instead of stable_sort, this uses a counting sort by lcp, which is stable as well and linear.
+         */
+        inline void collectIntervals() noexcept {
+            std::vector<SuffixArray::ChildIndex> bfsOrder;
+            bfsOrder.reserve(tree->intervals.size());
+            bfsOrder.emplace_back(tree->root);
+            int maxLcp = 0;
+            //The vector itself is the bfs queue, only intervals are enqueued.
+            for (size_t i = 0; i < bfsOrder.size(); i++) {
+                const SuffixArray::ChildIndex index = bfsOrder[i];
+                maxLcp = std::max(maxLcp, tree->intervals[index].lcp);
+                for (const SuffixArray::ChildIndex* child = tree->childrenOfBegin(index); child != tree->childrenOfEnd(index); child++) {
+                    if (!Tree::isLeaf(*child)) bfsOrder.emplace_back(*child);
+                }
+            }
+            //position[maxLcp - d] is the first position of the intervals with lcp d in the sorted order.
+            std::vector<size_t> position(maxLcp + 2, 0);
+            for (const SuffixArray::ChildIndex index : bfsOrder) {
+                position[maxLcp - tree->intervals[index].lcp + 1]++;
+            }
+            for (int i = 1; i <= maxLcp + 1; i++) {
+                position[i] += position[i - 1];
+            }
+            sortedIntervals.resize(bfsOrder.size());
+            for (const SuffixArray::ChildIndex index : bfsOrder) {
+                sortedIntervals[position[maxLcp - tree->intervals[index].lcp]++] = index;
+            }
+        }
+
+    public:
+        const Tree* tree;
+        //All intervals, sorted by descending lcp and in bfs order for equal lcp
+        std::vector<SuffixArray::ChildIndex> sortedIntervals;
+
+        Profiler profiler;
+    };
+}
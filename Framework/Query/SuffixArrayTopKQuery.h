@@ -0,0 +1,110 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <queue>
+#include <algorithm>
+
+#include "TopKQuery.h"
+#include "../SuffixArray/SuffixArray.h"
+#include "../SuffixArray/LcpIntervalTree.h"
+
+namespace Query {
+    /**
+     * The topk query of TopKQuery.h on the lcp-interval tree of a suffix array instead of the suffix tree.
+     *
+     * The lcp-intervals are the inner nodes of the suffix tree and the leaves are the suffixes, so the same bfs finds the
+     * same candidates in the same order:
+     *  - The string depth of an interval is its lcp, the string depth of leaf sa[i] is n - sa[i].
+     *  - The number of leaves below an interval is its size, nothing needs to be precomputed.
+     * Therefore, the results are identical to the ones of the suffix tree, including ties.
+     */
+    template<typename CHAR_TYPE, CHAR_TYPE SENTINEL, typename PROFILER, bool DEBUG = false>
+    class SuffixArrayTopKQuery {
+        using CharType = CHAR_TYPE;
+        using Profiler = PROFILER;
+        using Tree = SuffixArray::LcpIntervalTree<CHAR_TYPE, DEBUG>;
+        //The suffix array uses int positions.
+        using Candidate = Query::Candidate<int>;
+        static const CharType Sentinel = SENTINEL;
+        static const bool Debug = DEBUG;
+
+    public:
+        //The result of a query for which there are fewer than k substrings of length l.
+        static constexpr int NoSolution = -1;
+
+        SuffixArrayTopKQuery(const Tree* tree) :
+            tree(tree) {
+            //All information that the queries need is already part of the intervals.
+            profiler.startInitialization();
+            profiler.endInitialization();
+        }
+
+        /**
+         * Runs a query for the given length l and finds the k-th most frequent substring.
+         * Returns the start index of the substring or NoSolution if there are fewer than k substrings of length l.
+         */
+        inline int runQuery(int l, int k) noexcept {
+            profiler.startNewQuery();
+            if constexpr (Debug) std::cout << "Running topk query with l = " << l << " and k = " << k << std::endl;
+            if (k < 1) {
+                profiler.endCurrentQuery();
+                return NoSolution;
+            }
+
+            profiler.startCollectCandidates();
+            std::vector<Candidate> candidates;
+            collectingBfs(candidates, l);
+            profiler.endCollectCandidates();
+
+            profiler.startSortCandidates();
+            //The k-th candidate by descending occurrences, ties in bfs order, as in TopKQuery.
+            const std::vector<size_t> best = TopKQuery<CharType, Sentinel, Profiler, Debug>::selectBest(candidates.size(), k, [&](const size_t left, const size_t right) {
+                if (candidates[left].occurences != candidates[right].occurences) return candidates[left].occurences > candidates[right].occurences;
+                return left < right;
+            });
+            profiler.endSortCandidates();
+            if (best.size() < static_cast<size_t>(k)) {
+                //There are fewer than k distinct substrings of length l.
+                profiler.endCurrentQuery();
+                return NoSolution;
+            }
+
+            profiler.startReconstructSolution();
+            const Candidate& solution = candidates[best[k - 1]];
+            if constexpr (Debug) std::cout << "Found suffix (" << solution.startPosition << ", " << solution.startPosition + l << ") with #occ: " << solution.occurences << std::endl;
+            profiler.endReconstructSolution();
+            profiler.endCurrentQuery();
+            return solution.startPosition;
+        }
+
+        /**
+         * Collects the highest intervals and leaves with string depth >= length in bfs order, see TopKQuery::collectingBfs.
+         */
+        inline void collectingBfs(std::vector<Candidate>& candidates, const int length) const noexcept {
+            const std::vector<int>& sa = tree->suffixArray->sa;
+            std::queue<SuffixArray::ChildIndex> queue;
+            queue.push(tree->root);
+            while (!queue.empty()) {
+                const SuffixArray::ChildIndex child = queue.front();
+                queue.pop();
+                if (Tree::isLeaf(child)) {
+                    //A leaf is a candidate of its own if its suffix is long enough.
+                    const int suffix = sa[Tree::rankOfLeaf(child)];
+                    if (suffix + length < tree->n) candidates.emplace_back(1, suffix);
+                } else if (tree->intervals[child].lcp >= length) {
+                    candidates.emplace_back(tree->numberOfLeaves(child), tree->representedSuffix(child));
+                } else {
+                    for (const SuffixArray::ChildIndex* grandChild = tree->childrenOfBegin(child); grandChild != tree->childrenOfEnd(child); grandChild++) {
+                        queue.push(*grandChild);
+                    }
+                }
+            }
+        }
+
+    public:
+        const Tree* tree;
+
+        Profiler profiler;
+    };
+}
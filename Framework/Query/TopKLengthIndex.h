@@ -0,0 +1,154 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+
+#include "DocumentCounts.h"
+#include "../CompressedSuffixTree/WaveletMatrix.h"
+#include "../Helpers/Memory.h"
+
+namespace Query {
+    /**
+     * Answers topk queries on an annotated suffix tree (or its frozen copy or an index) in O(log^2 n) time, without a traversal.
+     *
+     * The candidates of a topk query for length l (see TopKQuery::collectingBfs) are the nodes with parentDepth < l <= lastLength,
+     * where parentDepth is the string depth of the parent and lastLength is the string depth of the node, minus one for leaves:
+     * the substrings of a leaf that are longer contain the sentinel. So every node is a candidate for one interval of lengths.
+     * For a generalized suffix tree, lastLength ends before the separator after the document of the node (see DocumentCounts.h)
+     * and the nodes are ranked by their number of documents instead of their number of occurences.
+     *  - All nodes are ordered once by (#occurences descending, bfs rank). That is the order in which TopKQuery selects the candidates,
+     *    so the result is the candidate at the k-th position p of this order with parentDepth < l <= lastLength.
+     *  - Since lastLength < l implies parentDepth < l, the number of candidates before p is #(parentDepth < l) - #(lastLength < l) in [0, p).
+     *    Both are countLess queries on a wavelet matrix of the parent depths and one of the last lengths in this order
+     *    (CompressedSuffixTree/WaveletMatrix.h), O(log n) time each.
+     *  - A binary search over p finds the k-th candidate.
+     * The nodes that are never candidates (the root and the leaves that only add the sentinel) are not stored.
+     *
+     * The index needs 2.5 log(max string depth) bits and one position per node, and O(n log n) time to build (for the wavelet matrices).
+     * It is read-only, so any number of threads can query it concurrently. It cannot follow a tree that grows (OnlineSuffixTree).
+     * The memory is accounted as MemoryComponent::LengthIndex (Helpers/Memory.h).
+     */
+    template<typename TREE>
+    class TopKLengthIndex {
+        using Tree = TREE;
+        using NodeIndex = typename Tree::NodeIndex;
+
+    public:
+        using Index = typename Tree::Index;
+        //The result of select if there are fewer than k candidates.
+        static constexpr Index NoSolution = -1;
+
+        /**
+         * Builds the index for the given tree, whose annotations must be computed (see UkkonenSuffixTree/Annotation.h).
+         * With documents, the tree is a generalized suffix tree and the nodes are ranked by their number of documents.
+         * The nodes are ordered with a counting sort by #occurences: the first bfs counts the nodes per #occurences,
+         * the second writes every node directly to its position.
+         */
+        TopKLengthIndex(const Tree& tree, const DocumentCounts<Tree>* documents = nullptr) {
+            Index maxOccurences = 0;
+            forEachCandidate(tree, documents, [&](const Index occurences, const auto&, Index, Index) {
+                maxOccurences = std::max(maxOccurences, occurences);
+            });
+            //position[o] is the next position of the nodes with o occurences, the nodes with more occurences come first.
+            std::vector<size_t> position(maxOccurences + 2, 0);
+            forEachCandidate(tree, documents, [&](const Index occurences, const auto&, Index, Index) {
+                position[occurences]++;
+            });
+            size_t numberOfCandidates = 0;
+            for (Index occurences = maxOccurences + 1; occurences > 0; occurences--) {
+                const size_t count = position[occurences - 1];
+                position[occurences - 1] = numberOfCandidates;
+                numberOfCandidates += count;
+            }
+            std::vector<Index> parentDepthValues(numberOfCandidates);
+            std::vector<Index> lastLengthValues(numberOfCandidates);
+            suffixes.resize(numberOfCandidates);
+            forEachCandidate(tree, documents, [&](const Index occurences, const auto& node, Index parentDepth, Index lastLength) {
+                const size_t candidate = position[occurences]++;
+                parentDepthValues[candidate] = parentDepth;
+                lastLengthValues[candidate] = lastLength;
+                suffixes[candidate] = node.representedSuffix;
+            });
+            std::vector<size_t>().swap(position);
+            parentDepths = CompressedSuffixTree::IntegerWaveletMatrix(parentDepthValues);
+            std::vector<Index>().swap(parentDepthValues);
+            lastLengths = CompressedSuffixTree::IntegerWaveletMatrix(lastLengthValues);
+            //The bit vectors use plain std::vectors, they are accounted as a whole.
+            accountedBytes = parentDepths.memoryUsage() + lastLengths.memoryUsage();
+            Helpers::MemoryAccounting::allocated(Helpers::MemoryComponent::LengthIndex, accountedBytes);
+        }
+
+        ~TopKLengthIndex() {
+            Helpers::MemoryAccounting::released(Helpers::MemoryComponent::LengthIndex, accountedBytes);
+        }
+
+        TopKLengthIndex(const TopKLengthIndex&) = delete;
+        TopKLengthIndex& operator=(const TopKLengthIndex&) = delete;
+
+        /**
+         * The number of distinct substrings of the given length, the candidates of a topk query for it.
+         */
+        inline size_t numberOfCandidates(Index length) const noexcept {
+            return candidatesBefore(length, suffixes.size());
+        }
+
+        /**
+         * Returns the start of the k-th most frequent substring of the given length (ties are broken as in TopKQuery::runQuery),
+         * or NoSolution if there are fewer than k distinct substrings of that length.
+         */
+        inline Index select(Index length, Index k) const noexcept {
+            if (length < 1 || k < 1 || numberOfCandidates(length) < static_cast<size_t>(k)) return NoSolution;
+            //The smallest position end with k candidates in [0, end), the k-th candidate is at end - 1.
+            //Invariant: fewer than k candidates before low, at least k before high.
+            size_t low = 0;
+            size_t high = suffixes.size();
+            while (high - low > 1) {
+                const size_t middle = low + (high - low) / 2;
+                if (candidatesBefore(length, middle) >= static_cast<size_t>(k)) {
+                    high = middle;
+                } else {
+                    low = middle;
+                }
+            }
+            return suffixes[high - 1];
+        }
+
+    private:
+        /**
+         * Calls function(occurences, node, parentDepth, lastLength) for all nodes that are candidates for some length, in bfs order.
+         * occurences is the number of leaves of the node or, with documents, its number of documents.
+         * The queue only holds the inner nodes whose path labels are substrings of the documents, all nodes below the others span
+         * two documents as well.
+         */
+        template<typename FUNCTION>
+        inline static void forEachCandidate(const Tree& tree, const DocumentCounts<Tree>* documents, const FUNCTION& function) {
+            std::vector<NodeIndex> queue = {Tree::Root};
+            for (size_t position = 0; position < queue.size(); position++) {
+                const auto& parent = tree.getNode(queue[position]);
+                for (const auto & [key, child] : parent.children) {
+                    const auto& node = tree.getNode(child);
+                    //The substrings up to the end of the document, which is the sentinel for a single text.
+                    const Index documentEnd = documents ? documents->documentEnd(node.representedSuffix) : tree.n - 1;
+                    const Index lastLength = std::min(node.stringDepth, documentEnd - node.representedSuffix);
+                    if (lastLength > parent.stringDepth) function(documents ? documents->count(child) : node.numberOfLeaves, node, parent.stringDepth, lastLength);
+                    if (node.hasChildren() && lastLength == node.stringDepth) queue.emplace_back(child);
+                }
+            }
+        }
+
+        /**
+         * The number of candidates for length in the first end positions.
+         */
+        inline size_t candidatesBefore(Index length, size_t end) const noexcept {
+            return parentDepths.countLess(length, end) - lastLengths.countLess(length, end);
+        }
+
+    private:
+        //The parent depths and last lengths of the nodes in the order of the candidates
+        CompressedSuffixTree::IntegerWaveletMatrix parentDepths;
+        CompressedSuffixTree::IntegerWaveletMatrix lastLengths;
+        //The represented suffixes of the nodes in the same order
+        Helpers::CountedVector<Index, Helpers::MemoryComponent::LengthIndex> suffixes;
+        size_t accountedBytes = 0;
+    };
+}
@@ -3,92 +3,153 @@
 #include <iostream>
 #include <bits/stdc++.h>
 #include <queue>
+#include <memory>
 
+#include "TopKLengthIndex.h"
+#include "DocumentCounts.h"
 #include "../UkkonenSuffixTree/SuffixTree.h"
 #include "../UkkonenSuffixTree/Node.h"
+#include "../Helpers/Memory.h"
 
 namespace Query {
     /**
      * A Candidate represents a substring starting at startPosition that exists occurences times in the input text.
+     * INDEX is the position type of the tree.
      */
+    template<typename INDEX = int>
     struct Candidate {
-        int occurences;
-        int startPosition;
+        INDEX occurences;
+        INDEX startPosition;
+    };
+
+    /**
+     * A node on the frontier of the batched queries, together with its depth (number of edges from the root).
+     * The candidate for the node is stored along with it, so that sorting the frontier does not need to access the nodes.
+     */
+    template<typename INDEX = int>
+    struct FrontierEntry {
+        SuffixTree::NodeIndexOf<INDEX> node;
+        int treeDepth;
+        Candidate<INDEX> candidate;
     };
 
     /**
      * The overall query idea, explained in more detail below:
-     *  - Precompute the string depth of all nodes.
+     *  - Precompute the string depth of all nodes (the shared annotation of the tree, see UkkonenSuffixTree/Annotation.h).
      *  - Precompute the number of leaves under each node.
      *    That is equal to the number of suffixes that this node represents, which all have the same prefix of length of its string depth.
      *    Therefore, it is equal to the number of substrings of their stringDepth in the input.
      *  - Select all highest nodes with string depth >= l. These represent substrings of length >= l (if > l, then a prefix of length l occurs exactly as often).
-     *  - Stable-sort those candidates by their #occurences to find the k-th entry. Return that.
+     *    Substrings that contain the sentinel are skipped, so the leaves for the sentinel (and the sentinel at the end of all other leaves) never become candidates.
+     *  - Select the k-th of those candidates by their #occurences (ties are broken by the order of the candidates). Return that.
+     * Collecting the candidates touches every node above length l, O(n) per query. Therefore, the candidates of all lengths are indexed once
+     * (TopKLengthIndex.h) and runQuery(l, k) selects the k-th one in O(log^2 n) time. Only trees that grow (OnlineSuffixTree) are scanned every time.
+     *
+     * On a generalized suffix tree of a document collection (see DocumentCounts.h), the substrings are ranked by the number of documents
+     * that contain them instead of their number of occurences, and substrings that span two documents are skipped like those with the sentinel.
      */
-    template<typename CHAR_TYPE, CHAR_TYPE SENTINEL, typename PROFILER, bool DEBUG = false>
+    template<typename CHAR_TYPE, CHAR_TYPE SENTINEL, typename PROFILER, bool DEBUG = false, typename CHILDREN = SuffixTree::AdaptiveChildren<CHAR_TYPE>, typename INDEX = int, typename TREE = SuffixTree::SuffixTree<CHAR_TYPE, DEBUG, CHILDREN, INDEX>>
     class TopKQuery {
         using CharType = CHAR_TYPE;
         using Profiler = PROFILER;//For evaluation, use with TopKProfiler; for production, use NoProfiler. All method calls made to profiler in this class are for time measurements.
+        using Children = CHILDREN;//The child container of the suffix tree nodes, see UkkonenSuffixTree/Children.h.
+        using Tree = TREE;//The suffix tree, its frozen copy (see UkkonenSuffixTree/FrozenSuffixTree.h) or a mapped index of it (see Index/SuffixTreeIndex.h).
+        using NodeType = typename Tree::NodeType;
+        using NodeIndex = typename Tree::NodeIndex;
         static const CharType Sentinel = SENTINEL;
         static const bool Debug = DEBUG;
+        static_assert(std::is_same_v<INDEX, typename Tree::Index>, "The query must use the position type of the tree.");
 
     public:
+        using Index = INDEX;//The position type of the tree, see SuffixTree.h.
+        using CandidateType = Candidate<Index>;
+        //The scratch buffer for the candidates of a query, its memory is accounted as MemoryComponent::Candidates (Helpers/Memory.h).
+        using CandidateBuffer = Helpers::CountedVector<CandidateType, Helpers::MemoryComponent::Candidates>;
+        //The result of runQuery if there are fewer than k candidates for length l.
+        static constexpr Index NoSolution = -1;
+
         /**
          * Generates a new query and already does some additional preprocessing on the suffix tree that will be needed later.
+         * With documents, the tree is a generalized suffix tree and the queries rank by document frequency. The counts must be
+         * computed on this tree and outlive the query.
          */
-        TopKQuery(SuffixTree::SuffixTree<CharType, Debug>* tree) :
-            tree(tree) {
+        TopKQuery(Tree* tree, const DocumentCounts<Tree>* documents = nullptr) :
+            tree(tree),
+            documents(documents) {
             profiler.startInitialization();
-            //Additional precomputations that are necessary for the topK queries. Needs to be done only once for all queries.
-            countNumberOfLeaves();
+            //Additional precomputations that are necessary for the topK queries (string depths, numbers of leaves and represented suffixes).
+            //They are shared with the repeat queries and computed only once per tree, a mapped index already contains them.
+            if constexpr (!Tree::IsAnnotated) tree->annotate();
+            //The index of the candidates of all lengths, it would be outdated after the next append to a growing tree.
+            if constexpr (!Tree::IsGrowing) lengthIndex = std::make_unique<TopKLengthIndex<Tree>>(*tree, documents);
             profiler.endInitialization();
-            if constexpr (Debug) tree->root.print(4);
+            if constexpr (Debug) tree->printNode(tree->Root, 4);
         }
 
         /**
          * Runs a query for the given length l and finds the k-th most frequent substring.
-         * Returns the start index of the substring.
+         * Returns the start index of the substring or NoSolution if there are fewer than k substrings of length l.
+         * Uses the length index unless the tree grows. It is only read, so several threads may run queries concurrently
+         * (with TopKNoProfiler and TopKTraceProfiler).
+         */
+        inline Index runQuery(Index l, Index k) noexcept {
+            if (lengthIndex && l > 0) {
+                profiler.startNewQuery();
+                profiler.startSortCandidates();
+                const Index solution = lengthIndex->select(l, k);
+                profiler.endSortCandidates();
+                profiler.endCurrentQuery();
+                return solution;
+            }
+            //The buffer only grows to the number of candidates for l, reserving for the n possible ones would allocate O(n) per query.
+            CandidateBuffer candidates;
+            return runQuery(l, k, candidates);
+        }
+
+        /**
+         * Same as runQuery(l, k), but always collects the candidates with a bfs (see collectingBfs), in the given scratch buffer,
+         * which keeps its memory for the next query. This is the reference for the length index and the query on growing trees.
+         * Neither the tree nor the query are modified, so several threads may run queries concurrently, each with its own buffer.
+         * That is only allowed with TopKNoProfiler and TopKTraceProfiler, the other profilers are not thread-safe.
          */
-        inline int runQuery(int l, int k) noexcept {
+        inline Index runQuery(Index l, Index k, CandidateBuffer& candidates) noexcept {
             profiler.startNewQuery();
             if constexpr (Debug) std::cout << "Running topk query with l = " << l << " and k = " << k << std::endl;
 
             profiler.startCollectCandidates();
-            std::vector<Candidate> candidates;
-            //Avoid reallocation by reserving for as many candidates as are possible.
-            candidates.reserve(tree->n);
+            candidates.clear();
             //Collect all relevant candidates for the given length.
             collectingBfs(candidates, l);
-            //The reserve() call above typically increases the vector size unnecessarily (by a lot).
-            //My evaluation shows that this slows down the following stable_sort (below); I assume that that is because more memory is allocated internally (?).
-            //Either way, the real size that is needed is now known, so I just let the vector know it does not need to be larger any longer to save time later.
-            candidates.shrink_to_fit();
             profiler.endCollectCandidates();
 
             profiler.startSortCandidates();
             //Candidates now has entries (#occurences, starting position). These were added in suffix tree order and therefore, they are lexicographically sorted.
-            //By stable-sorting them by the #occurences (only, i.e. not also by the starting position!) we get them ordered by #occurences.
-            //Due to stable-sort and the previous lexicographic order, lexicographically smaller elements are favored in case of equal #occurences.
-            //Of course, it is not really necessary to sort the entire vector. It would be theoretically more efficient to use a top-k max heap, but
-            //my profiling shows that this step only takes around 5% of the query time, so I chose not to do that.
-            std::stable_sort(candidates.begin(), candidates.end(), [](const Candidate& left, const Candidate& right){
-                return left.occurences > right.occurences;
+            //The result is the k-th candidate ordered by #occurences (descending) and, for equal #occurences, by the position in candidates.
+            //That is the order that a stable sort by #occurences would give, but only the best k candidates need to be ordered.
+            const std::vector<size_t> best = selectBest(candidates.size(), k, [&](const size_t left, const size_t right) {
+                if (candidates[left].occurences != candidates[right].occurences) return candidates[left].occurences > candidates[right].occurences;
+                return left < right;
             });
             profiler.endSortCandidates();
+            if (k < 1 || best.size() < static_cast<size_t>(k)) {
+                //There are fewer than k distinct substrings of length l.
+                profiler.endCurrentQuery();
+                return NoSolution;
+            }
 
             if constexpr (Debug) {
-                std::cout << "Found sorted candidates: " << std::endl;
-                for (auto &candidate : candidates) {
-                    std::cout << "Start index: " << candidate.startPosition << ", #occ. = " << candidate.occurences << std::endl;
+                std::cout << "Found best candidates: " << std::endl;
+                for (const size_t candidate : best) {
+                    std::cout << "Start index: " << candidates[candidate].startPosition << ", #occ. = " << candidates[candidate].occurences << std::endl;
                 }
             }
 
             profiler.startReconstructSolution();//This phase is now pretty useless; there used to be more work to do here...
             //Finally, select the k-th element (0-indexed, obviously) as the final result.
-            Candidate& solution = candidates[k - 1];
+            CandidateType& solution = candidates[best[k - 1]];
 
             if constexpr (Debug) {
-                int endIndex = solution.startPosition + l;//inclusively
+                Index endIndex = solution.startPosition + l;//inclusively
                 std::cout << "Found suffix (" << solution.startPosition << ", " << endIndex << ") with #occ: " << solution.occurences << std::endl;
             }
             profiler.endReconstructSolution();
@@ -98,6 +159,34 @@ namespace Query {
             return solution.startPosition;
         }
 
+        /**
+         * Returns the positions of the best k of the elements 0..count-1, best first. better(left, right) must be a strict total order.
+         *
+         * Uses a bounded heap whose top is the worst of the best elements found so far: every element is compared to the top once and
+         * only better elements enter the heap. This needs O(count + k log k) time for typical inputs (O(count log k) in the worst case)
+         * and O(k) memory, instead of sorting all elements.
+         */
+        template<typename BETTER>
+        inline static std::vector<size_t> selectBest(const size_t count, const size_t k, const BETTER& better) noexcept {
+            std::vector<size_t> heap;
+            //The heap has no top to compare to for k = 0.
+            if (k == 0) return heap;
+            heap.reserve(std::min(count, k));
+            for (size_t element = 0; element < count; element++) {
+                if (heap.size() < k) {
+                    heap.emplace_back(element);
+                    std::push_heap(heap.begin(), heap.end(), better);
+                } else if (better(element, heap.front())) {
+                    std::pop_heap(heap.begin(), heap.end(), better);
+                    heap.back() = element;
+                    std::push_heap(heap.begin(), heap.end(), better);
+                }
+            }
+            //With better as comparison, sort_heap orders the elements from the best to the worst.
+            std::sort_heap(heap.begin(), heap.end(), better);
+            return heap;
+        }
+
         /**
          * Collects all relevant candidates from the suffix tree for the given length.
          *
@@ -113,17 +202,19 @@ namespace Query {
          * for each query. However, that is significantly slower than this approach for small values for l since here, we can often end the search
          * early and do not need to consider as many candidates in the first place.
          */
-        inline void collectingBfs(std::vector<Candidate>& candidates, const int length) const noexcept {
+        inline void collectingBfs(CandidateBuffer& candidates, const Index length) const noexcept {
             //Use a queue to preserve the suffix ordering from the suffix tree. This is necessary to get lexicographic ordering.
-            std::queue<SuffixTree::Node<CharType>*> queue;
-            queue.push(&tree->root);
+            std::queue<NodeIndex> queue;
+            queue.push(tree->Root);
             while (!queue.empty()) {
-                const SuffixTree::Node<CharType>* node = queue.front();
+                const NodeIndex index = queue.front();
+                const NodeType* node = &tree->getNode(index);
                 queue.pop();
-                if (node->stringDepth >= length && node->representedSuffix + length < tree->n) {
+                if (node->stringDepth >= length) {
                     //If this node has at least level l and the suffix is valid, add the relevant candidate.
                     //Store #occurences to find the correct entry later on and the representedSuffix to reconstruct the solution.
-                    candidates.emplace_back(node->numberOfLeaves, node->representedSuffix);
+                    //Otherwise, the substring contains the sentinel or a separator, and so do all substrings below the node.
+                    if (isValid(*node, length)) candidates.emplace_back(occurences(index, *node), node->representedSuffix);
                 } else {
                     //If this path does not have sufficient string depth yet, explore it further. Add all children to the queue.
                     //If we are at a leaf with string depth < length, nothing needs to be done.
@@ -135,47 +226,119 @@ namespace Query {
         }
 
         /**
-         * Initial recursion call for additional preprocessing for the suffix tree.
+         * Runs all given queries (objects with members l and k) at once and returns the start indices of their results in the same order.
+         * Gives the same results as calling runQuery for every query.
+         *
+         * Instead of one bfs from the root per query, the queries are answered by increasing l and the candidates (the frontier of
+         * highest nodes with string depth >= l) are advanced from one length to the next:
+         *  - A node that is a candidate for l is a candidate for l' > l or all candidates for l' below it are below one of its children.
+         *    Nodes above the frontier never need to be looked at again, so advancing the frontier over all lengths visits every node at most once.
+         *  - The frontier is kept in lexicographic (dfs) order. The bfs of runQuery yields the candidates ordered by their depth in the tree
+         *    and lexicographically within one depth. Therefore, ordering the frontier by (#occurences descending, tree depth ascending, position)
+         *    gives the same order as the candidates in runQuery.
+         *  - Queries with the same l share the selected candidates.
          */
-        inline void countNumberOfLeaves() noexcept {
-            //Start dfs at root with depth 0.
-            countingDfs(&tree->root, 0);
+        template<typename QUERY>
+        inline std::vector<Index> runQueries(const std::vector<QUERY>& queries) noexcept {
+            std::vector<Index> results(queries.size());
+            //Process the queries by increasing l.
+            std::vector<size_t> order(queries.size());
+            std::iota(order.begin(), order.end(), 0);
+            std::stable_sort(order.begin(), order.end(), [&](const size_t left, const size_t right) {
+                return queries[left].l < queries[right].l;
+            });
+
+            std::vector<FrontierEntry<Index>> frontier;
+            frontier.emplace_back(tree->Root, 0, CandidateType{0, 0});
+            std::vector<FrontierEntry<Index>> nextFrontier;
+            for (size_t first = 0; first < order.size();) {
+                const Index length = queries[order[first]].l;
+                profiler.startNewQuery();
+
+                profiler.startCollectCandidates();
+                advanceFrontier(frontier, nextFrontier, length);
+                frontier.swap(nextFrontier);
+                profiler.endCollectCandidates();
+
+                profiler.startSortCandidates();
+                //Only the best candidates up to the largest k of all queries with this length are needed.
+                size_t last = first;
+                size_t maxK = 0;
+                for (; last < order.size() && static_cast<Index>(queries[order[last]].l) == length; last++) {
+                    maxK = std::max<size_t>(maxK, queries[order[last]].k);
+                }
+                const std::vector<size_t> best = selectBest(frontier.size(), maxK, [&](const size_t left, const size_t right) {
+                    const FrontierEntry<Index>& leftEntry = frontier[left];
+                    const FrontierEntry<Index>& rightEntry = frontier[right];
+                    if (leftEntry.candidate.occurences != rightEntry.candidate.occurences) return leftEntry.candidate.occurences > rightEntry.candidate.occurences;
+                    if (leftEntry.treeDepth != rightEntry.treeDepth) return leftEntry.treeDepth < rightEntry.treeDepth;
+                    return left < right;
+                });
+                profiler.endSortCandidates();
+
+                profiler.startReconstructSolution();
+                for (; first < last; first++) {
+                    //As in runQuery, there may be fewer than k candidates for length l.
+                    const size_t k = queries[order[first]].k;
+                    results[order[first]] = (k >= 1 && k <= best.size()) ? frontier[best[k - 1]].candidate.startPosition : NoSolution;
+                }
+                profiler.endReconstructSolution();
+                profiler.endCurrentQuery();
+            }
+            return results;
         }
 
         /**
-         * Actual recursive dfs to calculate the following:
-         *  - string depth of every node
-         *  - representedSuffix of all internal nodes. These are precomputed by the suffix tree computation for all leaves (needed for the repeat query).
-         *    Here, I reuse this entry for internal nodes to precompute a possible represented suffix
-         *    (up to the given length, all leaves are equal, so it does not matter which one) to save some time in the actual queries.
-         *  - numberOfLeaves, the number of leaves in the subtree rooted at every node. This is calculated recursively by propagating the lower nodes' values upwards.
-         *
-         *  Returns numberOfLeaves.
+         * Replaces every node of frontier that is not a candidate for length by the candidates below it, in lexicographic order.
+         * The condition for candidates is the same as in collectingBfs.
          */
-        inline int countingDfs(SuffixTree::Node<CharType>* node, int depth) noexcept {
-            //This node has stringDepth of depth + its own length.
-            node->stringDepth = depth + *node->endIndex - node->startIndex;
-            //calculate a possible suffix that is represented by this node.
-            //endIndex - stringDepth is the start position of one of the suffixes represented by leaves below this node.
-            node->representedSuffix = *node->endIndex - node->stringDepth;
-            if (node->hasChildren()) {
-                //remove all sentinel leaves, but count them as children because they represent suffixes, too.
-                node->numberOfLeaves = node->children.erase('\0');
-                //Recursive dfs calls for all children. Simultaneously, calculate the number of leaves below this node.
-                for (const auto & [key, child] : node->children) {
-                    node->numberOfLeaves += countingDfs(child, node->stringDepth);
+        inline void advanceFrontier(const std::vector<FrontierEntry<Index>>& frontier, std::vector<FrontierEntry<Index>>& nextFrontier, const Index length) const noexcept {
+            nextFrontier.clear();
+            std::vector<FrontierEntry<Index>> stack;
+            for (const FrontierEntry<Index>& entry : frontier) {
+                stack.emplace_back(entry);
+                while (!stack.empty()) {
+                    const FrontierEntry<Index> current = stack.back();
+                    stack.pop_back();
+                    const NodeType* node = &tree->getNode(current.node);
+                    if (node->stringDepth >= length) {
+                        //Invalid candidates stay invalid for all longer lengths.
+                        if (isValid(*node, length)) nextFrontier.emplace_back(current);
+                    } else {
+                        //Push the children in reverse order, so that they are popped in lexicographic order. Leaves without children are dropped.
+                        const size_t firstChild = stack.size();
+                        for (const auto & [key, child] : node->children) {
+                            const NodeType& childNode = tree->getNode(child);
+                            stack.emplace_back(child, current.treeDepth + 1, CandidateType{occurences(child, childNode), childNode.representedSuffix});
+                        }
+                        std::reverse(stack.begin() + firstChild, stack.end());
+                    }
                 }
-                return node->numberOfLeaves;
-            } else {
-                //This is a leaf. representedSuffix is already set by the suffix tree generator.
-                node->numberOfLeaves = 1;
-                return 1;
             }
         }
 
+        /**
+         * The number of occurences of the path label of the given node, or the number of its documents for a generalized suffix tree.
+         */
+        inline Index occurences(NodeIndex index, const NodeType& node) const noexcept {
+            return documents ? documents->count(index) : node.numberOfLeaves;
+        }
+
+        /**
+         * True if the substring of the given length at the represented suffix of the node contains neither the sentinel nor a separator.
+         */
+        inline bool isValid(const NodeType& node, const Index length) const noexcept {
+            const Index documentEnd = documents ? documents->documentEnd(node.representedSuffix) : tree->n - 1;
+            return node.representedSuffix + length <= documentEnd;
+        }
+
     public:
         //The suffix tree.
-        SuffixTree::SuffixTree<CharType, Debug>* tree;
+        Tree* tree;
+        //The documents of a generalized suffix tree, nullptr for a single text.
+        const DocumentCounts<Tree>* documents;
+        //The candidates of all lengths, nullptr if the tree grows.
+        std::unique_ptr<TopKLengthIndex<Tree>> lengthIndex;
 
         //Used solely for optimization.
         Profiler profiler;
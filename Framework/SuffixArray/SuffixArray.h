@@ -0,0 +1,243 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstdint>
+
+#include "../UkkonenSuffixTree/Helpers.h"
+#include "../UkkonenSuffixTree/Children.h"
+#include "../Helpers/ThreadPool.h"
+
+namespace SuffixArray {
+    /**
+     * Suffix array and LCP array of a text, constructed in linear time.
+     *
+     *  - The suffix array is built with SA-IS (induced sorting), following
+     *      - Nong, Zhang, Chan: Two Efficient Algorithms for Linear Time Suffix Array Construction (2011)
+     *      - https://github.com/atcoder/ac-library/blob/master/atcoder/string.hpp (structure of the implementation)
+     *  - The LCP array is built with Kasai's algorithm from the inverse suffix array.
+     *
+     * The suffixes are sorted in the order of CharType, i.e., in the same order that the suffix tree uses for its children.
+     * The text must end with a unique sentinel, like the input of the suffix tree.
+     *
+     * lcp[i] is the length of the longest common prefix of the suffixes sa[i - 1] and sa[i], lcp[0] = 0.
+     * The inverse suffix array is kept because the repeat query needs it.
+     *
+     * If a thread pool is given, the inverse suffix array and the LCP array are computed in parallel; SA-IS itself is sequential.
+     */
+    template<typename CHAR_TYPE, bool DEBUG = false>
+    class SuffixArray {
+        using CharType = CHAR_TYPE;
+        static const bool Debug = DEBUG;
+
+    public:
+        SuffixArray(const CharType* input, int n, Helpers::ThreadPool* pool = nullptr) :
+                text(input),
+                n(n) {
+            //Map the text to an integer alphabet that respects the order of CharType.
+            std::vector<int> integerText(n);
+            for (int i = 0; i < n; i++) {
+                integerText[i] = SuffixTree::orderedByte(text[i]);
+            }
+            sa = sais(integerText, 255);
+            integerText.clear();
+            integerText.shrink_to_fit();
+
+            inverseSa.resize(n);
+            lcp.assign(n, 0);
+            const size_t numberOfChunks = (pool == nullptr) ? 1 : 4 * pool->size();
+            const int chunkSize = n / numberOfChunks + 1;
+            const auto inChunks = [&](const auto& function) {
+                const auto runChunk = [&](size_t chunk, size_t) {
+                    function(std::min<int>(chunk * chunkSize, n), std::min<int>((chunk + 1) * chunkSize, n));
+                };
+                if (pool == nullptr) {
+                    runChunk(0, 0);
+                } else {
+                    pool->parallelFor(numberOfChunks, runChunk);
+                }
+            };
+            inChunks([&](int begin, int end) {
+                for (int i = begin; i < end; i++) {
+                    inverseSa[sa[i]] = i;
+                }
+            });
+            inChunks([&](int begin, int end) {
+                computeLcp(begin, end);
+            });
+
+            if constexpr (Debug) print();
+        }
+
+        /**
+         * Computes the LCP array entries of the suffixes begin..end-1 using Kasai's algorithm: The lcp of suffix i+1 with its predecessor
+         * is at least the lcp of suffix i with its predecessor minus one, so the total number of character comparisons is linear.
+         * Starting a range with h = 0 is correct as well, so disjoint ranges can be computed independently.
+         */
+        inline void computeLcp(int begin, int end) noexcept {
+            int h = 0;
+            for (int i = begin; i < end; i++) {
+                const int rank = inverseSa[i];
+                if (rank == 0) {
+                    h = 0;
+                    continue;
+                }
+                const int j = sa[rank - 1];
+                while (i + h < n && j + h < n && text[i + h] == text[j + h]) h++;
+                lcp[rank] = h;
+                if (h > 0) h--;
+            }
+        }
+
+        /**
+         * SA-IS for the integer text s with characters in [0, upper].
+         *
+         * Suffixes are classified as S-type (smaller than the next suffix) or L-type (larger).
+         * The leftmost S-type positions (LMS) are sorted first (recursively, if their substrings are not unique),
+         * then the order of all other suffixes is induced from them in two linear scans.
+         */
+        static std::vector<int> sais(const std::vector<int>& s, int upper) {
+            const int length = s.size();
+            if (length == 0) return {};
+            if (length == 1) return {0};
+            if (length == 2) {
+                if (s[0] < s[1]) return {0, 1};
+                return {1, 0};
+            }
+
+            std::vector<int> result(length);
+            //isS[i] is true iff suffix i is S-type. The last suffix is L-type.
+            std::vector<uint8_t> isS(length, false);
+            for (int i = length - 2; i >= 0; i--) {
+                isS[i] = (s[i] == s[i + 1]) ? isS[i + 1] : (s[i] < s[i + 1]);
+            }
+
+            //Bucket boundaries: sumL[c] is the start of the L-part of bucket c, sumS[c] the start of its S-part.
+            std::vector<int> sumL(upper + 1, 0), sumS(upper + 1, 0);
+            for (int i = 0; i < length; i++) {
+                if (!isS[i]) {
+                    sumS[s[i]]++;
+                } else {
+                    sumL[s[i] + 1]++;
+                }
+            }
+            for (int i = 0; i <= upper; i++) {
+                sumS[i] += sumL[i];
+                if (i < upper) sumL[i + 1] += sumS[i];
+            }
+
+            //Place the given LMS suffixes and induce the order of L-type and S-type suffixes from them.
+            auto induce = [&](const std::vector<int>& lms) {
+                std::fill(result.begin(), result.end(), -1);
+                std::vector<int> buffer(upper + 1);
+                std::copy(sumS.begin(), sumS.end(), buffer.begin());
+                for (const int d : lms) {
+                    if (d == length) continue;
+                    result[buffer[s[d]]++] = d;
+                }
+                std::copy(sumL.begin(), sumL.end(), buffer.begin());
+                result[buffer[s[length - 1]]++] = length - 1;
+                for (int i = 0; i < length; i++) {
+                    const int v = result[i];
+                    if (v >= 1 && !isS[v - 1]) {
+                        result[buffer[s[v - 1]]++] = v - 1;
+                    }
+                }
+                std::copy(sumL.begin(), sumL.end(), buffer.begin());
+                for (int i = length - 1; i >= 0; i--) {
+                    const int v = result[i];
+                    if (v >= 1 && isS[v - 1]) {
+                        result[--buffer[s[v - 1] + 1]] = v - 1;
+                    }
+                }
+            };
+
+            //Collect the LMS positions.
+            std::vector<int> lmsIndex(length + 1, -1);
+            int numberOfLms = 0;
+            for (int i = 1; i < length; i++) {
+                if (!isS[i - 1] && isS[i]) lmsIndex[i] = numberOfLms++;
+            }
+            std::vector<int> lms;
+            lms.reserve(numberOfLms);
+            for (int i = 1; i < length; i++) {
+                if (!isS[i - 1] && isS[i]) lms.push_back(i);
+            }
+
+            //First pass: sorts the LMS substrings.
+            induce(lms);
+
+            if (numberOfLms > 0) {
+                std::vector<int> sortedLms;
+                sortedLms.reserve(numberOfLms);
+                for (const int v : result) {
+                    if (lmsIndex[v] != -1) sortedLms.push_back(v);
+                }
+                //Name the LMS substrings, equal substrings get equal names.
+                std::vector<int> reducedText(numberOfLms);
+                int reducedUpper = 0;
+                reducedText[lmsIndex[sortedLms[0]]] = 0;
+                for (int i = 1; i < numberOfLms; i++) {
+                    int left = sortedLms[i - 1];
+                    int right = sortedLms[i];
+                    const int endLeft = (lmsIndex[left] + 1 < numberOfLms) ? lms[lmsIndex[left] + 1] : length;
+                    const int endRight = (lmsIndex[right] + 1 < numberOfLms) ? lms[lmsIndex[right] + 1] : length;
+                    bool same = true;
+                    if (endLeft - left != endRight - right) {
+                        same = false;
+                    } else {
+                        while (left < endLeft) {
+                            if (s[left] != s[right]) break;
+                            left++;
+                            right++;
+                        }
+                        if (left == length || s[left] != s[right]) same = false;
+                    }
+                    if (!same) reducedUpper++;
+                    reducedText[lmsIndex[sortedLms[i]]] = reducedUpper;
+                }
+
+                //Sort the LMS suffixes by recursion on the reduced text.
+                const std::vector<int> reducedSa = sais(reducedText, reducedUpper);
+                for (int i = 0; i < numberOfLms; i++) {
+                    sortedLms[i] = lms[reducedSa[i]];
+                }
+                //Second pass: induces the final order from the correctly sorted LMS suffixes.
+                induce(sortedLms);
+            }
+            return result;
+        }
+
+        /**
+         * Prints the suffix array and the LCP array. Used for debugging.
+         */
+        inline void print() const noexcept {
+            std::cout << "SA:  ";
+            for (const int suffix : sa) std::cout << suffix << " ";
+            std::cout << std::endl << "LCP: ";
+            for (const int value : lcp) std::cout << value << " ";
+            std::cout << std::endl;
+        }
+
+        /**
+         * Returns the substring of the input text with length length starting at startIndex.
+         */
+        inline std::string substring(size_t startIndex, size_t length) const noexcept {
+            return std::string(text + startIndex, length);
+        }
+
+    public:
+        //The input text
+        const CharType* text;
+        //Input length
+        int n;
+        //The suffix array, sa[i] is the start of the i-th smallest suffix
+        std::vector<int> sa;
+        //The inverse suffix array, inverseSa[sa[i]] = i
+        std::vector<int> inverseSa;
+        //lcp[i] is the length of the longest common prefix of the suffixes sa[i - 1] and sa[i]
+        std::vector<int> lcp;
+    };
+}
@@ -0,0 +1,94 @@
+#include <iostream>
+#include <vector>
+#include <random>
+#include <cstdint>
+
+#include "../CompressedSuffixTree/BitVector.h"
+#include "../CompressedSuffixTree/WaveletMatrix.h"
+
+/**
+ * Checks rank on bit vectors whose sizes are at the word (64 bits) and block (512 bits) boundaries of the rank directory,
+ * with rank1(size()) in particular, and countLess of the wavelet matrices that are built on them, against a scan.
+ * Prints every mismatch and returns 1 if there was one.
+ */
+
+static size_t failures = 0;
+
+#define Check(condition, message) \
+    if (!(condition)) { \
+        failures++; \
+        std::cout << "FAILED: " << message << std::endl; \
+    }
+
+static const std::vector<size_t> Sizes = {1, 63, 64, 65, 127, 128, 129, 511, 512, 513, 1023, 1024, 1025, 4096, 4097};
+
+/**
+ * The bits of the patterns: all zeros, all ones, alternating and random.
+ */
+static std::vector<bool> pattern(size_t size, int kind, std::mt19937_64& random) {
+    std::vector<bool> bits(size);
+    for (size_t i = 0; i < size; i++) {
+        switch (kind) {
+            case 0: bits[i] = false; break;
+            case 1: bits[i] = true; break;
+            case 2: bits[i] = (i % 2 == 1); break;
+            default: bits[i] = (random() % 3 == 0); break;
+        }
+    }
+    return bits;
+}
+
+static void testRank(std::mt19937_64& random) {
+    for (const size_t size : Sizes) {
+        for (int kind = 0; kind < 4; kind++) {
+            const std::vector<bool> bits = pattern(size, kind, random);
+            //Both ways to fill a bit vector.
+            CompressedSuffixTree::BitVector setBits(size);
+            CompressedSuffixTree::BitVector pushedBits;
+            for (size_t i = 0; i < size; i++) {
+                if (bits[i]) setBits.set(i);
+                pushedBits.pushBack(bits[i]);
+            }
+            setBits.build();
+            pushedBits.build();
+            size_t ones = 0;
+            for (size_t i = 0; i <= size; i++) {
+                Check(setBits.rank1(i) == ones, "rank1(" << i << ") of " << size << " bits (pattern " << kind << ") is " << setBits.rank1(i) << ", expected " << ones);
+                Check(pushedBits.rank1(i) == ones, "rank1(" << i << ") of " << size << " pushed bits (pattern " << kind << ") is " << pushedBits.rank1(i) << ", expected " << ones);
+                Check(setBits.rank0(i) == i - ones, "rank0(" << i << ") of " << size << " bits (pattern " << kind << ") is " << setBits.rank0(i) << ", expected " << i - ones);
+                if (i == size) break;
+                Check(setBits.get(i) == bits[i], "get(" << i << ") of " << size << " bits (pattern " << kind << ")");
+                ones += bits[i];
+            }
+        }
+    }
+}
+
+static void testCountLess(std::mt19937_64& random) {
+    for (const size_t size : Sizes) {
+        for (const uint32_t maxValue : {1u, 3u, 64u, 1000u}) {
+            std::vector<uint32_t> values(size);
+            for (uint32_t& value : values) value = random() % (maxValue + 1);
+            const CompressedSuffixTree::IntegerWaveletMatrix matrix(values);
+            for (uint32_t value = 0; value <= maxValue + 1; value += std::max<uint32_t>(1, maxValue / 7)) {
+                size_t less = 0;
+                for (size_t i = 0; i <= size; i++) {
+                    Check(matrix.countLess(value, i) == less, "countLess(" << value << ", " << i << ") of " << size << " values <= " << maxValue << " is " << matrix.countLess(value, i) << ", expected " << less);
+                    if (i < size) less += (values[i] < value);
+                }
+            }
+        }
+    }
+}
+
+int main() {
+    std::mt19937_64 random(42);
+    testRank(random);
+    testCountLess(random);
+    if (failures > 0) {
+        std::cout << failures << " checks failed." << std::endl;
+        return 1;
+    }
+    std::cout << "All bit vector checks passed." << std::endl;
+    return 0;
+}
@@ -0,0 +1,82 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <random>
+
+#include "../Query/TopKQuery.h"
+#include "../Helpers/TopKProfiler.h"
+#include "../UkkonenSuffixTree/SuffixTree.h"
+#include "../UkkonenSuffixTree/FrozenSuffixTree.h"
+
+/**
+ * Compares the topk queries that the length index answers (runQuery(l, k)) with the bfs over the candidates (runQuery(l, k, buffer))
+ * for every length l and every k up to one more than the number of candidates, on small texts whose lengths cross the word and block
+ * boundaries of the bit vectors (64, 128, 192 and 512 characters), on the suffix tree and on its frozen copy.
+ * Prints every mismatch and returns 1 if there was one.
+ */
+
+static size_t failures = 0;
+
+using CharType = char;
+static const CharType Sentinel = '\0';
+
+template<typename TREE>
+static void compare(const std::string& name, TREE& tree) {
+    Query::TopKQuery<CharType, Sentinel, Query::TopKNoProfiler, false, SuffixTree::AdaptiveChildren<CharType>, int, TREE> query(&tree);
+    typename decltype(query)::CandidateBuffer candidates;
+    for (int l = 1; l < tree.n; l++) {
+        candidates.clear();
+        query.collectingBfs(candidates, l);
+        const int numberOfCandidates = candidates.size();
+        if (query.lengthIndex->numberOfCandidates(l) != candidates.size()) {
+            failures++;
+            std::cout << "FAILED: " << name << " has " << query.lengthIndex->numberOfCandidates(l) << " indexed candidates for l=" << l << ", expected " << numberOfCandidates << std::endl;
+        }
+        for (int k = 1; k <= numberOfCandidates + 1; k++) {
+            const int indexed = query.runQuery(l, k);
+            const int scanned = query.runQuery(l, k, candidates);
+            if (indexed != scanned) {
+                failures++;
+                std::cout << "FAILED: " << name << " l=" << l << " k=" << k << ": the length index returns " << indexed << ", the bfs " << scanned << std::endl;
+            }
+        }
+    }
+}
+
+static void test(const std::string& name, std::string text) {
+    text.push_back(Sentinel);
+    SuffixTree::SuffixTree<CharType> tree(text.c_str(), text.length());
+    compare(name, tree);
+    SuffixTree::FrozenSuffixTree<CharType> frozenTree(tree);
+    compare(name + " (frozen)", frozenTree);
+}
+
+static std::string repeat(const std::string& part, size_t times) {
+    std::string result;
+    for (size_t i = 0; i < times; i++) result += part;
+    return result;
+}
+
+int main() {
+    for (const size_t times : {31, 32, 33, 63, 64, 96, 256}) {
+        test("ca*" + std::to_string(times), repeat("ca", times));
+    }
+    test("ab*64", repeat("ab", 64));
+    test("a*127", repeat("a", 127));
+    test("a*128", repeat("a", 128));
+    test("abc*43", repeat("abc", 43));
+    std::mt19937_64 random(42);
+    for (const std::string alphabet : {"ab", "acgt", "abcdefghij"}) {
+        for (const size_t length : {63, 64, 65, 127, 128, 129, 200, 511, 512}) {
+            std::string text(length, ' ');
+            for (CharType& character : text) character = alphabet[random() % alphabet.length()];
+            test("random " + alphabet + " " + std::to_string(length), text);
+        }
+    }
+    if (failures > 0) {
+        std::cout << failures << " checks failed." << std::endl;
+        return 1;
+    }
+    std::cout << "All length index checks passed." << std::endl;
+    return 0;
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+
+#include "Node.h"
+#include "NodeArena.h"
+#include "../Helpers/ThreadPool.h"
+
+namespace SuffixTree {
+    /**
+     * Computes the annotations of all nodes that the queries on a complete suffix tree need, in one pass after the construction:
+     *  - stringDepth: the length of the path from the root to the node, including its own edge.
+     *  - representedSuffix: the start of a suffix below the node (endIndex - stringDepth). For leaves, that is their suffix.
+     *  - numberOfLeaves: the number of leaves in the subtree of the node, the sentinel leaves included.
+     * The tree is not changed otherwise, in particular the sentinel leaves stay, so that the topk and all repeat queries can share one tree.
+     * Data that only one query needs (the rank of the inner nodes of RepeatQuery, the leaf ranks of SmallerHalfRepeatQuery) is kept by that query.
+     *
+     * The pass is iterative with an explicit stack, so repetitive texts with very deep trees do not overflow the call stack.
+     * With a thread pool, the top of the tree is expanded level by level until there are enough independent subtrees, the subtrees are
+     * annotated concurrently and the counts of the top nodes are summed up afterwards.
+     */
+    template<typename NODE, typename NODE_INDEX = NodeIndex>
+    class Annotation {
+        using NodeType = NODE;
+        using NodeIndex = NODE_INDEX;
+        using Index = typename NodeType::Index;
+        //The root is the first node in the arena, see SuffixTree::Root.
+        static constexpr NodeIndex Root = 0;
+        //Many more subtrees than threads so that the dynamic scheduling can balance subtrees of different size.
+        static constexpr size_t SubtreesPerThread = 16;
+
+        struct StackEntry {
+            NodeIndex node;
+            //True when all children of node were annotated and only its numberOfLeaves is missing.
+            bool leaving;
+        };
+
+    public:
+        Annotation(NodeArena<NodeType, NodeIndex>& nodes) :
+                nodes(nodes) {
+        }
+
+        inline void run() {
+            annotateRoot();
+            annotateSubtree(Root);
+        }
+
+        inline void run(Helpers::ThreadPool& pool) {
+            if (pool.size() == 1) {
+                run();
+                return;
+            }
+            annotateRoot();
+            //The inner nodes above the subtrees, in bfs order.
+            std::vector<NodeIndex> top;
+            std::vector<NodeIndex> subtrees = {Root};
+            std::vector<NodeIndex> nextSubtrees;
+            bool expanded = true;
+            while (expanded && subtrees.size() < SubtreesPerThread * pool.size()) {
+                expanded = false;
+                nextSubtrees.clear();
+                for (const NodeIndex index : subtrees) {
+                    const NodeType& node = nodes[index];
+                    if (!node.hasChildren()) {
+                        nextSubtrees.emplace_back(index);
+                        continue;
+                    }
+                    top.emplace_back(index);
+                    for (const auto & [key, child] : node.children) {
+                        annotateChild(node, child);
+                        nextSubtrees.emplace_back(child);
+                    }
+                    expanded = true;
+                }
+                subtrees.swap(nextSubtrees);
+            }
+            pool.parallelFor(subtrees.size(), [&](size_t subtree, size_t) {
+                annotateSubtree(subtrees[subtree]);
+            });
+            //Children come after their parents in bfs order.
+            for (auto index = top.rbegin(); index != top.rend(); index++) {
+                countLeaves(*index);
+            }
+        }
+
+    private:
+        inline void annotateRoot() noexcept {
+            NodeType& root = nodes[Root];
+            root.stringDepth = 0;
+            root.representedSuffix = 0;
+        }
+
+        /**
+         * Annotates the subtree of the given node, whose stringDepth and representedSuffix are already set.
+         */
+        inline void annotateSubtree(NodeIndex subtreeRoot) {
+            std::vector<StackEntry> stack;
+            stack.emplace_back(StackEntry{subtreeRoot, false});
+            while (!stack.empty()) {
+                const StackEntry entry = stack.back();
+                stack.pop_back();
+                if (entry.leaving) {
+                    countLeaves(entry.node);
+                    continue;
+                }
+                const NodeType& node = nodes[entry.node];
+                if (!node.hasChildren()) {
+                    nodes[entry.node].numberOfLeaves = 1;
+                    continue;
+                }
+                stack.emplace_back(StackEntry{entry.node, true});
+                for (const auto & [key, child] : node.children) {
+                    annotateChild(node, child);
+                    //Leaves are finished right away, they do not need to go through the stack.
+                    if (nodes[child].hasChildren()) {
+                        stack.emplace_back(StackEntry{child, false});
+                    } else {
+                        nodes[child].numberOfLeaves = 1;
+                    }
+                }
+            }
+        }
+
+        inline void annotateChild(const NodeType& parent, NodeIndex index) noexcept {
+            NodeType& child = nodes[index];
+            child.stringDepth = parent.stringDepth + child.endIndex - child.startIndex;
+            child.representedSuffix = child.endIndex - child.stringDepth;
+        }
+
+        inline void countLeaves(NodeIndex index) noexcept {
+            NodeType& node = nodes[index];
+            Index numberOfLeaves = 0;
+            for (const auto & [key, child] : node.children) {
+                numberOfLeaves += nodes[child].numberOfLeaves;
+            }
+            node.numberOfLeaves = numberOfLeaves;
+        }
+
+    private:
+        NodeArena<NodeType, NodeIndex>& nodes;
+    };
+}
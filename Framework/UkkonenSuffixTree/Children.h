@@ -0,0 +1,488 @@
+#pragma once
+
+#include <map>
+#include <array>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include <limits>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "Helpers.h"
+#include "NodeArena.h"
+#include "../Helpers/Memory.h"
+
+namespace SuffixTree {
+    /**
+     * Child containers map the initial character of an outgoing edge to the child node.
+     * They are the policy parameter CHILDREN of Node and SuffixTree.
+     *
+     * All containers provide the same interface:
+     *  - NodeIndex is the type of the children (NODE_INDEX, see NodeArena.h),
+     *  - get(key) returns the child for key or NoNode,
+     *  - set(key, child) adds or replaces the child for key,
+     *  - erase(key) removes the child for key and returns the number of removed children,
+     *  - size(), empty() and iteration over (key, child) pairs in the order of the keys.
+     *    The order is the order of CharType, i.e., the same order that std::map<CharType, ...> uses.
+     *    The queries rely on that to get lexicographic order.
+     */
+
+    /**
+     * Maps a character to a byte such that the byte order equals the order of CharType.
+     * For signed characters, flipping the sign bit moves the negative values in front of the positive ones.
+     */
+    template<typename CHAR_TYPE>
+    inline constexpr uint8_t orderedByte(CHAR_TYPE key) noexcept {
+        if constexpr (std::is_signed_v<CHAR_TYPE>) {
+            return static_cast<uint8_t>(key) ^ 0x80;
+        } else {
+            return static_cast<uint8_t>(key);
+        }
+    }
+
+    /**
+     * Inverse of orderedByte.
+     */
+    template<typename CHAR_TYPE>
+    inline constexpr CHAR_TYPE characterOfOrderedByte(uint8_t byte) noexcept {
+        if constexpr (std::is_signed_v<CHAR_TYPE>) {
+            return static_cast<CHAR_TYPE>(byte ^ 0x80);
+        } else {
+            return static_cast<CHAR_TYPE>(byte);
+        }
+    }
+
+    /**
+     * The original container, a std::map. It is kept as a reference for the evaluation of the other containers.
+     * Its nodes are accounted as MemoryComponent::Children.
+     */
+    template<typename CHAR_TYPE, typename NODE_INDEX = NodeIndex>
+    class MapChildren {
+        using CharType = CHAR_TYPE;
+
+    public:
+        using NodeIndex = NODE_INDEX;
+        static constexpr NodeIndex NoNode = std::numeric_limits<NodeIndex>::max();
+
+        inline NodeIndex get(CharType key) const noexcept {
+            auto child = children.find(key);
+            if (child == children.end()) return NoNode;
+            return child->second;
+        }
+
+        inline void set(CharType key, NodeIndex child) noexcept {
+            children[key] = child;
+        }
+
+        inline size_t erase(CharType key) noexcept {
+            return children.erase(key);
+        }
+
+        inline size_t size() const noexcept {
+            return children.size();
+        }
+
+        inline bool empty() const noexcept {
+            return children.empty();
+        }
+
+        inline auto begin() const noexcept {
+            return children.begin();
+        }
+
+        inline auto end() const noexcept {
+            return children.end();
+        }
+
+    private:
+        std::map<CharType, NodeIndex, std::less<CharType>, Helpers::CountingAllocator<std::pair<const CharType, NodeIndex>, Helpers::MemoryComponent::Children>> children;
+    };
+
+    /**
+     * A fixed alphabet, given as its characters in ascending order.
+     * Used for DenseChildren, where every character of the alphabet has its own slot.
+     */
+    template<typename CHAR_TYPE, CHAR_TYPE... CHARACTERS>
+    class FixedAlphabet {
+        using CharType = CHAR_TYPE;
+
+    public:
+        static constexpr size_t Size = sizeof...(CHARACTERS);
+        static constexpr std::array<CharType, Size> Characters = { CHARACTERS... };
+        //Marks characters that are not part of the alphabet.
+        static constexpr uint8_t NoSlot = 0xFF;
+
+        static_assert(sizeof(CharType) == 1, "Fixed alphabets are only implemented for byte characters.");
+        static_assert(Size < NoSlot, "Too many characters for a fixed alphabet.");
+
+        /**
+         * Returns the slot (the rank in the alphabet) of the given character.
+         */
+        static inline constexpr uint8_t slot(CharType key) noexcept {
+            return Slots[static_cast<uint8_t>(key)];
+        }
+
+        /**
+         * Checks if all characters of the given text are part of the alphabet.
+         */
+        static inline bool contains(const CharType* text, size_t length) noexcept {
+            for (size_t i = 0; i < length; i++) {
+                if (slot(text[i]) == NoSlot) return false;
+            }
+            return true;
+        }
+
+    private:
+        static constexpr std::array<uint8_t, 256> computeSlots() noexcept {
+            std::array<uint8_t, 256> slots{};
+            for (uint8_t& s : slots) s = NoSlot;
+            for (size_t i = 0; i < Size; i++) {
+                slots[static_cast<uint8_t>(Characters[i])] = static_cast<uint8_t>(i);
+            }
+            return slots;
+        }
+
+        static constexpr std::array<uint8_t, 256> Slots = computeSlots();
+    };
+
+    //DNA texts, including the line break at the end of the files and the sentinel.
+    using UpperCaseDnaAlphabet = FixedAlphabet<char, '\0', '\n', 'A', 'C', 'G', 'N', 'T'>;
+    using LowerCaseDnaAlphabet = FixedAlphabet<char, '\0', '\n', 'a', 'c', 'g', 'n', 't'>;
+
+    /**
+     * Direct-indexed array with one slot per character of a tiny alphabet, e.g., DNA.
+     * Lookups are a single array access, there is no search at all.
+     * The texts must only contain characters of the alphabet.
+     */
+    template<typename CHAR_TYPE, typename ALPHABET, typename NODE_INDEX = NodeIndex>
+    class DenseChildren {
+        using CharType = CHAR_TYPE;
+
+    public:
+        using Alphabet = ALPHABET;
+        using NodeIndex = NODE_INDEX;
+        static constexpr NodeIndex NoNode = std::numeric_limits<NodeIndex>::max();
+
+        DenseChildren() {
+            children.fill(NoNode);
+        }
+
+        inline NodeIndex get(CharType key) const noexcept {
+            AssertMsg(Alphabet::slot(key) != Alphabet::NoSlot, "Character " << (int)key << " is not part of the alphabet.");
+            return children[Alphabet::slot(key)];
+        }
+
+        inline void set(CharType key, NodeIndex child) noexcept {
+            AssertMsg(Alphabet::slot(key) != Alphabet::NoSlot, "Character " << (int)key << " is not part of the alphabet.");
+            children[Alphabet::slot(key)] = child;
+        }
+
+        inline size_t erase(CharType key) noexcept {
+            NodeIndex& child = children[Alphabet::slot(key)];
+            if (child == NoNode) return 0;
+            child = NoNode;
+            return 1;
+        }
+
+        inline size_t size() const noexcept {
+            size_t result = 0;
+            for (const NodeIndex child : children) {
+                result += (child != NoNode);
+            }
+            return result;
+        }
+
+        inline bool empty() const noexcept {
+            for (const NodeIndex child : children) {
+                if (child != NoNode) return false;
+            }
+            return true;
+        }
+
+        /**
+         * Iterates over the occupied slots, yields (key, child) pairs.
+         */
+        class Iterator {
+        public:
+            Iterator(const DenseChildren* container, size_t slot) : container(container), slot(slot) {
+                skipEmpty();
+            }
+
+            inline std::pair<CharType, NodeIndex> operator*() const noexcept {
+                return std::make_pair(Alphabet::Characters[slot], container->children[slot]);
+            }
+
+            inline Iterator& operator++() noexcept {
+                slot++;
+                skipEmpty();
+                return *this;
+            }
+
+            inline bool operator!=(const Iterator& other) const noexcept {
+                return slot != other.slot;
+            }
+
+        private:
+            inline void skipEmpty() noexcept {
+                while (slot < Alphabet::Size && container->children[slot] == NoNode) slot++;
+            }
+
+            const DenseChildren* container;
+            size_t slot;
+        };
+
+        inline Iterator begin() const noexcept {
+            return Iterator(this, 0);
+        }
+
+        inline Iterator end() const noexcept {
+            return Iterator(this, Alphabet::Size);
+        }
+
+    private:
+        std::array<NodeIndex, Alphabet::Size> children;
+    };
+
+    /**
+     * Container that adapts to the fanout of its node:
+     *  - Up to InlineCapacity children are stored inline as sorted small-vector. Keys are searched with SIMD (SSE2) if available.
+     *    Most inner nodes have only two or three children, so this covers nearly all nodes.
+     *  - Nodes with more children (e.g., the root) switch to a 256-entry table indexed by the character.
+     *    A bitmap of the occupied entries allows to iterate over the children without scanning the whole table.
+     *
+     * Only implemented for byte characters. The tables are accounted as MemoryComponent::Children, the inline children are part of the node.
+     */
+    template<typename CHAR_TYPE, typename NODE_INDEX = NodeIndex>
+    class AdaptiveChildren {
+        using CharType = CHAR_TYPE;
+        static_assert(sizeof(CharType) == 1, "AdaptiveChildren is only implemented for byte characters.");
+
+    public:
+        using NodeIndex = NODE_INDEX;
+        static constexpr NodeIndex NoNode = std::numeric_limits<NodeIndex>::max();
+        static constexpr uint8_t InlineCapacity = 8;
+
+        AdaptiveChildren() : count(0) {}
+
+        AdaptiveChildren(const AdaptiveChildren& other) : count(other.count) {
+            if (isTable()) {
+                table = new Table(*other.table);
+                Helpers::MemoryAccounting::allocated(Helpers::MemoryComponent::Children, sizeof(Table));
+            } else {
+                small = other.small;
+            }
+        }
+
+        AdaptiveChildren(AdaptiveChildren&& other) noexcept : count(other.count) {
+            if (isTable()) {
+                table = other.table;
+                other.count = 0;
+            } else {
+                small = other.small;
+            }
+        }
+
+        AdaptiveChildren& operator=(AdaptiveChildren other) noexcept {
+            //The small-vector is larger than the table pointer, so swapping it swaps either representation.
+            std::swap(count, other.count);
+            std::swap(small, other.small);
+            return *this;
+        }
+
+        ~AdaptiveChildren() {
+            if (!isTable()) return;
+            Helpers::MemoryAccounting::released(Helpers::MemoryComponent::Children, sizeof(Table));
+            delete table;
+        }
+
+        inline NodeIndex get(CharType key) const noexcept {
+            if (isTable()) return table->children[orderedByte(key)];
+            const int position = find(key);
+            return position < 0 ? NoNode : small.values[position];
+        }
+
+        inline void set(CharType key, NodeIndex child) noexcept {
+            if (isTable()) {
+                if (table->children[orderedByte(key)] == NoNode) count++;
+                table->set(orderedByte(key), child);
+                return;
+            }
+            const int position = find(key);
+            if (position >= 0) {
+                small.values[position] = child;
+                return;
+            }
+            if (count == InlineCapacity) {
+                promote();
+                set(key, child);
+                return;
+            }
+            //insert into the sorted small-vector
+            int i = count;
+            while (i > 0 && small.keys[i - 1] > key) {
+                small.keys[i] = small.keys[i - 1];
+                small.values[i] = small.values[i - 1];
+                i--;
+            }
+            small.keys[i] = key;
+            small.values[i] = child;
+            count++;
+        }
+
+        inline size_t erase(CharType key) noexcept {
+            if (isTable()) {
+                if (table->children[orderedByte(key)] == NoNode) return 0;
+                table->clear(orderedByte(key));
+                count--;
+                //The table is kept even if the node has few children left, erasing is rare.
+                return 1;
+            }
+            const int position = find(key);
+            if (position < 0) return 0;
+            for (int i = position; i + 1 < count; i++) {
+                small.keys[i] = small.keys[i + 1];
+                small.values[i] = small.values[i + 1];
+            }
+            count--;
+            return 1;
+        }
+
+        inline size_t size() const noexcept {
+            return isTable() ? count - TableFlag : count;
+        }
+
+        inline bool empty() const noexcept {
+            return size() == 0;
+        }
+
+        /**
+         * Iterates over the children in key order, yields (key, child) pairs.
+         * For the inline representation, position is the index in the small-vector, for the table it is the table entry.
+         */
+        class Iterator {
+        public:
+            Iterator(const AdaptiveChildren* container, unsigned position) :
+                    container(container),
+                    position(container->isTable() ? container->table->nextOccupied(position) : position) {
+            }
+
+            inline std::pair<CharType, NodeIndex> operator*() const noexcept {
+                if (container->isTable()) return std::make_pair(characterOfOrderedByte<CharType>(position), container->table->children[position]);
+                return std::make_pair(container->small.keys[position], container->small.values[position]);
+            }
+
+            inline Iterator& operator++() noexcept {
+                position++;
+                if (container->isTable()) position = container->table->nextOccupied(position);
+                return *this;
+            }
+
+            inline bool operator!=(const Iterator& other) const noexcept {
+                return position != other.position;
+            }
+
+        private:
+            const AdaptiveChildren* container;
+            unsigned position;
+        };
+
+        inline Iterator begin() const noexcept {
+            return Iterator(this, 0);
+        }
+
+        inline Iterator end() const noexcept {
+            return Iterator(this, isTable() ? Table::Size : count);
+        }
+
+    private:
+        /**
+         * 256-entry table for nodes with high fanout.
+         */
+        struct Table {
+            static constexpr unsigned Size = 256;
+
+            Table() : occupied{0, 0, 0, 0} {
+                std::fill(children, children + Size, NoNode);
+            }
+
+            inline void set(uint8_t entry, NodeIndex child) noexcept {
+                children[entry] = child;
+                occupied[entry / 64] |= (uint64_t(1) << (entry % 64));
+            }
+
+            inline void clear(uint8_t entry) noexcept {
+                children[entry] = NoNode;
+                occupied[entry / 64] &= ~(uint64_t(1) << (entry % 64));
+            }
+
+            /**
+             * Returns the first occupied entry >= entry, or Size if there is none.
+             */
+            inline unsigned nextOccupied(unsigned entry) const noexcept {
+                while (entry < Size) {
+                    const uint64_t word = occupied[entry / 64] >> (entry % 64);
+                    if (word != 0) return entry + __builtin_ctzll(word);
+                    entry = (entry / 64 + 1) * 64;
+                }
+                return Size;
+            }
+
+            uint64_t occupied[4];
+            NodeIndex children[Size];
+        };
+
+        struct SmallVector {
+            CharType keys[InlineCapacity];
+            NodeIndex values[InlineCapacity];
+        };
+
+        //count >= TableFlag marks the table representation, the number of children is then count - TableFlag.
+        static constexpr uint16_t TableFlag = 0x8000;
+
+        inline bool isTable() const noexcept {
+            return count >= TableFlag;
+        }
+
+        /**
+         * Returns the position of key in the small-vector or -1.
+         */
+        inline int find(CharType key) const noexcept {
+#ifdef __SSE2__
+            static_assert(InlineCapacity == 8, "The SIMD search compares exactly 8 keys at once.");
+            //Compare all 8 keys at once and mask out the unused positions.
+            const __m128i keys = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(small.keys));
+            const __m128i matches = _mm_cmpeq_epi8(keys, _mm_set1_epi8(static_cast<char>(key)));
+            const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(matches)) & ((1u << count) - 1);
+            return mask == 0 ? -1 : __builtin_ctz(mask);
+#else
+            for (int i = 0; i < count; i++) {
+                if (small.keys[i] == key) return i;
+            }
+            return -1;
+#endif
+        }
+
+        /**
+         * Moves the inline children to a new table.
+         */
+        inline void promote() {
+            Table* newTable = new Table();
+            Helpers::MemoryAccounting::allocated(Helpers::MemoryComponent::Children, sizeof(Table));
+            for (int i = 0; i < count; i++) {
+                newTable->set(orderedByte(small.keys[i]), small.values[i]);
+            }
+            count += TableFlag;
+            table = newTable;
+        }
+
+        union {
+            SmallVector small;
+            Table* table;
+        };
+        uint16_t count;
+    };
+}
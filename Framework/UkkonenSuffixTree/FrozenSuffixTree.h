@@ -0,0 +1,210 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <utility>
+#include <iterator>
+
+#include "NodeArena.h"
+#include "../Helpers/Memory.h"
+
+namespace SuffixTree {
+    /**
+     * The children of a FrozenNode: the nodes first..first+count-1 of the frozen tree, in the order of the original children.
+     * The first characters of the edges are not stored, the queries only iterate over all children. The key that the iteration
+     * yields (for the same structured bindings as the other child containers) is the position of the child among its siblings.
+     */
+    template<typename NODE_INDEX>
+    class FrozenChildren {
+        using NodeIndex = NODE_INDEX;
+
+    public:
+        class Iterator {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = std::pair<NodeIndex, NodeIndex>;
+            using difference_type = std::ptrdiff_t;
+            using pointer = void;
+            using reference = value_type;
+
+            Iterator(NodeIndex first, NodeIndex child) :
+                    first(first),
+                    child(child) {
+            }
+
+            inline value_type operator*() const noexcept {
+                return value_type(child - first, child);
+            }
+
+            inline Iterator& operator++() noexcept {
+                child++;
+                return *this;
+            }
+
+            inline Iterator operator++(int) noexcept {
+                Iterator result = *this;
+                child++;
+                return result;
+            }
+
+            inline bool operator==(const Iterator& other) const noexcept {
+                return child == other.child;
+            }
+
+            inline bool operator!=(const Iterator& other) const noexcept {
+                return child != other.child;
+            }
+
+        private:
+            NodeIndex first;
+            NodeIndex child;
+        };
+
+        inline Iterator begin() const noexcept {
+            return Iterator(first, first);
+        }
+
+        inline Iterator end() const noexcept {
+            return Iterator(first, first + count);
+        }
+
+        inline size_t size() const noexcept {
+            return count;
+        }
+
+        inline bool empty() const noexcept {
+            return count == 0;
+        }
+
+    public:
+        NodeIndex first;
+        NodeIndex count;
+    };
+
+    /**
+     * A node of the FrozenSuffixTree. It only has the annotations that the queries read (see Annotation.h) and its child range,
+     * 20 bytes for 32-bit positions, a quarter of a Node with its suffix link, edge and adaptive child container.
+     */
+    template<typename INDEX = int>
+    struct FrozenNode {
+        using Index = INDEX;
+        using NodeIndex = NodeIndexOf<Index>;
+
+        inline bool hasChildren() const noexcept {
+            return !children.empty();
+        }
+
+        FrozenChildren<NodeIndex> children;
+        Index numberOfLeaves;
+        Index stringDepth;
+        Index representedSuffix;
+    };
+
+    /**
+     * An immutable copy of an annotated suffix tree in a compact layout for the query traversals.
+     *
+     * After the construction, the nodes of a suffix tree are in allocation order, which has nothing to do with the order in which the
+     * queries visit them, and the children of a node are reached through its child container. Every step of a traversal is a cache miss.
+     * Freezing copies the nodes in bfs order:
+     *  - The children of every node are consecutive and in the order of the original children, so a node only stores their range.
+     *  - The bfs of the topk query and the collection of the inner nodes of the repeat query visit the nodes in increasing positions,
+     *    so the hardware prefetcher streams them in. The depth-first traversals still find all siblings in one or two cache lines.
+     *  - Everything that only the construction needs is dropped: suffix links, edges (startIndex, endIndex) and child containers.
+     *    The edge characters are not stored either, see FrozenChildren.
+     * The van Emde Boas layout would also give locality to root-to-leaf paths, but none of the queries walks such paths: they either
+     * scan the tree level by level or visit all nodes of a subtree.
+     *
+     * The queries are templates over the tree type and run on the frozen tree as on the original one, with the same results:
+     * the bfs and dfs orders of the nodes, and therefore all tie-breaks, are the same. The original tree is not needed afterwards.
+     * The nodes are accounted as MemoryComponent::NodeArena (Helpers/Memory.h).
+     */
+    template<typename CHAR_TYPE, typename INDEX = int>
+    class FrozenSuffixTree {
+        using CharType = CHAR_TYPE;
+
+    public:
+        using Index = INDEX;
+        using NodeIndex = NodeIndexOf<Index>;
+        using NodeType = FrozenNode<Index>;
+        static constexpr NodeIndex NoNode = NoNodeOf<Index>;
+        //The root is the first node in bfs order.
+        static constexpr NodeIndex Root = 0;
+        //The nodes are copied with their annotations, the queries must not compute them again.
+        static constexpr bool IsAnnotated = true;
+        static constexpr bool IsGrowing = false;
+
+        /**
+         * Freezes the given suffix tree (SuffixTree or a tree with the same interface), which is annotated first if necessary.
+         */
+        template<typename TREE>
+        explicit FrozenSuffixTree(TREE& tree) :
+                text(tree.text),
+                n(tree.n) {
+            if constexpr (!TREE::IsAnnotated) tree.annotate();
+            freeze(tree);
+        }
+
+        inline const NodeType& getNode(NodeIndex index) const noexcept {
+            return nodes[index];
+        }
+
+        inline size_t numberOfNodes() const noexcept {
+            return nodes.size();
+        }
+
+        /**
+         * Returns the substring of the text with length length starting at startIndex.
+         */
+        inline std::string substring(size_t startIndex, size_t length) const noexcept {
+            return std::string(text + startIndex, length);
+        }
+
+        /**
+         * Compactly prints the subtree rooted at the given node. Used for debugging.
+         */
+        inline void printNode(NodeIndex index, int depth) const noexcept {
+            const NodeType& node = nodes[index];
+            std::cout << std::string(depth, ' ') << "Node " << index << ", numberOfLeaves: " << node.numberOfLeaves << ", stringDepth: " << node.stringDepth << ", representedSuffix: " << node.representedSuffix << std::endl;
+            for (const auto & [key, child] : node.children) {
+                printNode(child, depth + 4);
+            }
+        }
+
+    private:
+        /**
+         * Copies the nodes of tree in bfs order. The bfs queue is the list of original nodes in their new order: a node is appended
+         * when its parent is copied, so its children start at the current end of the list.
+         */
+        template<typename TREE>
+        inline void freeze(const TREE& tree) {
+            const size_t numberOfNodes = tree.numberOfNodes();
+            nodes.reserve(numberOfNodes);
+            std::vector<typename TREE::NodeIndex> original;
+            original.reserve(numberOfNodes);
+            original.emplace_back(TREE::Root);
+            for (size_t position = 0; position < original.size(); position++) {
+                const auto& node = tree.getNode(original[position]);
+                NodeType& frozen = nodes.emplace_back();
+                frozen.children.first = static_cast<NodeIndex>(original.size());
+                for (const auto & [key, child] : node.children) {
+                    original.emplace_back(child);
+                }
+                frozen.children.count = static_cast<NodeIndex>(original.size() - frozen.children.first);
+                frozen.numberOfLeaves = node.numberOfLeaves;
+                frozen.stringDepth = node.stringDepth;
+                frozen.representedSuffix = node.representedSuffix;
+            }
+        }
+
+    public:
+        //The text of the original tree, including the sentinel. It is not owned by the tree.
+        const CharType* text;
+        //Text length
+        Index n;
+
+    private:
+        //All nodes in bfs order.
+        Helpers::CountedVector<NodeType, Helpers::MemoryComponent::NodeArena> nodes;
+    };
+}
@@ -1,7 +1,10 @@
 #pragma once
 
-#include <map>
+#include <type_traits>
+
 #include "Helpers.h"
+#include "NodeArena.h"
+#include "Children.h"
 
 namespace SuffixTree {
     /**
@@ -9,23 +12,33 @@ namespace SuffixTree {
      *
      * The structure is as follows:
      *
-     *                 [startIndex, endIndex)                map: initial character --> child
+     *                 [startIndex, endIndex)             children: initial character --> child
      *    [parent]  ----------------------------> [this] --------------------------------------->* children
      *
      * where [startIndex, endIndex) is the substring represented by the edge into this node.
      * The parent pointer is omitted because it is never used.
+     * All nodes live in the NodeArena of their suffix tree, so children and suffix links are stored as NodeIndex.
+     * The container for the children is a policy, see Children.h.
      *
      * Each node has numberOfLeaves, stringDepth and representedSuffix as preparation for the queries.
+     *
+     * All positions, lengths and counts have the type INDEX (int or int64_t for texts with 2^31 characters or more), the links have the
+     * unsigned type of the same width (see NodeArena.h).
      */
-    template<typename CHAR_TYPE>
+    template<typename CHAR_TYPE, typename CHILDREN = AdaptiveChildren<CHAR_TYPE>, typename INDEX = int>
     class Node {
         using CharType = CHAR_TYPE;
+        using Children = CHILDREN;
 
     public:
+        using Index = INDEX;
+        using NodeIndex = NodeIndexOf<Index>;
+        static_assert(std::is_same_v<NodeIndex, typename Children::NodeIndex>, "The child container must store node indices of the width of INDEX.");
+
         /**
          * Generate a new node with the given entries.
          */
-        Node(int startIndex, int* endIndex, Node<CharType>* suffixLink = NULL) :
+        Node(Index startIndex, Index endIndex, NodeIndex suffixLink = NoNodeOf<Index>) :
                 startIndex(startIndex),
                 endIndex(endIndex),
                 suffixLink(suffixLink),
@@ -35,27 +48,28 @@ namespace SuffixTree {
         }
 
         /**
-         * Adds value as a new child for initial character key and ensures that the child's parent pointer is correct.
+         * Adds value as a new child for initial character key.
          */
-        inline void addChild(CharType key, Node* value) noexcept {
-            children[key] = value;
+        inline void addChild(CharType key, NodeIndex value) noexcept {
+            children.set(key, value);
         }
 
         /**
          * Returns the node for the given initial character of an outgoing edge.
          */
-        inline Node<CharType>* getChild(CharType key) const noexcept {
-            auto child = children.find(key);
-            if (child == children.end()) return NULL;
-            //std::cout << "xxxxx found child: " << child->first << ", " << child->second << std::endl;
-            return child->second;
+        inline NodeIndex getChild(CharType key) const noexcept {
+            return children.get(key);
         }
 
         /**
          * The length of the substring along the edge that enters this node.
+         *
+         * During the construction, all leaf edges end at currentEnd. Leaves are created with the final end index
+         * of the text (or SuffixTree::OpenEnd while the text grows) instead and inner nodes always end at or before currentEnd, so the minimum is the correct end for all nodes.
+         * After the construction, currentEnd is the end of the text.
          */
-        inline int getSubstringLength() const noexcept {
-            return *endIndex - startIndex;
+        inline Index getSubstringLength(Index currentEnd) const noexcept {
+            return std::min(endIndex, currentEnd) - startIndex;
         }
 
         /**
@@ -65,42 +79,17 @@ namespace SuffixTree {
             return !children.empty();
         }
 
-        /**
-         * Prints the subtree rooted at this node. Used for debugging.
-         */
-        inline void print(int depth) const noexcept {
-            std::cout << std::string(depth, ' ') << "Node " << this << " [" << startIndex << ", " << *endIndex << "), suffixLink " << suffixLink << std::endl;
-            for (std::pair<CharType, Node<CharType>*> element : children) {
-                std::cout << std::string(depth + 2, ' ') << "Key " << element.first << " is child " << element.second << std::endl;
-                element.second->print(depth + 4);
-            }
-        }
-
-        /**
-         * Compactly prints the subtree rooted at this node. Used for debugging.
-         */
-        inline void printSimple(int depth) const noexcept {
-            std::cout << " [" << startIndex << ", " << *endIndex << "), numberOfLeaves: " << numberOfLeaves << ", stringDepth: " << stringDepth << ", representedSuffix: " << representedSuffix << std::endl;
-            for (std::pair<CharType, Node<CharType>*> element : children) {
-                std::cout << std::string(depth + 4, ' ') << element.first << ": ";
-                element.second->printSimple(depth + 4);
-            }
-        }
-
-
-
     public:
-        int startIndex;//inclusive
-        int* endIndex;//exclusive, pointer to the int to allow simple increments during Ukkonen's algorithm.
-        Node<CharType>* suffixLink;
-        std::map<CharType, Node<CharType>*> children;
+        Index startIndex;//inclusive
+        Index endIndex;//exclusive. For leaves, this is the end of the text or open (see getSubstringLength).
+        NodeIndex suffixLink;
+        Children children;
         //Number of leaves in the subtree rooted at this node. Only used by queries.
-        int numberOfLeaves;
+        Index numberOfLeaves;
         //String depth of this node (including its own incoming edge). Only used by queries.
-        int stringDepth;
+        Index stringDepth;
         //For leaves, the suffix that this node represents. For inner nodes in queries, the suffix that one of its leaves represents.
-        int representedSuffix;
+        Index representedSuffix;
     };
 
 }
-
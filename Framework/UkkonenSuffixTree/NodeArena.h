@@ -0,0 +1,108 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+#include "Helpers.h"
+#include "../Helpers/Memory.h"
+
+namespace SuffixTree {
+    /**
+     * Nodes are identified by their position in the NodeArena instead of by pointers.
+     * This keeps all links (children, suffix links) valid when the arena is moved, and for texts with less than 2^31 characters,
+     * they need only 32 bits, half the size of a pointer.
+     *
+     * The node index has the width of the position type INDEX of the tree (int or int64_t, see SuffixTree), since a tree has up to 2n nodes.
+     */
+    template<typename INDEX>
+    using NodeIndexOf = std::make_unsigned_t<INDEX>;
+
+    /**
+     * Marks a link that does not point to any node (replaces NULL).
+     */
+    template<typename INDEX>
+    inline constexpr NodeIndexOf<INDEX> NoNodeOf = std::numeric_limits<NodeIndexOf<INDEX>>::max();
+
+    //The node index of trees with 32-bit positions, the default.
+    using NodeIndex = NodeIndexOf<int>;
+    static constexpr NodeIndex NoNode = NoNodeOf<int>;
+
+    /**
+     * Contiguous pool that owns all nodes of a suffix tree.
+     *
+     * Instead of allocating every node with new (and never freeing it), all nodes are stored in one vector.
+     * Since a suffix tree for a text of length n has at most 2n nodes, the vector can be reserved once up front.
+     * Therefore, it never reallocates during the construction and references to nodes stay valid.
+     * The reserved, but unused part is never touched, so it does not count towards the resident memory.
+     * The reservation is accounted as MemoryComponent::NodeArena (Helpers/Memory.h), an upper bound of the resident memory of the nodes.
+     */
+    template<typename NODE, typename NODE_INDEX = NodeIndex>
+    class NodeArena {
+        using NodeType = NODE;
+        using NodeIndex = NODE_INDEX;
+
+    public:
+        /**
+         * Reserves space for the given number of nodes so that no reallocation happens during the construction.
+         */
+        inline void reserve(size_t numberOfNodes) {
+            nodes.reserve(numberOfNodes);
+        }
+
+        /**
+         * Constructs a new node from the given arguments at the end of the arena and returns its index.
+         */
+        template<typename... ARGS>
+        inline NodeIndex create(ARGS&&... arguments) {
+            AssertMsg(nodes.size() < nodes.capacity(), "Node arena is full, this would invalidate all node references.");
+            nodes.emplace_back(std::forward<ARGS>(arguments)...);
+            return static_cast<NodeIndex>(nodes.size() - 1);
+        }
+
+        /**
+         * Appends count copies of the node constructed from the given arguments and returns the index of the first one.
+         * The parallel construction fills such a block concurrently, every thread writes to its own nodes only.
+         */
+        template<typename... ARGS>
+        inline NodeIndex allocate(size_t count, ARGS&&... arguments) {
+            AssertMsg(nodes.size() + count <= nodes.capacity(), "Node arena is full, this would invalidate all node references.");
+            const size_t first = nodes.size();
+            nodes.resize(first + count, NodeType(std::forward<ARGS>(arguments)...));
+            return static_cast<NodeIndex>(first);
+        }
+
+        inline NodeType& operator[](NodeIndex index) noexcept {
+            return nodes[index];
+        }
+
+        inline const NodeType& operator[](NodeIndex index) const noexcept {
+            return nodes[index];
+        }
+
+        /**
+         * Removes all nodes from index size on, the nodes before them must not link to them anymore.
+         */
+        inline void truncate(size_t size) {
+            nodes.erase(nodes.begin() + size, nodes.end());
+        }
+
+        /**
+         * The number of nodes that fit into the arena without reallocation.
+         */
+        inline size_t capacity() const noexcept {
+            return nodes.capacity();
+        }
+
+        /**
+         * The number of nodes that were created so far.
+         */
+        inline size_t size() const noexcept {
+            return nodes.size();
+        }
+
+    private:
+        Helpers::CountedVector<NodeType, Helpers::MemoryComponent::NodeArena> nodes;
+    };
+}
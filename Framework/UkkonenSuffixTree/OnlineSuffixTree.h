@@ -0,0 +1,229 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+#include "SuffixTree.h"
+
+namespace SuffixTree {
+    /**
+     * A suffix tree for a text that grows: append(chunk) continues Ukkonen's algorithm from the saved active point,
+     * so every character costs the same amortized time as in the construction of the full tree.
+     *
+     * The annotations of the topk query are maintained while the tree grows (see newLeaf and splitEdge), so the query does not need its dfs:
+     *  - A new inner node gets its stringDepth and representedSuffix from its parent. Both never change afterwards,
+     *    a later split only moves the start of its edge.
+     *  - Leaves grow with the text. Their stringDepth is OpenEnd and representedSuffix is the start of their suffix. TopKQuery checks
+     *    representedSuffix + l < n for every candidate, which is the same as checking the actual string depth n - representedSuffix.
+     *  - A new leaf changes numberOfLeaves on its whole path to the root. Instead of updating it there, a count of 0 marks the path as outdated.
+     *    Marking stops at the first outdated node, all nodes above it are outdated already. seal() recomputes only the outdated counts.
+     *
+     * While the text grows, the tree is implicit: The suffixes that still have to be inserted (remaining) end inside of it.
+     * seal() runs the phase for the sentinel, which inserts them. Since all phases before are the same, the result is the tree that SuffixTree
+     * builds for text + sentinel, node for node, and the queries on it return the same results. The changes of the sentinel phase are recorded,
+     * unseal() (or the next append) reverts them. The sentinel phase inserts remaining suffixes, so that costs O(remaining) plus
+     * the recomputation of the counts.
+     *
+     * Like in the annotation of the complete tree (Annotation.h), the sentinel leaves are kept. They are never candidates, since their parent is one
+     * for every length that they could be a candidate for.
+     */
+    template<typename CHAR_TYPE, CHAR_TYPE SENTINEL, bool DEBUG = false, typename CHILDREN = AdaptiveChildren<CHAR_TYPE>, typename INDEX = int>
+    class OnlineSuffixTree : public SuffixTree<CHAR_TYPE, DEBUG, CHILDREN, INDEX> {
+        using CharType = CHAR_TYPE;
+        using Base = SuffixTree<CHAR_TYPE, DEBUG, CHILDREN, INDEX>;
+        static constexpr CharType Sentinel = SENTINEL;
+        static const bool Debug = DEBUG;
+
+        /**
+         * A change of the sentinel phase to a node that existed before:
+         *  - child == NoNode: the sentinel leaf was added to parent.
+         *  - otherwise: the edge from parent to child that started at startIndex was split.
+         */
+        struct Change {
+            typename Base::NodeIndex parent;
+            typename Base::NodeIndex child;
+            typename Base::Index startIndex;
+        };
+
+        /**
+         * Everything that the sentinel phase changes besides the nodes.
+         */
+        struct SavedState {
+            typename Base::Index currentEnd;
+            typename Base::Index activeEdgeIndex;
+            typename Base::Index activeLength;
+            typename Base::NodeIndex activeNode;
+            typename Base::Index remaining;
+            size_t numberOfNodes;
+        };
+
+    public:
+        using Index = typename Base::Index;
+        using NodeIndex = typename Base::NodeIndex;
+        using NodeType = typename Base::NodeType;
+        using Base::Root;
+        using Base::NoNode;
+        using Base::OpenEnd;
+        //The annotations are maintained by the tree, see above.
+        static constexpr bool IsAnnotated = true;
+        //The tree changes with every append, the queries must not keep data structures that they derived from it.
+        static constexpr bool IsGrowing = true;
+
+        OnlineSuffixTree() :
+                Base(),
+                parents(1, NoNode),
+                sealed(false) {
+        }
+
+        /**
+         * Appends the given characters (without the sentinel) to the text and inserts their suffixes. Reverts seal() first.
+         */
+        inline void append(const CharType* chunk, size_t length) {
+            unseal();
+            const Index first = buffer.size();
+            buffer.insert(buffer.end(), chunk, chunk + length);
+            //The text with the sentinel needs up to 2 nodes per character.
+            reserveNodes(2 * (buffer.size() + 1) + 1);
+            this->text = buffer.data();
+            this->n = buffer.size();
+            for (Index i = first; i < this->n; i++) {
+                this->runPhase(i, *this);
+            }
+        }
+
+        /**
+         * Turns the tree into the annotated suffix tree of the current text + sentinel, the topk queries can run on it afterwards.
+         */
+        inline void seal() {
+            if (sealed) return;
+            saved = SavedState{this->currentEnd, this->activeEdgeIndex, this->activeLength, this->activeNode, this->remaining, this->nodes.size()};
+            buffer.push_back(Sentinel);
+            this->text = buffer.data();
+            this->n = buffer.size();
+            sealed = true;
+            this->runPhase(this->n - 1, *this);
+            //As after the construction of the full tree, all leaves end at the end of the text.
+            this->currentEnd = this->n;
+            recomputeOutdatedCounts(Root);
+            if constexpr (Debug) this->print();
+        }
+
+        /**
+         * Reverts seal(): Removes the sentinel and everything that its phase inserted.
+         */
+        inline void unseal() {
+            if (!sealed) return;
+            for (auto change = changes.rbegin(); change != changes.rend(); change++) {
+                if (change->child == NoNode) {
+                    this->nodes[change->parent].children.erase(Sentinel);
+                } else {
+                    this->nodes[change->parent].addChild(buffer[change->startIndex], change->child);
+                    this->nodes[change->child].startIndex = change->startIndex;
+                    parents[change->child] = change->parent;
+                }
+            }
+            //The counts above the changes included the sentinel leaves.
+            for (const Change& change : changes) {
+                if (change.parent < saved.numberOfNodes) markOutdated(change.parent);
+            }
+            changes.clear();
+            this->nodes.truncate(saved.numberOfNodes);
+            parents.resize(saved.numberOfNodes);
+            buffer.pop_back();
+            this->text = buffer.data();
+            this->n = buffer.size();
+            this->currentEnd = saved.currentEnd;
+            this->activeEdgeIndex = saved.activeEdgeIndex;
+            this->activeLength = saved.activeLength;
+            this->activeNode = saved.activeNode;
+            this->remaining = saved.remaining;
+            sealed = false;
+        }
+
+        inline bool isSealed() const noexcept {
+            return sealed;
+        }
+
+        /**
+         * The length of the text so far, without the sentinel.
+         */
+        inline size_t length() const noexcept {
+            return buffer.size() - sealed;
+        }
+
+        /**
+         * Called by runPhase: leaf was added as child of parent.
+         */
+        inline void newLeaf(NodeIndex parent, NodeIndex leaf) {
+            NodeType& node = this->nodes[leaf];
+            node.stringDepth = OpenEnd;
+            node.representedSuffix = node.startIndex - this->nodes[parent].stringDepth;
+            node.numberOfLeaves = 1;
+            parents.resize(this->nodes.size(), NoNode);
+            parents[leaf] = parent;
+            markOutdated(parent);
+            if (sealed && parent < saved.numberOfNodes) changes.emplace_back(parent, NoNode, node.startIndex);
+        }
+
+        /**
+         * Called by runPhase: the edge from parent to child was split by innerNode.
+         */
+        inline void splitEdge(NodeIndex parent, NodeIndex innerNode, NodeIndex child) {
+            NodeType& node = this->nodes[innerNode];
+            node.stringDepth = this->nodes[parent].stringDepth + node.endIndex - node.startIndex;
+            node.representedSuffix = node.endIndex - node.stringDepth;
+            node.numberOfLeaves = 0;
+            parents.resize(this->nodes.size(), NoNode);
+            parents[innerNode] = parent;
+            parents[child] = innerNode;
+            markOutdated(parent);
+            if (sealed && child < saved.numberOfNodes) changes.emplace_back(parent, child, node.startIndex);
+        }
+
+    private:
+        /**
+         * Makes sure that the arena holds the given number of nodes. It grows geometrically, so that the nodes are moved O(1) times amortized.
+         */
+        inline void reserveNodes(size_t numberOfNodes) {
+            if (numberOfNodes <= this->nodes.capacity()) return;
+            this->nodes.reserve(std::max(numberOfNodes, 2 * this->nodes.capacity()));
+        }
+
+        /**
+         * Marks the counts of index and all nodes above it as outdated.
+         */
+        inline void markOutdated(NodeIndex index) noexcept {
+            while (index != NoNode && this->nodes[index].numberOfLeaves != 0) {
+                this->nodes[index].numberOfLeaves = 0;
+                index = parents[index];
+            }
+        }
+
+        /**
+         * Recomputes the outdated counts in the subtree of index like Annotation (Annotation.h), the subtrees of up-to-date nodes are skipped.
+         * Returns numberOfLeaves.
+         */
+        inline Index recomputeOutdatedCounts(NodeIndex index) noexcept {
+            NodeType& node = this->nodes[index];
+            if (node.numberOfLeaves != 0) return node.numberOfLeaves;
+            Index numberOfLeaves = 0;
+            for (const auto & [key, child] : node.children) {
+                numberOfLeaves += recomputeOutdatedCounts(child);
+            }
+            //The reference is still valid, the arena does not grow here.
+            node.numberOfLeaves = numberOfLeaves;
+            return numberOfLeaves;
+        }
+
+    private:
+        //The text so far, followed by the sentinel while the tree is sealed
+        std::vector<CharType> buffer;
+        //The parent of every node, NoNode for the root
+        std::vector<NodeIndex> parents;
+        bool sealed;
+        //The state before seal() and its changes to existing nodes
+        SavedState saved;
+        std::vector<Change> changes;
+    };
+}
@@ -4,9 +4,28 @@
 #include <bits/stdc++.h>
 
 #include "Node.h"
+#include "NodeArena.h"
+#include "ParallelConstruction.h"
+#include "Annotation.h"
+#include "../Helpers/ThreadPool.h"
 
 namespace SuffixTree {
 
+    /**
+     * Receives the changes that a phase of Ukkonen's algorithm makes to the tree (see SuffixTree::runPhase):
+     *  - newLeaf(parent, leaf) after leaf was added as child of parent.
+     *  - splitEdge(parent, innerNode, child) after the edge from parent to child was split by the new innerNode.
+     *    The edge into child now starts behind the one into innerNode, which starts where the edge into child started before.
+     * The construction of the full tree ignores them, the online tree (OnlineSuffixTree.h) maintains the query annotations with them.
+     */
+    struct NoConstructionObserver {
+        template<typename NODE_INDEX>
+        inline void newLeaf(NODE_INDEX, NODE_INDEX) const noexcept {}
+
+        template<typename NODE_INDEX>
+        inline void splitEdge(NODE_INDEX, NODE_INDEX, NODE_INDEX) const noexcept {}
+    };
+
     /**
      * Creates a Suffix Tree using Ukkonen's algorithm.
      *
@@ -17,34 +36,53 @@ namespace SuffixTree {
      *      - https://www.youtube.com/watch?v=aPRqocoBsFQ
      *      - https://brenden.github.io/ukkonen-animation/
      *
-     * The memory consumption is pretty bad, but I do not have more time to address that :|
+     * All nodes are stored in a NodeArena and reference each other by indices.
+     * The container that stores the children of each node is chosen by the CHILDREN policy (see Children.h).
+     * The root is always the first node in the arena.
      *
+     * INDEX is the type of all positions in the text: int for texts with less than 2^31 characters, int64_t for larger ones.
+     * The node indices have the same width, so the default keeps all nodes small (see NodeArena.h).
      */
-    template<typename CHAR_TYPE, bool DEBUG = false>
+    template<typename CHAR_TYPE, bool DEBUG = false, typename CHILDREN = AdaptiveChildren<CHAR_TYPE>, typename INDEX = int>
     class SuffixTree {
         using CharType = CHAR_TYPE;
+        using Children = CHILDREN;
         static const bool Debug = DEBUG;
 
     public:
-        SuffixTree(const CharType* input, int n) :
+        using Index = INDEX;
+        using NodeIndex = NodeIndexOf<Index>;
+        static constexpr NodeIndex NoNode = NoNodeOf<Index>;
+        using NodeType = Node<CharType, Children, Index>;
+        //Index of the root node in the arena.
+        static constexpr NodeIndex Root = 0;
+        //The annotations (stringDepth, numberOfLeaves, representedSuffix) are computed by annotate(), which the queries call.
+        static constexpr bool IsAnnotated = false;
+        //The tree does not change after the construction, the queries may precompute data structures from it.
+        static constexpr bool IsGrowing = false;
+        //The end index of leaves while the text still grows, see getSubstringLength in Node.h.
+        static constexpr Index OpenEnd = std::numeric_limits<Index>::max();
+
+        SuffixTree(const CharType* input, Index n) :
                 text(input),
-                root(0, NULL, NULL),//initialize empty tree
                 currentEnd(0),
                 n(n),
+                leafEnd(n),
                 activeEdgeIndex(0),//initialize active point
                 activeLength(0),
-                activeNode(NULL),
-                lastNewInternalNode(NULL),
+                activeNode(Root),
+                lastNewInternalNode(NoNode),
                 remaining(0) {
-            root.endIndex = new int(0);
-            //Initially, all insertions are made from root
-            activeNode = &root;
+            //A suffix tree for n characters has at most 2n nodes (n leaves and less than n inner nodes), reserve that once.
+            nodes.reserve(2 * static_cast<size_t>(n) + 1);
+            //initialize empty tree, initially, all insertions are made from root
+            nodes.create(0, 0, NoNode);
 
             //Run Ukkonen's algorithm, for each character, run its phase.
-            for (int i = 0; i < n; i++) {
+            for (Index i = 0; i < n; i++) {
                 runPhase(i);
             }
-            //After the construction, all leaf edges have endIndex currentEnd = n - 1. Since end indices are exclusive, increment them to n.
+            //After the construction, currentEnd = n - 1. Since end indices are exclusive, increment it to n, which is the end index of all leaves.
             currentEnd++;
 
             if constexpr (Debug) {
@@ -56,10 +94,80 @@ namespace SuffixTree {
         }
 
         /**
-         * Runs phase i (for new character text[i]) of Ukkonen's algorithm.
+         * Builds the same tree with all threads of the pool instead of with Ukkonen's algorithm, see ParallelConstruction.h.
+         * Suffix links are not set, the active point is meaningless afterwards.
+         */
+        SuffixTree(const CharType* input, Index n, Helpers::ThreadPool& pool) :
+                text(input),
+                currentEnd(n),
+                n(n),
+                leafEnd(n),
+                activeEdgeIndex(0),
+                activeLength(0),
+                activeNode(Root),
+                lastNewInternalNode(NoNode),
+                remaining(0) {
+            static_assert(std::is_same_v<Index, int>, "The parallel construction uses the suffix array, which has 32-bit positions.");
+            nodes.reserve(2 * static_cast<size_t>(n) + 1);
+            nodes.create(0, 0, NoNode);
+            ParallelConstruction<CharType, Children>(text, n, nodes, pool).run();
+
+            if constexpr (Debug) {
+                std::cout << std::endl << std::endl << std::endl;
+                print();
+                std::cout << std::endl << std::endl << std::endl;
+                validate();
+            }
+        }
+
+        /**
+         * The tree of the empty text, the text is appended afterwards (see OnlineSuffixTree.h). Its leaves are open.
+         */
+        SuffixTree() :
+                text(nullptr),
+                currentEnd(0),
+                n(0),
+                leafEnd(OpenEnd),
+                activeEdgeIndex(0),
+                activeLength(0),
+                activeNode(Root),
+                lastNewInternalNode(NoNode),
+                remaining(0) {
+            nodes.reserve(1);
+            nodes.create(0, 0, NoNode);
+        }
+
+        /**
+         * Computes the annotations of all nodes for the queries (see Annotation.h). Only the first call does anything, so every query
+         * calls it and all queries on the tree share the annotations. Must not run concurrently with queries.
+         */
+        inline void annotate() {
+            if (annotated) return;
+            Annotation<NodeType, NodeIndex>(nodes).run();
+            annotated = true;
+        }
+
+        /**
+         * Same as annotate(), but the subtrees are annotated concurrently on the thread pool.
+         */
+        inline void annotate(Helpers::ThreadPool& pool) {
+            if (annotated) return;
+            Annotation<NodeType, NodeIndex>(nodes).run(pool);
+            annotated = true;
+        }
+
+        inline void runPhase(Index i) {
+            NoConstructionObserver observer;
+            runPhase(i, observer);
+        }
+
+        /**
+         * Runs phase i (for new character text[i]) of Ukkonen's algorithm. All changes to the tree are reported to observer.
+         * The phases only depend on the active point, so they can be continued at any time after text has grown.
          */
-        inline void runPhase(int i) {
-            lastNewInternalNode = NULL; //reset, only valid per phase
+        template<typename OBSERVER>
+        inline void runPhase(Index i, OBSERVER& observer) {
+            lastNewInternalNode = NoNode; //reset, only valid per phase
             currentEnd = i; //automatically extend all existing suffixes
             remaining++; //mark that one more suffix must be added
 
@@ -73,21 +181,22 @@ namespace SuffixTree {
                 }
 
                 //Get the activeTarget, the node that the activeEdge points to
-                Node<CharType>* activeTarget = getActiveTarget();
-                if (activeTarget == NULL) {
+                const NodeIndex activeTarget = getActiveTarget();
+                if (activeTarget == NoNode) {
                     //The activeTarget does not exist, i.e., there is no correct outgoing edge from activeNode
                     //Create a new leaf from activeNode
 
-                    //The leaf represents the suffix starting at i and ending at currentEnd, its suffix link is &root by default.
-                    Node<CharType>* newLeaf = new Node<CharType>(i, &currentEnd, &root);
+                    //The leaf represents the suffix starting at i and ending at the end of the text, its suffix link is Root by default.
+                    const NodeIndex newLeaf = nodes.create(i, leafEnd, Root);
                     //Add the new leaf as a child. Since its edge starts with text[activeEdgeIndex], use that as key.
-                    activeNode->addChild(text[activeEdgeIndex], newLeaf);
+                    nodes[activeNode].addChild(text[activeEdgeIndex], newLeaf);
+                    observer.newLeaf(activeNode, newLeaf);
 
                     //If we have previously inserted a new internal node during this phase, we need to add a suffix link.
-                    if (lastNewInternalNode != NULL) {
+                    if (lastNewInternalNode != NoNode) {
                         //the previously inserted node points to the new active node so that the active point can be updated efficiently.
-                        lastNewInternalNode->suffixLink = activeNode;
-                        lastNewInternalNode = NULL;//avoid overwriting the suffix link
+                        nodes[lastNewInternalNode].suffixLink = activeNode;
+                        lastNewInternalNode = NoNode;//avoid overwriting the suffix link
                     }
                 } else {
                     //The activeTarget does not exist, i.e., there is a correct outgoing edge from activeNode.
@@ -99,15 +208,16 @@ namespace SuffixTree {
                         continue;
                     }
 
-                    //The active point is at activeTarget->startIndex + activeLength. Check if that character matches text[i].
-                    if (text[activeTarget->startIndex + activeLength] == text[i]) {
+                    //The active point is at activeTarget's startIndex + activeLength. Check if that character matches text[i].
+                    const Index activeTargetStart = nodes[activeTarget].startIndex;
+                    if (text[activeTargetStart + activeLength] == text[i]) {
                         //It's a match, the character is already there. Extend by rule 3.
 
-                        //If activeNode is not &root, set the active node of a previously inserted
+                        //If activeNode is not Root, set the active node of a previously inserted
                         //internal node to activeNode.
-                        if (lastNewInternalNode != NULL && activeNode != &root) {
-                            lastNewInternalNode->suffixLink = activeNode;
-                            lastNewInternalNode = NULL;//avoid overwriting the suffix link
+                        if (lastNewInternalNode != NoNode && activeNode != Root) {
+                            nodes[lastNewInternalNode].suffixLink = activeNode;
+                            lastNewInternalNode = NoNode;//avoid overwriting the suffix link
                         }
                         //We walked along the current edge, increment activeLength accordingly.
                         activeLength++;
@@ -116,25 +226,24 @@ namespace SuffixTree {
                     } else {
                         //No match, the character is not at the edge, yet. We need to split the edge and insert a new leaf.
 
-                        //Get new int for the end of the edge into the new internal node that will be the splitter.
-                        internalNodeEnd = new int();
-                        //The edge into the new internal node ends at the active point (exclusively).
-                        *internalNodeEnd = activeTarget->startIndex + activeLength;
                         //Create the new internal node, it starts at the same position as the active edge.
-                        Node<CharType> *newInternalNode = new Node<CharType>(activeTarget->startIndex, internalNodeEnd, &root);
-                        //Create the new leaf. It starts at i and ends at currentEnd.
-                        Node<CharType> *newLeaf = new Node<CharType>(i, &currentEnd, &root);
+                        //The edge into the new internal node ends at the active point (exclusively), this end is stored inline.
+                        const NodeIndex newInternalNode = nodes.create(activeTargetStart, activeTargetStart + activeLength, Root);
+                        //Create the new leaf. It starts at i and ends at the end of the text.
+                        const NodeIndex newLeaf = nodes.create(i, leafEnd, Root);
                         //Replace activeTarget by newInternalNode as child for text[activeEdgeIndex] of activeNode
-                        activeNode->addChild(text[activeEdgeIndex], newInternalNode);
-                        //The splitter has two children: newLeaf for text[i] and the old activeTarget for the active point text[activeTarget->startIndex + activeLength]
-                        newInternalNode->addChild(text[i], newLeaf);
-                        newInternalNode->addChild(text[activeTarget->startIndex + activeLength], activeTarget);
+                        nodes[activeNode].addChild(text[activeEdgeIndex], newInternalNode);
+                        //The splitter has two children: newLeaf for text[i] and the old activeTarget for the active point text[activeTargetStart + activeLength]
+                        nodes[newInternalNode].addChild(text[i], newLeaf);
+                        nodes[newInternalNode].addChild(text[activeTargetStart + activeLength], activeTarget);
                         //The edge into the old activeTarget now starts after the active point.
-                        activeTarget->startIndex += activeLength;
+                        nodes[activeTarget].startIndex += activeLength;
+                        observer.splitEdge(activeNode, newInternalNode, activeTarget);
+                        observer.newLeaf(newInternalNode, newLeaf);
 
                         //We inserted a new internal node. If there was one before, set the suffix link accordingly.
-                        if (lastNewInternalNode != NULL) {
-                            lastNewInternalNode->suffixLink = newInternalNode;
+                        if (lastNewInternalNode != NoNode) {
+                            nodes[lastNewInternalNode].suffixLink = newInternalNode;
                         }
                         lastNewInternalNode = newInternalNode;//update for the next iterations
                     }
@@ -142,14 +251,14 @@ namespace SuffixTree {
                 //If we are here, one suffix was inserted in the previous iteration with rule 2.
                 remaining--;
                 //Update the active point
-                if (activeNode == &root && activeLength > 0) {
+                if (activeNode == Root && activeLength > 0) {
                     //If active node was root and active length > 0 after the iteration, update active point according to rule 1:
                     activeLength--;
                     //activeEdgeIndex must point to the first character of the next suffix we have to insert
                     activeEdgeIndex = i - remaining + 1;
-                } else if (activeNode != &root) {
+                } else if (activeNode != Root) {
                     //If activeNode was not root, follow the suffix link to update activeNode.
-                    activeNode = activeNode->suffixLink;
+                    activeNode = nodes[activeNode].suffixLink;
                     //activeEdgeIndex and activeLength do not need to be updated since the edges out of the new active
                     //node are the same as before since there is a suffix link.
                 }
@@ -159,8 +268,8 @@ namespace SuffixTree {
         /**
          * Walks down the current active point to make sure it is valid. Skip the edge if necessary.
          */
-        inline bool walkDown(Node<CharType>* activeTarget) {
-            const int activeEdgeSubstringLength = activeTarget->getSubstringLength();
+        inline bool walkDown(NodeIndex activeTarget) {
+            const Index activeEdgeSubstringLength = nodes[activeTarget].getSubstringLength(currentEnd);
             if (activeLength >= activeEdgeSubstringLength) {
                 //activeLength points behind the end of the activeEdge, skip the edge.
                 activeNode = activeTarget;
@@ -174,8 +283,33 @@ namespace SuffixTree {
         /**
          * Returns the node that the active edge points to.
          */
-        inline Node<CharType>* getActiveTarget() const noexcept {
-            return activeNode->getChild(text[activeEdgeIndex]);
+        inline NodeIndex getActiveTarget() const noexcept {
+            return nodes[activeNode].getChild(text[activeEdgeIndex]);
+        }
+
+        /**
+         * Returns the node with the given index.
+         */
+        inline NodeType& getNode(NodeIndex index) noexcept {
+            return nodes[index];
+        }
+
+        inline const NodeType& getNode(NodeIndex index) const noexcept {
+            return nodes[index];
+        }
+
+        /**
+         * Returns the root of the tree.
+         */
+        inline NodeType& getRoot() noexcept {
+            return nodes[Root];
+        }
+
+        /**
+         * The number of nodes in the tree.
+         */
+        inline size_t numberOfNodes() const noexcept {
+            return nodes.size();
         }
 
         /**
@@ -189,39 +323,64 @@ namespace SuffixTree {
             std::cout << "    Active length: " << activeLength << std::endl;
             std::cout << "    CurrentEnd: " << currentEnd << std::endl;
             std::cout << "    Remaining suffixes: " << remaining << std::endl;
-            root.print(4);
+            printNode(Root, 4);
             std::cout << std::endl;
         }
 
+        /**
+         * Prints the subtree rooted at the given node. Used for debugging.
+         */
+        inline void printNode(NodeIndex index, int depth) const noexcept {
+            const NodeType& node = nodes[index];
+            std::cout << std::string(depth, ' ') << "Node " << index << " [" << node.startIndex << ", " << node.endIndex << "), suffixLink " << node.suffixLink << std::endl;
+            for (const auto &[key, child] : node.children) {
+                std::cout << std::string(depth + 2, ' ') << "Key " << key << " is child " << child << std::endl;
+                printNode(child, depth + 4);
+            }
+        }
+
         /**
          * Compactly prints the suffix tree.
          */
         inline void printSimple() noexcept {
-            root.printSimple(0);
+            printNodeSimple(Root, 0);
             std::cout << std::endl;
         }
 
+        /**
+         * Compactly prints the subtree rooted at the given node. Used for debugging.
+         */
+        inline void printNodeSimple(NodeIndex index, int depth) const noexcept {
+            const NodeType& node = nodes[index];
+            std::cout << " [" << node.startIndex << ", " << node.endIndex << "), numberOfLeaves: " << node.numberOfLeaves << ", stringDepth: " << node.stringDepth << ", representedSuffix: " << node.representedSuffix << std::endl;
+            for (const auto &[key, child] : node.children) {
+                std::cout << std::string(depth + 4, ' ') << key << ": ";
+                printNodeSimple(child, depth + 4);
+            }
+        }
+
         /**
          * Prints the suffix array that is derived from the suffix tree for validation.
          */
         inline void validate() noexcept {
             std::cout << "SA: ";
-            saDfs(&root, 0);
+            saDfs(Root, 0);
             std::cout << std::endl;
         }
 
         /**
          * Goes through the tree to generate the suffix array.
          */
-        inline void saDfs(Node<CharType>* node, int stringDepth) {
-            stringDepth += node->getSubstringLength();
-            if (node->hasChildren()) {
-                for (const auto &[key, child] : node->children) {
+        inline void saDfs(NodeIndex index, Index stringDepth) {
+            const NodeType& node = nodes[index];
+            stringDepth += node.getSubstringLength(currentEnd);
+            if (node.hasChildren()) {
+                for (const auto &[key, child] : node.children) {
                     saDfs(child, stringDepth);
                 }
             } else {
                 //leaf
-                int suffixIndex = *(node->endIndex) - stringDepth;
+                Index suffixIndex = node.endIndex - stringDepth;
                 std::cout << suffixIndex << " ";
             }
         }
@@ -230,31 +389,31 @@ namespace SuffixTree {
          * Returns the substring of the input text with length length starting at startIndex.
          */
         inline std::string substring(size_t startIndex, size_t length) const noexcept {
-            std::string result(text + startIndex);
-            result.resize(length);
-            return result;
+            return std::string(text + startIndex, length);
         }
 
     public:
         //The input text
         const CharType* text;
-        //Root of the tree
-        Node<CharType> root;
+        //All nodes of the tree, the root is at index Root.
+        NodeArena<NodeType, NodeIndex> nodes;
         //The index that all leaf-edges currently end at.
-        int currentEnd;
+        Index currentEnd;
         //Input length
-        int n;
+        Index n;
+        //The end index of all new leaves: n, or OpenEnd if the text is not complete yet.
+        Index leafEnd;
         //The index of the character in the text that the active edge starts with from activeNode
-        int activeEdgeIndex;
+        Index activeEdgeIndex;
         //The active length, the index of the active point along the active edge
-        int activeLength;
+        Index activeLength;
         //The active node, from which the active edge starts
-        Node<CharType>* activeNode;
+        NodeIndex activeNode;
         //The last created internal node, used to correctly set suffix links.
-        Node<CharType>* lastNewInternalNode;
+        NodeIndex lastNewInternalNode;
         //The number of suffixes that still need to be inserted
-        int remaining;
-        //End of the edge for new internal nodes, needed because all end indices are pointers to ints.
-        int* internalNodeEnd;
+        Index remaining;
+        //True after annotate().
+        bool annotated = false;
     };
 }
\ No newline at end of file
@@ -0,0 +1,361 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <optional>
+#include <type_traits>
+
+#include "Query/TopKQuery.h"
+#include "Query/RepeatQuery.h"
+#include "Query/SmallerHalfRepeatQuery.h"
+#include "Query/LzRepeatQuery.h"
+#include "Helpers/Benchmark.h"
+#include "Helpers/CommandLine.h"
+#include "Helpers/MappedFile.h"
+#include "Helpers/ThreadPool.h"
+#include "Helpers/TopKProfiler.h"
+#include "Helpers/RepeatProfiler.h"
+
+#include "UkkonenSuffixTree/SuffixTree.h"
+#include "UkkonenSuffixTree/Children.h"
+#include "SuffixArray/SuffixArray.h"
+#include "SuffixArray/LcpIntervalTree.h"
+
+/**
+ * The benchmark suite, it replaces preprocessingExperiment, topKQueryExperiment, repeatQueryExperiment, childContainerExperiment,
+ * parallelConstructionExperiment and parallelRepeatExperiment of main.cpp.
+ * Everything that was hard-coded there is configurable here, the defaults are the values of the last runs in EvaluationResults/:
+ *  - --lengths=.. the prefix lengths of the input that are measured
+ *  - --query-lengths=.. and --k=.. the parameters of the topk queries, every combination is measured (children: the lengths of the bfs)
+ *  - --engines=.. the repeat engines (merge, smallerhalf, lz)
+ *  - --threads=N and --query-threads=N the parallel construction and the parallel repeat query are measured with 1 to N threads
+ *    (default: all hardware threads)
+ *  - --repetitions=N measured runs and --warmup=N runs before them that are not measured
+ *  - --format=result|csv|json and --output=file, see Helpers/Benchmark.h
+ *  - --label=text is added to every record, e.g., the commit that was measured
+ *  - --profile prints the times and hardware performance counters of the phases of the queries (Helpers/PerfCounters.h)
+ */
+
+using CharType = char;
+static const bool Debug = false;
+static const CharType Sentinel = '\0';
+
+static const std::vector<size_t> DefaultPreprocessingLengths = { 5000000 };
+static const std::vector<size_t> DefaultTopKLengths = { 10000000 };
+static const std::vector<size_t> DefaultTopKQueryLengths = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20 };
+static const std::vector<size_t> DefaultRepeatLengths = { 1000, 1000000, 2500000, 5000000, 7500000, 10000000 };
+static const std::vector<size_t> DefaultBfsQueryLengths = { 1, 5, 10, 50, 100, 500, 1000, 5000, 10000, 50000, 100000, 500000, 1000000 };
+
+/**
+ * The settings of one run of the suite.
+ */
+struct BenchmarkSettings {
+    std::string inputFileName;
+    std::string inputType;
+    Helpers::TextView input;
+    size_t warmup;
+    size_t repetitions;
+};
+
+/**
+ * The first length characters of the input followed by the sentinel, or an empty string if the input is too short.
+ */
+inline static std::string getPrefix(const BenchmarkSettings& settings, Helpers::BenchmarkReport& report, size_t length) {
+    //The input view includes its sentinel.
+    if (length >= settings.input.length) {
+        report.log() << "ERROR: insufficient input for inputLength=" << length << "." << std::endl;
+        return "";
+    }
+    std::string prefix(settings.input.text, length);
+    prefix.push_back(Sentinel);
+    report.log() << "Measuring inputLength=" << length << std::endl;
+    return prefix;
+}
+
+inline static Helpers::BenchmarkReport::Fields inputFields(const BenchmarkSettings& settings) {
+    return {{"inputType", settings.inputType}, {"file", settings.inputFileName}};
+}
+
+/**
+ * The construction of the suffix tree, every repetition builds a new one.
+ */
+inline static void preprocessingBenchmark(const Helpers::CommandLine& options, const BenchmarkSettings& settings, Helpers::BenchmarkReport& report) {
+    for (const size_t inputLength : options.getNumbers("lengths", DefaultPreprocessingLengths)) {
+        const std::string prefix = getPrefix(settings, report, inputLength);
+        if (prefix.empty()) continue;
+        const Helpers::BenchmarkStatistics statistics = Helpers::measure(settings.warmup, settings.repetitions, [&]() {
+            SuffixTree::SuffixTree<CharType, Debug> stree(prefix.c_str(), prefix.length());
+            return stree.numberOfNodes();
+        });
+        report.add({{"algo", "preprocessingBenchmark"}, {"inputLength", std::to_string(inputLength)}}, statistics, "constructionTime", inputFields(settings));
+    }
+}
+
+/**
+ * The topk queries for every combination of query length and k. The tree and the query initialization are built once per input length
+ * and are not part of the measurement.
+ * With --profile, the queries run with the TopKPerfProfiler, whose phases are printed after each combination. Its overhead is part of the times then.
+ */
+template<typename PROFILER>
+inline static void topKBenchmark(const Helpers::CommandLine& options, const BenchmarkSettings& settings, Helpers::BenchmarkReport& report) {
+    const std::vector<size_t> queryLengths = options.getNumbers("query-lengths", DefaultTopKQueryLengths);
+    const std::vector<size_t> ks = options.getNumbers("k", {1});
+    for (const size_t inputLength : options.getNumbers("lengths", DefaultTopKLengths)) {
+        std::string prefix = getPrefix(settings, report, inputLength);
+        if (prefix.empty()) continue;
+        SuffixTree::SuffixTree<CharType, Debug> stree(prefix.c_str(), prefix.length());
+        Query::TopKQuery<CharType, Sentinel, PROFILER, Debug> query(&stree);
+        for (const size_t queryLength : queryLengths) {
+            if (queryLength >= inputLength) break;
+            for (const size_t k : ks) {
+                const Helpers::BenchmarkStatistics statistics = Helpers::measure(settings.warmup, settings.repetitions, [&]() {
+                    return query.runQuery(queryLength, k);
+                });
+                report.add({{"algo", "topKQueryBenchmark"}, {"inputLength", std::to_string(inputLength)}, {"queryLength", std::to_string(queryLength)}, {"k", std::to_string(k)}},
+                           statistics, "queryTime", inputFields(settings));
+                if constexpr (!std::is_same_v<PROFILER, Query::TopKNoProfiler>) {
+                    query.profiler.print(report.log());
+                    query.profiler.reset();
+                }
+            }
+        }
+    }
+}
+
+/**
+ * The repeat query with each engine. Like in the repeat mode of main.cpp, the suffix tree (or suffix array) is built once and not measured,
+ * the initialization of the query is part of every repetition.
+ * With --profile, each engine runs once more with the RepeatPerfProfiler after its measurement and its phases are printed.
+ */
+inline static void repeatBenchmark(const Helpers::CommandLine& options, const BenchmarkSettings& settings, Helpers::BenchmarkReport& report) {
+    const std::string engines = "," + options.get("engines", "merge,smallerhalf,lz") + ",";
+    const auto selected = [&](const std::string& engine) {
+        return engines.find("," + engine + ",") != std::string::npos;
+    };
+    const bool profile = options.has("profile");
+    const auto printProfile = [&](const std::string& engine, auto& query) {
+        report.log() << "Profile of engine=" << engine << ":" << std::endl;
+        query.runQuery();
+        query.profiler.print(report.log());
+    };
+    for (const size_t inputLength : options.getNumbers("lengths", DefaultRepeatLengths)) {
+        std::string prefix = getPrefix(settings, report, inputLength);
+        if (prefix.empty()) continue;
+        const Helpers::BenchmarkReport::Fields parameters = {{"inputLength", std::to_string(inputLength)}};
+        const auto add = [&](const std::string& engine, const Helpers::BenchmarkStatistics& statistics) {
+            Helpers::BenchmarkReport::Fields fields = {{"algo", "repeatQueryBenchmark"}, {"engine", engine}};
+            fields.insert(fields.end(), parameters.begin(), parameters.end());
+            report.add(fields, statistics, "queryTime", inputFields(settings));
+        };
+        if (selected("merge") || selected("smallerhalf")) {
+            SuffixTree::SuffixTree<CharType, Debug> stree(prefix.c_str(), prefix.length());
+            if (selected("merge")) {
+                add("merge", Helpers::measure(settings.warmup, settings.repetitions, [&]() {
+                    Query::RepeatQuery<CharType, Sentinel, Query::RepeatNoProfiler, Debug> query(&stree);
+                    return query.runQuery().second;
+                }));
+                if (profile) {
+                    Query::RepeatQuery<CharType, Sentinel, Query::RepeatPerfProfiler, Debug> query(&stree);
+                    printProfile("merge", query);
+                }
+            }
+            if (selected("smallerhalf")) {
+                add("smallerhalf", Helpers::measure(settings.warmup, settings.repetitions, [&]() {
+                    Query::SmallerHalfRepeatQuery<CharType, Sentinel, Query::RepeatNoProfiler, Debug> query(&stree);
+                    return query.runQuery().second;
+                }));
+                if (profile) {
+                    Query::SmallerHalfRepeatQuery<CharType, Sentinel, Query::RepeatPerfProfiler, Debug> query(&stree);
+                    printProfile("smallerhalf", query);
+                }
+            }
+        }
+        if (selected("lz")) {
+            SuffixArray::SuffixArray<CharType, Debug> suffixArray(prefix.c_str(), prefix.length());
+            SuffixArray::LcpIntervalTree<CharType, Debug> intervalTree(&suffixArray);
+            add("lz", Helpers::measure(settings.warmup, settings.repetitions, [&]() {
+                Query::LzRepeatQuery<CharType, Sentinel, Query::RepeatNoProfiler, Debug> query(&intervalTree);
+                return query.runQuery().second;
+            }));
+            if (profile) {
+                Query::LzRepeatQuery<CharType, Sentinel, Query::RepeatPerfProfiler, Debug> query(&intervalTree);
+                printProfile("lz", query);
+            }
+        }
+    }
+}
+
+/**
+ * The construction and the collectingBfs of the topk query with the given child container. Every repetition of the construction builds
+ * a new tree, the bfs runs on one more tree that is built for it. The throughputs are computed from the median times.
+ */
+template<typename CHILDREN>
+inline static void childrenBenchmarkRun(const Helpers::CommandLine& options, const BenchmarkSettings& settings, Helpers::BenchmarkReport& report, size_t inputLength, const std::string& prefix, const std::string& containerName) {
+    const Helpers::BenchmarkStatistics construction = Helpers::measure(settings.warmup, settings.repetitions, [&]() {
+        SuffixTree::SuffixTree<CharType, Debug, CHILDREN> stree(prefix.c_str(), prefix.length());
+        return stree.numberOfNodes();
+    });
+    report.add({{"algo", "childContainerBenchmark"}, {"container", containerName}, {"inputLength", std::to_string(inputLength)},
+                {"constructionThroughput", std::to_string(prefix.length() * 1000.0 / construction.median)}},
+               construction, "constructionTime", inputFields(settings));
+
+    SuffixTree::SuffixTree<CharType, Debug, CHILDREN> stree(prefix.c_str(), prefix.length());
+    Query::TopKQuery<CharType, Sentinel, Query::TopKNoProfiler, Debug, CHILDREN> query(&stree);
+    typename decltype(query)::CandidateBuffer candidates;
+    for (const size_t queryLength : options.getNumbers("query-lengths", DefaultBfsQueryLengths)) {
+        if (queryLength >= inputLength) break;
+        const Helpers::BenchmarkStatistics bfs = Helpers::measure(settings.warmup, settings.repetitions, [&]() {
+            candidates.clear();
+            query.collectingBfs(candidates, queryLength);
+            return candidates.size();
+        });
+        report.add({{"algo", "childContainerBenchmark"}, {"container", containerName}, {"inputLength", std::to_string(inputLength)}, {"queryLength", std::to_string(queryLength)},
+                    {"bfsThroughput", std::to_string(candidates.size() * 1000.0 / bfs.median)}},
+                   bfs, "bfsTime", inputFields(settings));
+    }
+}
+
+/**
+ * The child containers: map, adaptive and, for DNA texts, dense. The throughputs are in MB/s and candidates/us.
+ */
+inline static void childrenBenchmark(const Helpers::CommandLine& options, const BenchmarkSettings& settings, Helpers::BenchmarkReport& report) {
+    for (const size_t inputLength : options.getNumbers("lengths", DefaultPreprocessingLengths)) {
+        const std::string prefix = getPrefix(settings, report, inputLength);
+        if (prefix.empty()) continue;
+        childrenBenchmarkRun<SuffixTree::MapChildren<CharType>>(options, settings, report, inputLength, prefix, "map");
+        childrenBenchmarkRun<SuffixTree::AdaptiveChildren<CharType>>(options, settings, report, inputLength, prefix, "adaptive");
+        if (SuffixTree::UpperCaseDnaAlphabet::contains(prefix.c_str(), prefix.length())) {
+            childrenBenchmarkRun<SuffixTree::DenseChildren<CharType, SuffixTree::UpperCaseDnaAlphabet>>(options, settings, report, inputLength, prefix, "dense");
+        } else if (SuffixTree::LowerCaseDnaAlphabet::contains(prefix.c_str(), prefix.length())) {
+            childrenBenchmarkRun<SuffixTree::DenseChildren<CharType, SuffixTree::LowerCaseDnaAlphabet>>(options, settings, report, inputLength, prefix, "dense");
+        }
+    }
+}
+
+/**
+ * The parallel construction with 1 to --threads=N threads against Ukkonen's algorithm. Starting the threads is not part of the measurement.
+ * Both constructions must build the same tree, a different number of nodes is reported as an error.
+ */
+inline static void parallelConstructionBenchmark(const Helpers::CommandLine& options, const BenchmarkSettings& settings, Helpers::BenchmarkReport& report) {
+    const size_t maxThreads = options.getNumber("threads", std::thread::hardware_concurrency());
+    for (const size_t inputLength : options.getNumbers("lengths", DefaultPreprocessingLengths)) {
+        const std::string prefix = getPrefix(settings, report, inputLength);
+        if (prefix.empty()) continue;
+        size_t ukkonenNodes = 0;
+        const Helpers::BenchmarkStatistics ukkonen = Helpers::measure(settings.warmup, settings.repetitions, [&]() {
+            SuffixTree::SuffixTree<CharType, Debug> stree(prefix.c_str(), prefix.length());
+            ukkonenNodes = stree.numberOfNodes();
+            return ukkonenNodes;
+        });
+        report.add({{"algo", "parallelConstructionBenchmark"}, {"construction", "ukkonen"}, {"threads", "1"}, {"inputLength", std::to_string(inputLength)},
+                    {"numberOfNodes", std::to_string(ukkonenNodes)}},
+                   ukkonen, "constructionTime", inputFields(settings));
+        for (size_t threads = 1; threads <= maxThreads; threads++) {
+            Helpers::ThreadPool pool(threads);
+            size_t parallelNodes = 0;
+            const Helpers::BenchmarkStatistics parallel = Helpers::measure(settings.warmup, settings.repetitions, [&]() {
+                SuffixTree::SuffixTree<CharType, Debug> stree(prefix.c_str(), prefix.length(), pool);
+                parallelNodes = stree.numberOfNodes();
+                return parallelNodes;
+            });
+            if (parallelNodes != ukkonenNodes) {
+                report.log() << "ERROR: the parallel construction with " << threads << " threads built " << parallelNodes << " nodes, Ukkonen's algorithm " << ukkonenNodes << "." << std::endl;
+            }
+            report.add({{"algo", "parallelConstructionBenchmark"}, {"construction", "parallel"}, {"threads", std::to_string(threads)}, {"inputLength", std::to_string(inputLength)},
+                        {"numberOfNodes", std::to_string(parallelNodes)}, {"speedupOverUkkonen", std::to_string(ukkonen.median / parallel.median)}},
+                       parallel, "constructionTime", inputFields(settings));
+        }
+    }
+}
+
+/**
+ * The repeat query with the inner nodes of each string depth processed in parallel, with 1 to --query-threads=N threads,
+ * for the merging and the smaller-half engine. The suffix tree is built once per input length. Only the band processing is parallel,
+ * so the initialization of the query runs before every repetition and is not measured.
+ */
+inline static void parallelRepeatBenchmark(const Helpers::CommandLine& options, const BenchmarkSettings& settings, Helpers::BenchmarkReport& report) {
+    const size_t maxThreads = options.getNumber("query-threads", std::thread::hardware_concurrency());
+    for (const size_t inputLength : options.getNumbers("lengths", DefaultRepeatLengths)) {
+        const std::string prefix = getPrefix(settings, report, inputLength);
+        if (prefix.empty()) continue;
+        SuffixTree::SuffixTree<CharType, Debug> stree(prefix.c_str(), prefix.length());
+        const auto measureEngine = [&](const std::string& engine, auto queryType) {
+            using RepeatQuery = typename decltype(queryType)::type;
+            double sequentialTime = 0;
+            for (size_t threads = 1; threads <= maxThreads; threads++) {
+                Helpers::ThreadPool pool(threads);
+                std::optional<RepeatQuery> query;
+                size_t solutionLength = 0;
+                const Helpers::BenchmarkStatistics statistics = Helpers::measure(settings.warmup, settings.repetitions, [&]() {
+                    query.emplace(&stree);
+                }, [&]() {
+                    solutionLength = ((threads > 1) ? query->runQuery(pool) : query->runQuery()).second;
+                    return solutionLength;
+                });
+                if (threads == 1) sequentialTime = statistics.median;
+                report.add({{"algo", "parallelRepeatBenchmark"}, {"engine", engine}, {"threads", std::to_string(threads)}, {"inputLength", std::to_string(inputLength)},
+                            {"solutionLength", std::to_string(solutionLength)}, {"speedup", std::to_string(sequentialTime / statistics.median)}},
+                           statistics, "queryTime", inputFields(settings));
+            }
+        };
+        measureEngine("merge", std::type_identity<Query::RepeatQuery<CharType, Sentinel, Query::RepeatNoProfiler, Debug>>());
+        measureEngine("smallerhalf", std::type_identity<Query::SmallerHalfRepeatQuery<CharType, Sentinel, Query::RepeatNoProfiler, Debug>>());
+    }
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 4) {
+        std::cout << "Wrong number of arguments, expecting [preprocessing|topk|repeat|children|parallel-construction|parallel-repeat] path_to_input_file input_type." << std::endl;
+        return 1;
+    }
+
+    Helpers::CommandLine options(argc, argv);
+    const std::string format = options.get("format", "result");
+    if (!Helpers::BenchmarkReport::isFormat(format)) {
+        std::cout << "Unknown format, expecting result, csv or json." << std::endl;
+        return 1;
+    }
+    const std::string suite(argv[1]);
+    if (suite != "preprocessing" && suite != "topk" && suite != "repeat" && suite != "children" && suite != "parallel-construction" && suite != "parallel-repeat") {
+        std::cout << "Unknown benchmark, expecting preprocessing, topk, repeat, children, parallel-construction or parallel-repeat." << std::endl;
+        return 1;
+    }
+
+    BenchmarkSettings settings;
+    settings.inputFileName = argv[2];
+    settings.inputType = argv[3];
+    settings.warmup = options.getNumber("warmup", 1);
+    settings.repetitions = options.getNumber("repetitions", 5);
+    if (settings.repetitions == 0) {
+        std::cout << "At least one repetition is needed." << std::endl;
+        return 1;
+    }
+    Helpers::MappedFile inputFile(settings.inputFileName);
+    if (!inputFile.isOpen()) {
+        std::cout << "Could not open input file " << settings.inputFileName << "." << std::endl;
+        return 1;
+    }
+    settings.input = inputFile.view();
+
+    Helpers::BenchmarkReport report(format, options.get("output", ""), options.get("label", ""));
+    report.log() << "Requested " << suite << " benchmark." << std::endl;
+    report.log() << "Original input has length " << settings.input.length << std::endl;
+    if (suite == "preprocessing") {
+        preprocessingBenchmark(options, settings, report);
+    } else if (suite == "topk") {
+        if (options.has("profile")) {
+            topKBenchmark<Query::TopKPerfProfiler>(options, settings, report);
+        } else {
+            topKBenchmark<Query::TopKNoProfiler>(options, settings, report);
+        }
+    } else if (suite == "repeat") {
+        repeatBenchmark(options, settings, report);
+    } else if (suite == "children") {
+        childrenBenchmark(options, settings, report);
+    } else if (suite == "parallel-construction") {
+        parallelConstructionBenchmark(options, settings, report);
+    } else {
+        parallelRepeatBenchmark(options, settings, report);
+    }
+    return 0;
+}
@@ -4,12 +4,32 @@
 //#include "NaiveSuffixTree/SuffixTree.h"
 #include "Query/TopKQuery.h"
 #include "Query/RepeatQuery.h"
+#include "Query/SmallerHalfRepeatQuery.h"
+#include "Query/LzRepeatQuery.h"
+#include "Query/SuffixArrayTopKQuery.h"
+#include "Query/SuffixArrayRepeatQuery.h"
+#include "Query/CompressedTopKQuery.h"
+#include "Query/CompressedRepeatQuery.h"
+#include "Query/PatternQuery.h"
+#include "Query/DocumentCounts.h"
 #include "Helpers/Timer.h"
+#include "Helpers/CommandLine.h"
+#include "Helpers/ThreadPool.h"
+#include "Helpers/MappedFile.h"
+#include "Helpers/QueryServer.h"
 #include "Helpers/TopKProfiler.h"
 #include "Helpers/RepeatProfiler.h"
+#include "Helpers/Memory.h"
 
 #include "UkkonenSuffixTree/SuffixTree.h"
+#include "UkkonenSuffixTree/OnlineSuffixTree.h"
+#include "UkkonenSuffixTree/FrozenSuffixTree.h"
 #include "UkkonenSuffixTree/Node.h"
+#include "UkkonenSuffixTree/Children.h"
+#include "SuffixArray/SuffixArray.h"
+#include "SuffixArray/LcpIntervalTree.h"
+#include "CompressedSuffixTree/CompressedSuffixTree.h"
+#include "Index/SuffixTreeIndex.h"
 
 /**
  * One topK Query for length l and the k-th candidate.
@@ -25,64 +45,187 @@ static const bool Interactive = false;
 static const bool Debug = Interactive && false;
 using CharType = char;
 static const CharType Sentinel = '\0';
+//Follows every document but the last one in the text of a document collection, see Query/DocumentCounts.h.
+static const CharType Separator = '\x01';
 
-inline static void readRemainingFileContents(std::ifstream& inputFile, std::string& inputText) {
-    std::stringstream inputBuffer;
-    inputBuffer << inputFile.rdbuf();
-    inputText = inputBuffer.str();
-    inputText.push_back(Sentinel);//add sentinel for preprocessing
+/**
+ * Parses the next unsigned number in the text starting at position, like operator>> of a stream: leading whitespace is skipped.
+ * Afterwards, position points to the first character after the number.
+ */
+inline static size_t readNumber(const Helpers::TextView& input, size_t& position) noexcept {
+    while (position < input.length && std::isspace(static_cast<unsigned char>(input.text[position]))) position++;
+    size_t result = 0;
+    while (position < input.length && std::isdigit(static_cast<unsigned char>(input.text[position]))) {
+        result = 10 * result + (input.text[position] - '0');
+        position++;
+    }
+    return result;
 }
 
-inline static void handleTopKQuery(char *argv[]) {
-    if constexpr (Interactive) std::cout << "Requested topk query." << std::endl;
+/**
+ * True if the suffix tree of a text of the given length (including the sentinel) can use int positions:
+ * Its up to 2n nodes have to fit into the unsigned node indices of the same width.
+ */
+inline static bool isSmallText(size_t length) noexcept {
+    return length < static_cast<size_t>(std::numeric_limits<int>::max());
+}
 
-    std::string inputFileName(argv[2]);
-    std::ifstream inputFile(inputFileName);
+/**
+ * Calls function with a std::type_identity of the child container that fits the alphabet of the text best:
+ * A dense array for DNA texts and the adaptive container for everything else.
+ * The child indices are node indices of a tree with positions of type INDEX.
+ */
+template<typename INDEX = int, typename FUNCTION>
+inline static void withChildContainer(const CharType* text, size_t length, const FUNCTION& function) {
+    using NodeIndex = SuffixTree::NodeIndexOf<INDEX>;
+    if (SuffixTree::UpperCaseDnaAlphabet::contains(text, length)) {
+        function(std::type_identity<SuffixTree::DenseChildren<CharType, SuffixTree::UpperCaseDnaAlphabet, NodeIndex>>());
+    } else if (SuffixTree::LowerCaseDnaAlphabet::contains(text, length)) {
+        function(std::type_identity<SuffixTree::DenseChildren<CharType, SuffixTree::LowerCaseDnaAlphabet, NodeIndex>>());
+    } else {
+        function(std::type_identity<SuffixTree::AdaptiveChildren<CharType, NodeIndex>>());
+    }
+}
 
-    //Read the queries from the file.
-    size_t numberOfQueries;
-    inputFile >> numberOfQueries;
-    std::vector<TopKQuery> queries;
-    queries.reserve(numberOfQueries);
-    for (size_t i = 0; i < numberOfQueries; i++) {
-        size_t k, l;
-        inputFile >> l;
-        inputFile >> k;
-        queries.emplace_back(l, k);
+/**
+ * Calls function with a std::type_identity of the position type for a text of the given length: int if possible, int64_t otherwise.
+ */
+template<typename FUNCTION>
+inline static void withIndexType(size_t length, const FUNCTION& function) {
+    if (isSmallText(length)) {
+        function(std::type_identity<int>());
+    } else {
+        function(std::type_identity<int64_t>());
     }
-    if constexpr (Interactive) std::cout << "Found " << numberOfQueries << " queries." << std::endl;
+}
 
-    //Read the actual text.
-    std::string inputText;
-    readRemainingFileContents(inputFile, inputText);
+/**
+ * Builds the suffix tree for the text, with Ukkonen's algorithm by default or in parallel with --construction=parallel.
+ * The number of threads is --threads=N (default: all hardware threads), the parallel construction also annotates the tree in parallel.
+ */
+template<typename CHILDREN, typename INDEX = int>
+inline static SuffixTree::SuffixTree<CharType, Debug, CHILDREN, INDEX> buildSuffixTree(const Helpers::CommandLine& options, const CharType* text, size_t length) {
+    if (options.get("construction", "ukkonen") == "parallel") {
+        if constexpr (std::is_same_v<INDEX, int>) {
+            Helpers::ThreadPool pool(options.getNumber("threads", std::thread::hardware_concurrency()));
+            SuffixTree::SuffixTree<CharType, Debug, CHILDREN, INDEX> stree(text, length, pool);
+            //Annotate with the same threads, the queries find the tree annotated then.
+            stree.annotate(pool);
+            return stree;
+        } else {
+            std::cout << "Parallel construction is only supported for texts below 2 GiB, using Ukkonen's algorithm." << std::endl;
+        }
+    }
+    return SuffixTree::SuffixTree<CharType, Debug, CHILDREN, INDEX>(text, length);
+}
 
-    //Used for time for the output.
+/**
+ * Answers the topk queries with the given query instance and returns the start indices of the results.
+ * By default, the queries are run one after another. With --batch, they are answered all at once by increasing length, see TopKQuery::runQueries.
+ * With --query-threads=N, they are run concurrently on N threads against the shared tree and length index.
+ * The results are in the order of the queries in any case.
+ * The (wall-clock) time for all queries is added to totalQueryTime. latencies is set to the time of every single query in microseconds,
+ * it stays empty for --batch.
+ */
+template<typename QUERY>
+inline static std::vector<typename QUERY::Index> answerTopKQueries(const Helpers::CommandLine& options, QUERY& query, const std::vector<TopKQuery>& queries, size_t& totalQueryTime, std::vector<size_t>& latencies) {
+    Helpers::Timer queryTimer;
+    latencies.clear();
+    if (options.has("batch")) {
+        std::vector<typename QUERY::Index> startIndices = query.runQueries(queries);
+        totalQueryTime += queryTimer.getMilliseconds();
+        return startIndices;
+    }
+    std::vector<typename QUERY::Index> startIndices(queries.size());
+    latencies.resize(queries.size());
+    Helpers::ThreadPool pool(options.getNumber("query-threads", 1));
+    queryTimer.restart();
+    pool.parallelFor(queries.size(), [&](size_t i, size_t) {
+        Helpers::Timer latencyTimer;
+        startIndices[i] = query.runQuery(queries[i].l, queries[i].k);
+        latencies[i] = latencyTimer.getMicroseconds();
+    });
+    totalQueryTime += queryTimer.getMilliseconds();
+    return startIndices;
+}
+
+/**
+ * With --latencies, prints the latency of every topk query.
+ */
+inline static void printTopKLatencies(const Helpers::CommandLine& options, const std::vector<TopKQuery>& queries, const std::vector<size_t>& latencies) {
+    if (!options.has("latencies")) return;
+    for (size_t i = 0; i < latencies.size(); i++) {
+        std::cout << "RESULT algo=topkLatency"
+                  << " query=" << i
+                  << " l=" << queries[i].l
+                  << " k=" << queries[i].k
+                  << " latency=" << latencies[i] << "us" << std::endl;
+    }
+}
+
+/**
+ * The queries of the topk, repeat, index and serve modes are always traced (Helpers/Trace.h). With --histograms, the latency histograms
+ * of their phases are printed to out, with --trace=file, the sampled runs of the phases are written to file as Chrome trace JSON.
+ */
+inline static void reportTraces(const Helpers::CommandLine& options, std::ostream& out) {
+    if (options.has("histograms")) {
+        Query::TopKTraceProfiler::tracer().print(out);
+        Query::RepeatTraceProfiler::tracer().print(out);
+    }
+    const std::string traceFileName = options.get("trace", "");
+    if (traceFileName.empty()) return;
+    if (!Helpers::Tracer::writeChromeTrace(traceFileName, {&Query::TopKTraceProfiler::tracer(), &Query::RepeatTraceProfiler::tracer()})) {
+        out << "Could not write the trace to " << traceFileName << "." << std::endl;
+    }
+}
+
+/**
+ * Builds the suffix tree with buildSuffixTree and calls function(tree, preprocessingTime) with it and the time of the construction.
+ * By default, function gets the frozen copy of the tree (UkkonenSuffixTree/FrozenSuffixTree.h), which is annotated and laid out in bfs order
+ * for the queries. The freezing counts as construction, the original tree is released before function runs.
+ * With --layout=pointer, function gets the tree as it was constructed.
+ */
+template<typename CHILDREN, typename INDEX = int, typename FUNCTION>
+inline static void withSuffixTree(const Helpers::CommandLine& options, const Helpers::TextView& inputText, const FUNCTION& function) {
     Helpers::Timer preprocessingTimer;
-    //Generate the suffix tree for the input.
-    //Use +/-2 in start and length to cut off the line break between the last query part and the actual text.
-    SuffixTree::SuffixTree<CharType, Debug> stree(inputText.c_str() + 2, inputText.length() - 2);
-    size_t preprocessingTime = preprocessingTimer.getMilliseconds();
+    if (options.get("layout", "frozen") == "frozen") {
+        SuffixTree::FrozenSuffixTree<CharType, INDEX> frozenTree = [&]() {
+            SuffixTree::SuffixTree<CharType, Debug, CHILDREN, INDEX> stree = buildSuffixTree<CHILDREN, INDEX>(options, inputText.text, inputText.length);
+            return SuffixTree::FrozenSuffixTree<CharType, INDEX>(stree);
+        }();
+        function(frozenTree, preprocessingTimer.getMilliseconds());
+    } else {
+        SuffixTree::SuffixTree<CharType, Debug, CHILDREN, INDEX> stree = buildSuffixTree<CHILDREN, INDEX>(options, inputText.text, inputText.length);
+        function(stree, preprocessingTimer.getMilliseconds());
+    }
+}
+
+/**
+ * Runs the initialization of the topk query and the queries on the given suffix tree or frozen suffix tree and prints the results.
+ */
+template<typename CHILDREN, typename INDEX, typename TREE>
+inline static void answerTopKQueriesOnTree(const Helpers::CommandLine& options, const std::string& inputFileName, TREE& stree, size_t preprocessingTime, const std::vector<TopKQuery>& queries) {
+    using Children = CHILDREN;
+    const size_t numberOfQueries = queries.size();
     if constexpr (Debug) std::cout << "Generated suffix tree for input: '" << stree.text << "'." << std::endl;
 
     //The time needed (once) for additional query preprocessing will be added to the suffix tree generation time for the total preprocessing time.
     Helpers::Timer queryInitTimer;
     //Generate the query instance.
-    Query::TopKQuery<CharType, Sentinel, Query::TopKNoProfiler, Debug> query(&stree);
+    Query::TopKQuery<CharType, Sentinel, Query::TopKTraceProfiler, Debug, Children, INDEX, TREE> query(&stree);
     size_t queryInitTime = queryInitTimer.getMilliseconds();
 
-    if constexpr (Debug) stree.printSimple();
-
     size_t totalQueryTime = 0;
-    Helpers::Timer queryTimer;
+    std::vector<size_t> latencies;
     //Run the queries.
+    const auto startIndices = answerTopKQueries(options, query, queries, totalQueryTime, latencies);
     std::stringstream queryResults;
     for (size_t i = 0; i < numberOfQueries; i++) {
-        queryTimer.restart();
-        size_t startIndex = query.runQuery(queries[i].l, queries[i].k);
-        totalQueryTime += queryTimer.getMilliseconds();
-        queryResults << stree.substring(startIndex, queries[i].l);
+        //There may be fewer than k substrings of length l, the solution is empty then.
+        const bool solved = (startIndices[i] != decltype(query)::NoSolution);
+        if (solved) queryResults << stree.substring(startIndices[i], queries[i].l);
         if (i < numberOfQueries - 1) queryResults << ";";
-        if constexpr (Interactive) std::cout << "Query l=" << queries[i].l << ", k=" << queries[i].k << ": " << stree.substring(startIndex, queries[i].l) << " (" << startIndex << ")" << std::endl;
+        if constexpr (Interactive) std::cout << "Query l=" << queries[i].l << ", k=" << queries[i].k << ": " << (solved ? stree.substring(startIndices[i], queries[i].l) : "") << " (" << startIndices[i] << ")" << std::endl;
     }
 
     if constexpr (Interactive) {
@@ -100,41 +243,163 @@ inline static void handleTopKQuery(char *argv[]) {
                 << " construction time=" << (preprocessingTime + queryInitTime)//count the initialization of the query (that is independent of actual queries) as preprocessing time
                 << " query time=" << totalQueryTime
                 << " solutions=" << queryResults.str()
+                << Helpers::MemoryAccounting::resultFields()
                 << " file=" << inputFileName << std::endl;
+    printTopKLatencies(options, queries, latencies);
 }
 
-inline static void handleRepeatQuery(char *argv[]) {
-    if constexpr (Interactive) std::cout << "Requested repeat query." << std::endl;
+/**
+ * Builds the suffix tree with the given child container for the text and runs the topk queries on it.
+ */
+template<typename CHILDREN, typename INDEX = int>
+inline static void runTopKQueries(const Helpers::CommandLine& options, const std::string& inputFileName, const Helpers::TextView& inputText, const std::vector<TopKQuery>& queries) {
+    withSuffixTree<CHILDREN, INDEX>(options, inputText, [&](auto& stree, const size_t preprocessingTime) {
+        answerTopKQueriesOnTree<CHILDREN, INDEX>(options, inputFileName, stree, preprocessingTime, queries);
+    });
+}
 
-    std::string inputFileName(argv[2]);
-    std::ifstream inputFile(inputFileName);
+/**
+ * Builds the suffix array, the LCP array and the lcp-interval tree for the text and runs the topk queries on them.
+ * Produces the same output as runTopKQueries.
+ */
+inline static void runTopKQueriesOnSuffixArray(const std::string& inputFileName, const Helpers::TextView& inputText, const std::vector<TopKQuery>& queries) {
+    const size_t numberOfQueries = queries.size();
+    Helpers::Timer preprocessingTimer;
+    SuffixArray::SuffixArray<CharType, Debug> suffixArray(inputText.text, inputText.length);
+    SuffixArray::LcpIntervalTree<CharType, Debug> tree(&suffixArray);
+    Query::SuffixArrayTopKQuery<CharType, Sentinel, Query::TopKTraceProfiler, Debug> query(&tree);
+    size_t preprocessingTime = preprocessingTimer.getMilliseconds();
 
-    //Read the input text.
-    std::string inputText;
-    readRemainingFileContents(inputFile, inputText);
-    if constexpr (Debug) std::cout << "Read input file: '" << inputText << "'" << std::endl;
+    size_t totalQueryTime = 0;
+    Helpers::Timer queryTimer;
+    std::stringstream queryResults;
+    for (size_t i = 0; i < numberOfQueries; i++) {
+        queryTimer.restart();
+        const int startIndex = query.runQuery(queries[i].l, queries[i].k);
+        totalQueryTime += queryTimer.getMilliseconds();
+        //As in answerTopKQueriesOnTree, the solution is empty if there are fewer than k substrings of length l.
+        if (startIndex != decltype(query)::NoSolution) queryResults << suffixArray.substring(startIndex, queries[i].l);
+        if (i < numberOfQueries - 1) queryResults << ";";
+    }
 
-    //Measure the preprocessing time.
-    Helpers::Timer preprocessingTimer;
-    //Generate the suffix tree.
+    std::cout   << "RESULT algo=topk name=moritz-potthoff"
+                << " construction time=" << preprocessingTime
+                << " query time=" << totalQueryTime
+                << " solutions=" << queryResults.str()
+                << Helpers::MemoryAccounting::resultFields()
+                << " file=" << inputFileName << std::endl;
+}
 
-    SuffixTree::SuffixTree<CharType, Debug> stree(inputText.c_str(), inputText.length());
+/**
+ * Builds the compressed suffix tree for the text (sample rate --sample-rate=N) and runs the topk queries on it.
+ * Produces the same output as runTopKQueries.
+ */
+inline static void runTopKQueriesOnCompressedSuffixTree(const Helpers::CommandLine& options, const std::string& inputFileName, const Helpers::TextView& inputText, const std::vector<TopKQuery>& queries) {
+    using Tree = CompressedSuffixTree::CompressedSuffixTree<CharType, Debug>;
+    const size_t numberOfQueries = queries.size();
+    Helpers::Timer preprocessingTimer;
+    Tree tree(inputText.text, inputText.length, options.getNumber("sample-rate", Tree::DefaultSampleRate));
+    Query::CompressedTopKQuery<CharType, Sentinel, Query::TopKTraceProfiler, Debug> query(&tree);
     size_t preprocessingTime = preprocessingTimer.getMilliseconds();
-    if constexpr (Debug) std::cout << "Generated suffix tree for input: '" << stree.text << "'" << std::endl;
+    if constexpr (Interactive) std::cout << "Compressed suffix tree uses " << tree.memoryUsage() << " bytes." << std::endl;
+
+    size_t totalQueryTime = 0;
+    Helpers::Timer queryTimer;
+    std::stringstream queryResults;
+    for (size_t i = 0; i < numberOfQueries; i++) {
+        queryTimer.restart();
+        const int startIndex = query.runQuery(queries[i].l, queries[i].k);
+        totalQueryTime += queryTimer.getMilliseconds();
+        //As in answerTopKQueriesOnTree, the solution is empty if there are fewer than k substrings of length l.
+        if (startIndex != decltype(query)::NoSolution) queryResults << tree.substring(startIndex, queries[i].l);
+        if (i < numberOfQueries - 1) queryResults << ";";
+    }
+
+    std::cout   << "RESULT algo=topk name=moritz-potthoff"
+                << " construction time=" << preprocessingTime
+                << " query time=" << totalQueryTime
+                << " solutions=" << queryResults.str()
+                << Helpers::MemoryAccounting::resultFields()
+                << " file=" << inputFileName << std::endl;
+}
+
+/**
+ * Parses the number of queries and the queries (l, k) at the start of a topk input file.
+ * Afterwards, position points to the first character after the last query.
+ */
+inline static std::vector<TopKQuery> readTopKQueries(const Helpers::TextView& input, size_t& position) noexcept {
+    size_t numberOfQueries = readNumber(input, position);
+    std::vector<TopKQuery> queries;
+    queries.reserve(numberOfQueries);
+    for (size_t i = 0; i < numberOfQueries; i++) {
+        size_t l = readNumber(input, position);
+        size_t k = readNumber(input, position);
+        queries.emplace_back(l, k);
+    }
+    if constexpr (Interactive) std::cout << "Found " << numberOfQueries << " queries." << std::endl;
+    return queries;
+}
+
+inline static void handleTopKQuery(const Helpers::CommandLine& options, char *argv[]) {
+    if constexpr (Interactive) std::cout << "Requested topk query." << std::endl;
 
-    if constexpr (Interactive) std::cout << "Preprocessing done." << std::endl;
+    std::string inputFileName(argv[2]);
+    //The file is mapped instead of read, the text is never copied.
+    Helpers::MappedFile inputFile(inputFileName);
+    if (!inputFile.isOpen()) {
+        std::cout << "Could not open input file " << inputFileName << "." << std::endl;
+        return;
+    }
+    const Helpers::TextView input = inputFile.view();
+
+    //Parse the queries in place.
+    size_t position = 0;
+    const std::vector<TopKQuery> queries = readTopKQueries(input, position);
+
+    //The actual text is the rest of the file. Skip 2 characters to cut off the line break between the last query part and the actual text.
+    const Helpers::TextView inputText = input.suffix(std::min(position + 2, input.length - 1));
+
+    const std::string backend = options.get("backend", "tree");
+    if (backend != "tree" && !isSmallText(inputText.length)) {
+        std::cout << "The suffix array backends only support texts below 2 GiB." << std::endl;
+        return;
+    }
+    if (backend == "sa") {
+        runTopKQueriesOnSuffixArray(inputFileName, inputText, queries);
+        return;
+    }
+    if (backend == "cst") {
+        runTopKQueriesOnCompressedSuffixTree(options, inputFileName, inputText, queries);
+        return;
+    }
+    withIndexType(inputText.length, [&](auto index) {
+        using Index = typename decltype(index)::type;
+        withChildContainer<Index>(inputText.text, inputText.length, [&](auto children) {
+            runTopKQueries<typename decltype(children)::type, Index>(options, inputFileName, inputText, queries);
+        });
+    });
+}
+
+/**
+ * Runs the initialization of the repeat query QUERY and the query on the given suffix tree and prints the result.
+ */
+template<typename QUERY, typename TREE>
+inline static void answerRepeatQuery(const Helpers::CommandLine& options, const std::string& inputFileName, TREE& stree, size_t preprocessingTime) {
     //Again, query initialization time will be measured as preprocessing time.
     Helpers::Timer queryInitTimer;
     //Generate the query instance.
-    Query::RepeatQuery<CharType, Sentinel, Query::RepeatNoProfiler, Debug> query(&stree);
+    QUERY query(&stree);
     size_t queryInitTime = queryInitTimer.getMilliseconds();
 
     if constexpr (Debug) stree.printSimple();
 
     size_t startPosition, length;
+    //With --query-threads=N, the inner nodes of each string depth are processed on N threads. Starting the threads is not part of the query.
+    const size_t threads = options.getNumber("query-threads", 1);
+    Helpers::ThreadPool pool(threads);
     Helpers::Timer queryTimer;
     //Compute the query.
-    std::tie(startPosition, length) = query.runQuery();
+    std::tie(startPosition, length) = (threads > 1) ? query.runQuery(pool) : query.runQuery();
     size_t queryTime = queryTimer.getMilliseconds();
     if constexpr (Interactive) {
         std::cout << "Query result: " << stree.substring(startPosition, length) << " (" << startPosition << ", " << length << ")" << std::endl << std::endl;
@@ -150,113 +415,775 @@ inline static void handleRepeatQuery(char *argv[]) {
               << " construction time=" << (preprocessingTime + queryInitTime)//count query initialization as preprocessing: It could be done during the suffix tree generation, if that was only used for repeat queries.
               << " query time=" << queryTime
               << " solution=" << stree.substring(startPosition, length)
+              << Helpers::MemoryAccounting::resultFields()
               << " file=" << inputFileName << std::endl;
 }
 
-inline static std::string getPrefix(std::string input, int length) noexcept {
-    if (length >= input.length()) std::cout << "ERROR: insufficient input." << std::endl;
-    std::string result(input);
-    result.resize(length);
-    return result;
+/**
+ * Builds the suffix tree with the given child container for the text and runs the repeat query on it.
+ * The query is the smaller-half engine unless --repeat=merge selects the merging engine.
+ */
+template<typename CHILDREN, typename INDEX = int>
+inline static void runRepeatQuery(const Helpers::CommandLine& options, const std::string& inputFileName, const Helpers::TextView& inputText) {
+    using Children = CHILDREN;
+    using Index = INDEX;
+    //Generate the frozen suffix tree (or the constructed one with --layout=pointer), the preprocessing time is measured by withSuffixTree.
+    withSuffixTree<Children, Index>(options, inputText, [&](auto& stree, const size_t preprocessingTime) {
+        using Tree = std::remove_reference_t<decltype(stree)>;
+        if constexpr (Debug) std::cout << "Generated suffix tree for input: '" << stree.text << "'" << std::endl;
+
+        if constexpr (Interactive) std::cout << "Preprocessing done." << std::endl;
+        if (options.get("repeat", "smallerhalf") == "merge") {
+            answerRepeatQuery<Query::RepeatQuery<CharType, Sentinel, Query::RepeatTraceProfiler, Debug, Children, Index, Tree>>(options, inputFileName, stree, preprocessingTime);
+        } else {
+            answerRepeatQuery<Query::SmallerHalfRepeatQuery<CharType, Sentinel, Query::RepeatTraceProfiler, Debug, Children, Index, Tree>>(options, inputFileName, stree, preprocessingTime);
+        }
+    });
 }
 
-static std::vector<int> inputTextLengths = { 100000, 500000, 1000000 };
-static std::vector<int> inputTextLengths2 = { 10000000, 15000000 };
-static std::vector<int> inputTextLengths3 = { 20000000 };
-static std::vector<int> inputTextLengths4 = { 5000000 };
-static std::vector<int> queryInputTextLengths = { 1000, 1000000, 2500000, 5000000, 7500000, 10000000 };
-static std::vector<int> queryInputTextLengthsTopK = { 10000000 };
-static std::vector<int> topKQueryLengths = { 1, 5, 10, 50, 100, 500, 1000, 5000, 10000, 50000, 100000, 500000, 1000000 };
-static std::vector<int> topKQueryLengthsSmall = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20 };
-static std::vector<int> topKQueryLengths2 = { 10 };
+/**
+ * Builds the suffix array, the LCP array and the lcp-interval tree for the text and runs the repeat query on them.
+ * Produces the same output as runRepeatQuery.
+ */
+inline static void runRepeatQueryOnSuffixArray(const std::string& inputFileName, const Helpers::TextView& inputText) {
+    Helpers::Timer preprocessingTimer;
+    SuffixArray::SuffixArray<CharType, Debug> suffixArray(inputText.text, inputText.length);
+    SuffixArray::LcpIntervalTree<CharType, Debug> tree(&suffixArray);
+    Query::SuffixArrayRepeatQuery<CharType, Sentinel, Query::RepeatTraceProfiler, Debug> query(&tree);
+    size_t preprocessingTime = preprocessingTimer.getMilliseconds();
 
-inline static void preprocessingExperiment(char *argv[]) {
-    std::cout << "Requested preprocessing experiment." << std::endl;
+    size_t startPosition, length;
+    Helpers::Timer queryTimer;
+    std::tie(startPosition, length) = query.runQuery();
+    size_t queryTime = queryTimer.getMilliseconds();
+    std::cout << "RESULT algo=repeat name=moritz-potthoff"
+              << " construction time=" << preprocessingTime
+              << " query time=" << queryTime
+              << " solution=" << suffixArray.substring(startPosition, length)
+              << Helpers::MemoryAccounting::resultFields()
+              << " file=" << inputFileName << std::endl;
+}
+
+/**
+ * Builds the compressed suffix tree for the text (sample rate --sample-rate=N) and runs the repeat query on it.
+ * Produces the same output as runRepeatQuery.
+ */
+inline static void runRepeatQueryOnCompressedSuffixTree(const Helpers::CommandLine& options, const std::string& inputFileName, const Helpers::TextView& inputText) {
+    using Tree = CompressedSuffixTree::CompressedSuffixTree<CharType, Debug>;
+    Helpers::Timer preprocessingTimer;
+    Tree tree(inputText.text, inputText.length, options.getNumber("sample-rate", Tree::DefaultSampleRate));
+    Query::CompressedRepeatQuery<CharType, Sentinel, Query::RepeatTraceProfiler, Debug> query(&tree);
+    size_t preprocessingTime = preprocessingTimer.getMilliseconds();
+    if constexpr (Interactive) std::cout << "Compressed suffix tree uses " << tree.memoryUsage() << " bytes." << std::endl;
+
+    size_t startPosition, length;
+    Helpers::Timer queryTimer;
+    std::tie(startPosition, length) = query.runQuery();
+    size_t queryTime = queryTimer.getMilliseconds();
+    std::cout << "RESULT algo=repeat name=moritz-potthoff"
+              << " construction time=" << preprocessingTime
+              << " query time=" << queryTime
+              << " solution=" << tree.substring(startPosition, length)
+              << Helpers::MemoryAccounting::resultFields()
+              << " file=" << inputFileName << std::endl;
+}
+
+/**
+ * Builds the suffix array, the LCP array and the lcp-interval tree for the text and runs the LZ77-based repeat query on them.
+ * The factorization is part of the query, it is only needed for this query.
+ * Produces the same output as runRepeatQuery.
+ */
+inline static void runLzRepeatQuery(const std::string& inputFileName, const Helpers::TextView& inputText) {
+    Helpers::Timer preprocessingTimer;
+    SuffixArray::SuffixArray<CharType, Debug> suffixArray(inputText.text, inputText.length);
+    SuffixArray::LcpIntervalTree<CharType, Debug> tree(&suffixArray);
+    size_t preprocessingTime = preprocessingTimer.getMilliseconds();
+
+    size_t startPosition, length;
+    Helpers::Timer queryTimer;
+    Query::LzRepeatQuery<CharType, Sentinel, Query::RepeatTraceProfiler, Debug> query(&tree);
+    std::tie(startPosition, length) = query.runQuery();
+    size_t queryTime = queryTimer.getMilliseconds();
+    std::cout << "RESULT algo=repeat name=moritz-potthoff"
+              << " construction time=" << preprocessingTime
+              << " query time=" << queryTime
+              << " solution=" << suffixArray.substring(startPosition, length)
+              << Helpers::MemoryAccounting::resultFields()
+              << " file=" << inputFileName << std::endl;
+}
+
+inline static void handleRepeatQuery(const Helpers::CommandLine& options, char *argv[]) {
+    if constexpr (Interactive) std::cout << "Requested repeat query." << std::endl;
 
     std::string inputFileName(argv[2]);
-    std::ifstream inputFile(inputFileName);
+    //The file is mapped instead of read, the whole file is the text.
+    Helpers::MappedFile inputFile(inputFileName);
+    if (!inputFile.isOpen()) {
+        std::cout << "Could not open input file " << inputFileName << "." << std::endl;
+        return;
+    }
+    const Helpers::TextView inputText = inputFile.view();
+    if constexpr (Debug) std::cout << "Read input file: '" << inputText.text << "'" << std::endl;
 
-    //Read the input text.
-    std::string inputText;
-    readRemainingFileContents(inputFile, inputText);
-    std::cout << "Original input has length " << inputText.length() << std::endl;
+    //The LZ77-based query always runs on the suffix array.
+    const std::string backend = options.get("backend", "tree");
+    const bool onSuffixArray = options.get("repeat", "smallerhalf") == "lz" || backend != "tree";
+    if (onSuffixArray && !isSmallText(inputText.length)) {
+        std::cout << "The suffix array backends only support texts below 2 GiB." << std::endl;
+        return;
+    }
+    if (options.get("repeat", "smallerhalf") == "lz") {
+        runLzRepeatQuery(inputFileName, inputText);
+        return;
+    }
+    if (backend == "sa") {
+        runRepeatQueryOnSuffixArray(inputFileName, inputText);
+        return;
+    }
+    if (backend == "cst") {
+        runRepeatQueryOnCompressedSuffixTree(options, inputFileName, inputText);
+        return;
+    }
+    withIndexType(inputText.length, [&](auto index) {
+        using Index = typename decltype(index)::type;
+        withChildContainer<Index>(inputText.text, inputText.length, [&](auto children) {
+            runRepeatQuery<typename decltype(children)::type, Index>(options, inputFileName, inputText);
+        });
+    });
+}
 
-    for (int inputLength : inputTextLengths4) {
-        std::string prefix = getPrefix(inputText, inputLength);
+/**
+ * Builds the suffix tree, runs the initialization of the query and writes the annotated tree as index.
+ */
+template<typename CHILDREN>
+inline static void buildIndex(const Helpers::CommandLine& options, const std::string& inputFileName, const Helpers::TextView& inputText, Index::QueryType queryType, const std::string& indexFileName) {
+    using Children = CHILDREN;
+    Helpers::Timer preprocessingTimer;
+    SuffixTree::SuffixTree<CharType, Debug, Children> stree = buildSuffixTree<Children>(options, inputText.text, inputText.length);
+    std::vector<SuffixTree::NodeIndex> sortedInnerNodes;
+    if (queryType == Index::QueryType::TopK) {
+        Query::TopKQuery<CharType, Sentinel, Query::TopKTraceProfiler, Debug, Children> query(&stree);
+    } else {
+        Query::RepeatQuery<CharType, Sentinel, Query::RepeatTraceProfiler, Debug, Children> query(&stree);
+        sortedInnerNodes.swap(query.sortedInnerNodes);
+    }
+    size_t preprocessingTime = preprocessingTimer.getMilliseconds();
 
-        Helpers::Timer preprocessingTimer;
-        SuffixTree::SuffixTree<CharType, Debug> stree(prefix.c_str(), prefix.length());
-        size_t preprocessingTime = preprocessingTimer.getMilliseconds();
+    Helpers::Timer writeTimer;
+    if (!Index::writeIndex(indexFileName, stree, queryType, sortedInnerNodes)) {
+        std::cout << "Could not write index file " << indexFileName << "." << std::endl;
+        return;
+    }
+    size_t writeTime = writeTimer.getMilliseconds();
+
+    std::cout << "RESULT algo=build-index name=moritz-potthoff"
+              << " query=" << Index::queryTypeName(queryType)
+              << " construction time=" << preprocessingTime
+              << " write time=" << writeTime
+              << " nodes=" << stree.numberOfNodes()
+              << " index=" << indexFileName
+              << Helpers::MemoryAccounting::resultFields()
+              << " file=" << inputFileName << std::endl;
+}
 
-        std::cout << "RESULT algo=preprocessingExperiment"
-                  << " constructionTime=" << preprocessingTime
+/**
+ * Builds an index for the input file (a topk or repeat input, see --query=topk|repeat) and writes it to --index=path (default: the input file name + .index).
+ */
+inline static void handleBuildIndex(const Helpers::CommandLine& options, char *argv[]) {
+    std::string inputFileName(argv[2]);
+    const std::string queryName = options.get("query", "topk");
+    if (queryName != "topk" && queryName != "repeat") {
+        std::cout << "Unknown query, expecting topk or repeat." << std::endl;
+        return;
+    }
+    const Index::QueryType queryType = (queryName == "topk") ? Index::QueryType::TopK : Index::QueryType::Repeat;
+    const std::string indexFileName = options.get("index", inputFileName + ".index");
+
+    Helpers::MappedFile inputFile(inputFileName);
+    if (!inputFile.isOpen()) {
+        std::cout << "Could not open input file " << inputFileName << "." << std::endl;
+        return;
+    }
+    Helpers::TextView inputText = inputFile.view();
+    if (queryType == Index::QueryType::TopK) {
+        //The queries in the file are not part of the index, skip them like handleTopKQuery does.
+        size_t position = 0;
+        readTopKQueries(inputText, position);
+        inputText = inputText.suffix(std::min(position + 2, inputText.length - 1));
+    }
+    //The index file stores 32 bit positions and node indices.
+    if (!isSmallText(inputText.length)) {
+        std::cout << "Indices are only supported for texts below 2 GiB." << std::endl;
+        return;
+    }
+    withChildContainer(inputText.text, inputText.length, [&](auto children) {
+        buildIndex<typename decltype(children)::type>(options, inputFileName, inputText, queryType, indexFileName);
+    });
+}
+
+/**
+ * Maps an index built with build-index and answers the queries of its query type directly on the mapped file.
+ * For topk indices, the queries are read from --queries=path (a topk input file, its text is ignored).
+ * Produces the same output as the topk and repeat modes, the construction time is the time to open the index.
+ */
+inline static void handleQueryIndex(const Helpers::CommandLine& options, char *argv[]) {
+    using IndexTree = Index::MappedSuffixTree<CharType>;
+    std::string indexFileName(argv[2]);
+
+    Helpers::Timer preprocessingTimer;
+    IndexTree index(indexFileName);
+    if (!index.isValid()) return;
+    size_t preprocessingTime = preprocessingTimer.getMilliseconds();
+
+    if (index.queryType() == Index::QueryType::TopK) {
+        const std::string queryFileName = options.get("queries", "");
+        Helpers::MappedFile queryFile(queryFileName);
+        if (!queryFile.isOpen()) {
+            std::cout << "Could not open query file '" << queryFileName << "', use --queries=path." << std::endl;
+            return;
+        }
+        size_t position = 0;
+        const std::vector<TopKQuery> queries = readTopKQueries(queryFile.view(), position);
+        const size_t numberOfQueries = queries.size();
+
+        Helpers::Timer queryInitTimer;
+        Query::TopKQuery<CharType, Sentinel, Query::TopKTraceProfiler, Debug, SuffixTree::AdaptiveChildren<CharType>, int, IndexTree> query(&index);
+        size_t queryInitTime = queryInitTimer.getMilliseconds();
+
+        size_t totalQueryTime = 0;
+        std::vector<size_t> latencies;
+        const auto startIndices = answerTopKQueries(options, query, queries, totalQueryTime, latencies);
+        std::stringstream queryResults;
+        for (size_t i = 0; i < numberOfQueries; i++) {
+            if (startIndices[i] != decltype(query)::NoSolution) queryResults << index.substring(startIndices[i], queries[i].l);
+            if (i < numberOfQueries - 1) queryResults << ";";
+        }
+        std::cout   << "RESULT algo=topk name=moritz-potthoff"
+                    << " construction time=" << (preprocessingTime + queryInitTime)
+                    << " query time=" << totalQueryTime
+                    << " solutions=" << queryResults.str()
+                    << Helpers::MemoryAccounting::resultFields()
+                    << " file=" << indexFileName << std::endl;
+        printTopKLatencies(options, queries, latencies);
+    } else {
+        Helpers::Timer queryInitTimer;
+        Query::RepeatQuery<CharType, Sentinel, Query::RepeatTraceProfiler, Debug, SuffixTree::AdaptiveChildren<CharType>, int, IndexTree> query(&index);
+        size_t queryInitTime = queryInitTimer.getMilliseconds();
+
+        size_t startPosition, length;
+        Helpers::Timer queryTimer;
+        std::tie(startPosition, length) = query.runQuery();
+        size_t queryTime = queryTimer.getMilliseconds();
+        std::cout << "RESULT algo=repeat name=moritz-potthoff"
+                  << " construction time=" << (preprocessingTime + queryInitTime)
+                  << " query time=" << queryTime
+                  << " solution=" << index.substring(startPosition, length)
+                  << Helpers::MemoryAccounting::resultFields()
+                  << " file=" << indexFileName << std::endl;
+    }
+}
+
+/**
+ * Builds the tree for a topk input file once and measures the throughput of its queries with 1 to --query-threads=N threads
+ * (default: all hardware threads).
+ */
+template<typename CHILDREN>
+inline static void topKThroughputExperimentRun(const Helpers::CommandLine& options, char *argv[], const std::string& inputFileName, const Helpers::TextView& inputText, const std::vector<TopKQuery>& queries) {
+    SuffixTree::SuffixTree<CharType, Debug, CHILDREN> stree(inputText.text, inputText.length);
+    Query::TopKQuery<CharType, Sentinel, Query::TopKNoProfiler, Debug, CHILDREN> query(&stree);
+
+    const size_t maxThreads = options.getNumber("query-threads", std::thread::hardware_concurrency());
+    for (size_t threads = 1; threads <= maxThreads; threads++) {
+        Helpers::CommandLine threadOptions(options);
+        threadOptions.set("query-threads", std::to_string(threads));
+        size_t totalQueryTime = 0;
+        std::vector<size_t> latencies;
+        answerTopKQueries(threadOptions, query, queries, totalQueryTime, latencies);
+        std::sort(latencies.begin(), latencies.end());
+        std::cout << "RESULT algo=topKThroughputExperiment"
+                  << " threads=" << threads
+                  << " queryTime=" << totalQueryTime
+                  << " throughput=" << queries.size() * 1000.0 / std::max<size_t>(totalQueryTime, 1) << "queries/s"
+                  << " medianLatency=" << latencies[latencies.size() / 2] << "us"
+                  << " maxLatency=" << latencies.back() << "us"
                   << " inputType=" << argv[3]
-                  << " inputLength=" << prefix.length()
+                  << " numberOfQueries=" << queries.size()
                   << " file=" << inputFileName << std::endl;
     }
 }
 
-inline static void topKQueryExperiment(char *argv[]) {
-    std::cout << "Requested topKQuery experiment." << std::endl;
+inline static void topKThroughputExperiment(const Helpers::CommandLine& options, char *argv[]) {
+    std::cout << "Requested topK throughput experiment." << std::endl;
+    if (options.has("batch")) {
+        std::cout << "The throughput experiment measures single queries, --batch is not supported." << std::endl;
+        return;
+    }
 
     std::string inputFileName(argv[2]);
-    std::ifstream inputFile(inputFileName);
+    Helpers::MappedFile inputFile(inputFileName);
+    if (!inputFile.isOpen()) {
+        std::cout << "Could not open input file " << inputFileName << "." << std::endl;
+        return;
+    }
+    const Helpers::TextView input = inputFile.view();
+    size_t position = 0;
+    const std::vector<TopKQuery> queries = readTopKQueries(input, position);
+    if (queries.empty()) {
+        std::cout << "The input file contains no queries." << std::endl;
+        return;
+    }
+    const Helpers::TextView inputText = input.suffix(std::min(position + 2, input.length - 1));
+    withChildContainer(inputText.text, inputText.length, [&](auto children) {
+        topKThroughputExperimentRun<typename decltype(children)::type>(options, argv, inputFileName, inputText, queries);
+    });
+}
 
-    //Read the input text.
-    std::string inputText;
-    readRemainingFileContents(inputFile, inputText);
-    std::cout << "Original input has length " << inputText.length() << std::endl;
+/**
+ * Answers the requests of the query server (see Helpers/QueryServer.h) with the given topk query and the precomputed repeat solution.
+ * Either of them may be nullptr if the index does not support that query type.
+ * The requests are read from stdin and answered on stdout, or with --socket=path from the connections to a Unix domain socket, one after another.
+ * --query-threads=N answers requests that arrive together on N threads. The statistics of every connection are written to stderr.
+ */
+template<typename TOPK_QUERY>
+inline static void serveRequests(const Helpers::CommandLine& options, const CharType* text, TOPK_QUERY* topKQuery, const std::pair<size_t, size_t>* repeatSolution, size_t constructionTime) {
+    using Index = typename TOPK_QUERY::Index;
+    Helpers::QueryServer server(text, options.getNumber("query-threads", 1));
+    const auto execute = [&](const Helpers::ServerRequest& request, size_t) {
+        Helpers::ServerAnswer answer{false, 0, 0, "", 0};
+        if (request.type == Helpers::ServerRequest::Type::Repeat) {
+            if (repeatSolution == nullptr) {
+                answer.error = "the index does not support repeat queries";
+                return answer;
+            }
+            answer.found = true;
+            std::tie(answer.start, answer.length) = *repeatSolution;
+            return answer;
+        }
+        if (topKQuery == nullptr) {
+            answer.error = "the index does not support topk queries";
+            return answer;
+        }
+        const Index startIndex = (request.l < static_cast<size_t>(topKQuery->tree->n) && request.k < static_cast<size_t>(topKQuery->tree->n))
+            ? topKQuery->runQuery(request.l, request.k)
+            : TOPK_QUERY::NoSolution;
+        if (startIndex == TOPK_QUERY::NoSolution) {
+            answer.error = "there are fewer than k substrings of length l";
+            return answer;
+        }
+        answer.found = true;
+        answer.start = startIndex;
+        answer.length = request.l;
+        return answer;
+    };
+    const auto printStatistics = [&](Helpers::QueryServer::Statistics& statistics) {
+        if (statistics.requests == 0) return;
+        std::sort(statistics.latencies.begin(), statistics.latencies.end());
+        std::cerr << "RESULT algo=serve"
+                  << " requests=" << statistics.requests
+                  << " time=" << statistics.time << "ms"
+                  << " throughput=" << statistics.requests * 1000.0 / std::max<size_t>(statistics.time, 1) << "requests/s"
+                  << " medianLatency=" << statistics.latencies[statistics.latencies.size() / 2] << "us"
+                  << " p99Latency=" << statistics.latencies[statistics.latencies.size() * 99 / 100] << "us"
+                  << " maxLatency=" << statistics.latencies.back() << "us"
+                  << Helpers::MemoryAccounting::resultFields() << std::endl;
+        //No query runs between two connections, so the traces can be read.
+        reportTraces(options, std::cerr);
+    };
 
-    for (int inputLength : queryInputTextLengthsTopK) {
-        std::string prefix = getPrefix(inputText, inputLength);
-        SuffixTree::SuffixTree<CharType, Debug> stree(prefix.c_str(), prefix.length());
-        Query::TopKQuery<CharType, Sentinel, Query::TopKNoProfiler, Debug> query(&stree);
+    std::cerr << "Ready after construction time=" << constructionTime << "ms with " << server.numberOfThreads() << " query threads." << std::endl;
+    if (!options.has("socket")) {
+        Helpers::QueryServer::Statistics statistics = server.serve(STDIN_FILENO, STDOUT_FILENO, execute);
+        printStatistics(statistics);
+        return;
+    }
+    const std::string socketPath = options.get("socket", "");
+    const int socketFd = Helpers::QueryServer::listenOnSocket(socketPath);
+    if (socketFd < 0) return;
+    std::cerr << "Listening on " << socketPath << "." << std::endl;
+    while (true) {
+        const int connection = accept(socketFd, nullptr, nullptr);
+        if (connection < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "Could not accept a connection: " << std::strerror(errno) << std::endl;
+            break;
+        }
+        Helpers::QueryServer::Statistics statistics = server.serve(connection, connection, execute);
+        close(connection);
+        printStatistics(statistics);
+        if (statistics.shutdown) break;
+    }
+    close(socketFd);
+    unlink(socketPath.c_str());
+}
 
-        //Run the queries.
-        Helpers::Timer queryTimer;
-        for (int queryLength : topKQueryLengthsSmall) {
-            if (queryLength >= inputLength) break;
-            queryTimer.restart();
-            size_t startIndex = query.runQuery(queryLength, 1);
-            int queryTime = queryTimer.getMilliseconds();
-            std::cout << "RESULT algo=topKQueryExperiment"
-                      << " queryTime=" << queryTime
-                      << " inputType=" << argv[3]
-                      << " inputLength=" << prefix.length()
-                      << " queryLength=" << queryLength
-                      << " file=" << inputFileName << std::endl;
+/**
+ * Builds the suffix tree for the server and answers the repeat query on it once.
+ * Both queries share the annotation of the tree (see UkkonenSuffixTree/Annotation.h), so it is built and annotated only once.
+ */
+template<typename CHILDREN, typename INDEX>
+inline static void serveSuffixTree(const Helpers::CommandLine& options, const Helpers::TextView& inputText) {
+    using Children = CHILDREN;
+    using Index = INDEX;
+    Helpers::Timer preprocessingTimer;
+    withSuffixTree<Children, Index>(options, inputText, [&](auto& stree, size_t) {
+        using Tree = std::remove_reference_t<decltype(stree)>;
+        std::pair<size_t, size_t> repeatSolution;
+        if (options.get("repeat", "smallerhalf") == "merge") {
+            Query::RepeatQuery<CharType, Sentinel, Query::RepeatTraceProfiler, Debug, Children, Index, Tree> query(&stree);
+            repeatSolution = query.runQuery();
+        } else {
+            Query::SmallerHalfRepeatQuery<CharType, Sentinel, Query::RepeatTraceProfiler, Debug, Children, Index, Tree> query(&stree);
+            repeatSolution = query.runQuery();
         }
-        std::cout << std::endl;
+        Query::TopKQuery<CharType, Sentinel, Query::TopKTraceProfiler, Debug, Children, Index, Tree> query(&stree);
+        serveRequests(options, stree.text, &query, &repeatSolution, preprocessingTimer.getMilliseconds());
+    });
+}
+
+/**
+ * Builds the index once and answers topk and repeat requests until the input ends, see serveRequests.
+ * The whole input file is the text, with --index it is an index built with build-index: a topk index supports topk requests only,
+ * a repeat index both.
+ */
+inline static void handleServe(const Helpers::CommandLine& options, char *argv[]) {
+    std::string inputFileName(argv[2]);
+    if (options.has("index")) {
+        using IndexTree = Index::MappedSuffixTree<CharType>;
+        using IndexTopKQuery = Query::TopKQuery<CharType, Sentinel, Query::TopKTraceProfiler, Debug, SuffixTree::AdaptiveChildren<CharType>, int, IndexTree>;
+        Helpers::Timer preprocessingTimer;
+        IndexTree index(inputFileName);
+        if (!index.isValid()) return;
+        if (index.queryType() == Index::QueryType::TopK) {
+            IndexTopKQuery query(&index);
+            serveRequests(options, index.text, &query, nullptr, preprocessingTimer.getMilliseconds());
+        } else {
+            Query::RepeatQuery<CharType, Sentinel, Query::RepeatTraceProfiler, Debug, SuffixTree::AdaptiveChildren<CharType>, int, IndexTree> query(&index);
+            const std::pair<size_t, size_t> repeatSolution = query.runQuery();
+            //The annotations are shared, so the repeat index answers topk requests as well.
+            IndexTopKQuery topKQuery(&index);
+            serveRequests(options, index.text, &topKQuery, &repeatSolution, preprocessingTimer.getMilliseconds());
+        }
+        return;
+    }
+    Helpers::MappedFile inputFile(inputFileName);
+    if (!inputFile.isOpen()) {
+        std::cout << "Could not open input file " << inputFileName << "." << std::endl;
+        return;
+    }
+    const Helpers::TextView inputText = inputFile.view();
+    withIndexType(inputText.length, [&](auto index) {
+        using Index = typename decltype(index)::type;
+        withChildContainer<Index>(inputText.text, inputText.length, [&](auto children) {
+            serveSuffixTree<typename decltype(children)::type, Index>(options, inputText);
+        });
+    });
+}
+
+/**
+ * One pattern of a count or locate batch, a line of the pattern file. The characters are not copied.
+ */
+struct Pattern {
+    const CharType* text;
+    size_t length;
+};
+
+/**
+ * Splits the pattern file into its lines, empty lines are skipped. A line break may be \n or \r\n.
+ */
+inline static std::vector<Pattern> readPatterns(const Helpers::TextView& input) noexcept {
+    std::vector<Pattern> patterns;
+    //The last character of the view is the sentinel.
+    const size_t end = input.length - 1;
+    size_t begin = 0;
+    while (begin < end) {
+        size_t lineEnd = begin;
+        while (lineEnd < end && input.text[lineEnd] != '\n') lineEnd++;
+        size_t length = lineEnd - begin;
+        if (length > 0 && input.text[begin + length - 1] == '\r') length--;
+        if (length > 0) patterns.emplace_back(input.text + begin, length);
+        begin = lineEnd + 1;
+    }
+    return patterns;
+}
+
+/**
+ * Answers a batch of count or locate queries on the suffix tree of the text and prints one RESULT line per pattern with its latency
+ * and a summary. The patterns are answered with --query-threads=N threads against the shared tree.
+ * For locate, --limit=N enumerates at most the first N occurrences of every pattern (the count is always complete).
+ */
+template<typename CHILDREN, typename INDEX>
+inline static void answerPatternQueries(const Helpers::CommandLine& options, const std::string& queryChoice, const std::string& inputFileName, const Helpers::TextView& inputText, const std::vector<Pattern>& patterns) {
+    using Index = INDEX;
+    const bool locate = (queryChoice == "locate");
+    const size_t limit = options.getNumber("limit", std::numeric_limits<size_t>::max());
+
+    Helpers::Timer preprocessingTimer;
+    //The query descends along the edges of the tree, which the frozen tree does not have.
+    SuffixTree::SuffixTree<CharType, Debug, CHILDREN, INDEX> stree = buildSuffixTree<CHILDREN, INDEX>(options, inputText.text, inputText.length);
+    Query::PatternQuery<CharType, Debug, CHILDREN, INDEX> query(&stree);
+    const size_t preprocessingTime = preprocessingTimer.getMilliseconds();
+
+    std::vector<Index> counts(patterns.size());
+    std::vector<std::vector<Index>> positions(locate ? patterns.size() : 0);
+    std::vector<size_t> latencies(patterns.size());
+    Helpers::ThreadPool pool(options.getNumber("query-threads", 1));
+    Helpers::Timer queryTimer;
+    pool.parallelFor(patterns.size(), [&](size_t i, size_t) {
+        Helpers::Timer latencyTimer;
+        if (locate) {
+            auto occurrences = query.locate(patterns[i].text, patterns[i].length);
+            counts[i] = occurrences.size();
+            Index position;
+            while (positions[i].size() < limit && occurrences.next(position)) positions[i].emplace_back(position);
+        } else {
+            counts[i] = query.count(patterns[i].text, patterns[i].length);
+        }
+        latencies[i] = latencyTimer.getNanoseconds();
+    });
+    const size_t queryTime = queryTimer.getMilliseconds();
+
+    for (size_t i = 0; i < patterns.size(); i++) {
+        std::cout << "RESULT algo=" << queryChoice
+                  << " pattern=" << i
+                  << " length=" << patterns[i].length
+                  << " count=" << counts[i];
+        if (locate) {
+            std::cout << " positions=";
+            for (size_t j = 0; j < positions[i].size(); j++) {
+                if (j > 0) std::cout << ",";
+                std::cout << positions[i][j];
+            }
+        }
+        std::cout << " latency=" << latencies[i] << "ns" << std::endl;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    std::cout << "RESULT algo=" << queryChoice << " name=moritz-potthoff"
+              << " construction time=" << preprocessingTime
+              << " query time=" << queryTime
+              << " patterns=" << patterns.size();
+    if (!latencies.empty()) {
+        std::cout << " medianLatency=" << latencies[latencies.size() / 2] << "ns"
+                  << " p99Latency=" << latencies[latencies.size() * 99 / 100] << "ns"
+                  << " maxLatency=" << latencies.back() << "ns";
+    }
+    std::cout << Helpers::MemoryAccounting::resultFields()
+              << " file=" << inputFileName << std::endl;
+}
+
+/**
+ * Counts or locates the patterns of --patterns=file (one per line) in the text file, see Query/PatternQuery.h.
+ * The whole text file is the text, as for serve.
+ */
+inline static void handlePatternQuery(const Helpers::CommandLine& options, char *argv[]) {
+    const std::string queryChoice(argv[1]);
+    const std::string inputFileName(argv[2]);
+    const std::string patternFileName = options.get("patterns", "");
+    if (patternFileName.empty()) {
+        std::cout << "Expecting the patterns with --patterns=path_to_pattern_file." << std::endl;
+        return;
+    }
+    Helpers::MappedFile inputFile(inputFileName);
+    if (!inputFile.isOpen()) {
+        std::cout << "Could not open input file " << inputFileName << "." << std::endl;
+        return;
+    }
+    Helpers::MappedFile patternFile(patternFileName);
+    if (!patternFile.isOpen()) {
+        std::cout << "Could not open pattern file " << patternFileName << "." << std::endl;
+        return;
+    }
+    const std::vector<Pattern> patterns = readPatterns(patternFile.view());
+    const Helpers::TextView inputText = inputFile.view();
+    withIndexType(inputText.length, [&](auto index) {
+        using Index = typename decltype(index)::type;
+        withChildContainer<Index>(inputText.text, inputText.length, [&](auto children) {
+            answerPatternQueries<typename decltype(children)::type, Index>(options, queryChoice, inputFileName, inputText, patterns);
+        });
+    });
+}
+
+/**
+ * Reads the documents listed in the given file (one path per line) and concatenates them, each one followed by the separator and
+ * the last one by the sentinel. documentStarts is set to the start of every document in the text.
+ * Returns false if a file cannot be read or contains the separator or the sentinel.
+ */
+inline static bool readDocuments(const std::string& listFileName, std::string& text, std::vector<size_t>& documentStarts) {
+    std::ifstream listFile(listFileName);
+    if (!listFile.is_open()) {
+        std::cout << "Could not open document list " << listFileName << "." << std::endl;
+        return false;
+    }
+    std::string documentFileName;
+    while (std::getline(listFile, documentFileName)) {
+        if (!documentFileName.empty() && documentFileName.back() == '\r') documentFileName.pop_back();
+        if (documentFileName.empty()) continue;
+        std::ifstream documentFile(documentFileName, std::ios::binary);
+        if (!documentFile.is_open()) {
+            std::cout << "Could not open document " << documentFileName << "." << std::endl;
+            return false;
+        }
+        if (!documentStarts.empty()) text.push_back(Separator);
+        documentStarts.emplace_back(text.length());
+        std::stringstream documentBuffer;
+        documentBuffer << documentFile.rdbuf();
+        const std::string document = documentBuffer.str();
+        if (document.find(Separator) != std::string::npos || document.find(Sentinel) != std::string::npos) {
+            std::cout << "The document " << documentFileName << " contains the separator or the sentinel." << std::endl;
+            return false;
+        }
+        text += document;
+    }
+    if (documentStarts.empty()) {
+        std::cout << "The document list " << listFileName << " is empty." << std::endl;
+        return false;
     }
+    text.push_back(Sentinel);
+    return true;
 }
 
-inline static void repeatQueryExperiment(char *argv[]) {
-    std::cout << "Requested repeatQuery experiment." << std::endl;
+/**
+ * Answers the topk queries on the generalized suffix tree of the documents: the k-th most frequent substring of length l by the number
+ * of documents that contain it (see Query/DocumentCounts.h). Counting the documents of all nodes is part of the construction.
+ */
+template<typename CHILDREN, typename INDEX>
+inline static void runDocumentTopKQueries(const Helpers::CommandLine& options, const std::string& listFileName, const Helpers::TextView& inputText, const std::vector<size_t>& documentStarts, const std::vector<TopKQuery>& queries) {
+    using Children = CHILDREN;
+    using Index = INDEX;
+    withSuffixTree<Children, Index>(options, inputText, [&](auto& stree, const size_t preprocessingTime) {
+        using Tree = std::remove_reference_t<decltype(stree)>;
+        Helpers::Timer queryInitTimer;
+        //The counts are indexed by the nodes of the tree that the queries run on, the frozen tree by default.
+        if constexpr (!Tree::IsAnnotated) stree.annotate();
+        const Query::DocumentCounts<Tree> documents(stree, std::vector<Index>(documentStarts.begin(), documentStarts.end()));
+        Query::TopKQuery<CharType, Sentinel, Query::TopKTraceProfiler, Debug, Children, Index, Tree> query(&stree, &documents);
+        const size_t queryInitTime = queryInitTimer.getMilliseconds();
+
+        size_t totalQueryTime = 0;
+        std::vector<size_t> latencies;
+        const auto startIndices = answerTopKQueries(options, query, queries, totalQueryTime, latencies);
+        std::stringstream queryResults;
+        for (size_t i = 0; i < queries.size(); i++) {
+            //There may be fewer than k substrings of length l in the documents, the solution is empty then.
+            if (startIndices[i] != decltype(query)::NoSolution) queryResults << stree.substring(startIndices[i], queries[i].l);
+            if (i < queries.size() - 1) queryResults << ";";
+        }
+        std::cout << "RESULT algo=doctopk name=moritz-potthoff"
+                  << " documents=" << documents.numberOfDocuments()
+                  << " construction time=" << (preprocessingTime + queryInitTime)
+                  << " query time=" << totalQueryTime
+                  << " solutions=" << queryResults.str()
+                  << Helpers::MemoryAccounting::resultFields()
+                  << " file=" << listFileName << std::endl;
+        printTopKLatencies(options, queries, latencies);
+    });
+}
+
+/**
+ * Builds the generalized suffix tree of the documents listed in the given file (one path per line) and answers the topk queries
+ * of --queries=path_to_topk_input_file by document frequency. The text of the topk input file is ignored.
+ */
+inline static void handleDocumentTopKQuery(const Helpers::CommandLine& options, char *argv[]) {
+    const std::string listFileName(argv[2]);
+    const std::string queryFileName = options.get("queries", "");
+    Helpers::MappedFile queryFile(queryFileName);
+    if (!queryFile.isOpen()) {
+        std::cout << "Could not open query file '" << queryFileName << "', use --queries=path." << std::endl;
+        return;
+    }
+    size_t position = 0;
+    const std::vector<TopKQuery> queries = readTopKQueries(queryFile.view(), position);
+
+    std::string text;
+    std::vector<size_t> documentStarts;
+    if (!readDocuments(listFileName, text, documentStarts)) return;
+    const Helpers::TextView inputText{text.c_str(), text.length()};
+    withIndexType(inputText.length, [&](auto index) {
+        using Index = typename decltype(index)::type;
+        withChildContainer<Index>(inputText.text, inputText.length, [&](auto children) {
+            runDocumentTopKQueries<typename decltype(children)::type, Index>(options, listFileName, inputText, documentStarts, queries);
+        });
+    });
+}
+
+/**
+ * Appends the text of a topk input file in chunks of --chunk-size=N characters (default: 1/16 of the text) to an online suffix tree
+ * and answers the queries of the file after every chunk, compared to rebuilding the suffix tree for the prefix.
+ * Reports the amortized append time per character and checks that both trees give the same results.
+ * Queries with more candidates than the prefix has are skipped.
+ */
+inline static void onlineAppendExperiment(const Helpers::CommandLine& options, char *argv[]) {
+    std::cout << "Requested online append experiment." << std::endl;
 
     std::string inputFileName(argv[2]);
-    std::ifstream inputFile(inputFileName);
+    Helpers::MappedFile inputFile(inputFileName);
+    if (!inputFile.isOpen()) {
+        std::cout << "Could not open input file " << inputFileName << "." << std::endl;
+        return;
+    }
+    const Helpers::TextView input = inputFile.view();
+    size_t position = 0;
+    const std::vector<TopKQuery> queries = readTopKQueries(input, position);
+    const Helpers::TextView inputText = input.suffix(std::min(position + 2, input.length - 1));
+    if (!isSmallText(inputText.length)) {
+        std::cout << "The online append experiment only supports texts below 2 GiB." << std::endl;
+        return;
+    }
+    //The text without its sentinel is appended, the online tree adds the sentinel itself.
+    const size_t textLength = inputText.length - 1;
+    const size_t chunkSize = std::max<size_t>(1, options.getNumber("chunk-size", (textLength + 15) / 16));
 
-    //Read the input text.
-    std::string inputText;
-    readRemainingFileContents(inputFile, inputText);
-    std::cout << "Original input has length " << inputText.length() << std::endl;
+    using OnlineTree = SuffixTree::OnlineSuffixTree<CharType, Sentinel, Debug>;
+    OnlineTree online;
+    Query::TopKQuery<CharType, Sentinel, Query::TopKNoProfiler, Debug, SuffixTree::AdaptiveChildren<CharType>, int, OnlineTree> onlineQuery(&online);
+    decltype(onlineQuery)::CandidateBuffer candidates;
+    size_t totalAppendTime = 0;
+    for (size_t begin = 0; begin < textLength; begin += chunkSize) {
+        const size_t length = std::min(chunkSize, textLength - begin);
+        Helpers::Timer appendTimer;
+        online.append(inputText.text + begin, length);
+        const size_t appendTime = appendTimer.getMicroseconds();
+        totalAppendTime += appendTime;
+        Helpers::Timer sealTimer;
+        online.seal();
+        const size_t sealTime = sealTimer.getMicroseconds();
 
-    for (int inputLength : queryInputTextLengths) {
-        std::string prefix = getPrefix(inputText, inputLength);
+        //The rebuild for comparison, on a copy of the prefix with the sentinel.
+        std::string prefix(inputText.text, begin + length);
+        prefix.push_back(Sentinel);
+        Helpers::Timer rebuildTimer;
         SuffixTree::SuffixTree<CharType, Debug> stree(prefix.c_str(), prefix.length());
+        Query::TopKQuery<CharType, Sentinel, Query::TopKNoProfiler, Debug> query(&stree);
+        const size_t rebuildTime = rebuildTimer.getMicroseconds();
 
-        //Run the queries.
-        size_t startPosition, length;
-        Helpers::Timer queryTimer;
-        queryTimer.restart();
-        Query::RepeatQuery<CharType, Sentinel, Query::RepeatNoProfiler, Debug> query(&stree);
-        std::tie(startPosition, length) = query.runQuery();
-        size_t queryTime = queryTimer.getMilliseconds();
-
-        std::cout << "RESULT algo=repeatQueryExperiment"
-                  << " queryTime=" << queryTime
+        size_t onlineQueryTime = 0;
+        size_t rebuildQueryTime = 0;
+        size_t answeredQueries = 0;
+        bool identical = true;
+        for (const TopKQuery& topKQuery : queries) {
+            candidates.clear();
+            onlineQuery.collectingBfs(candidates, topKQuery.l);
+            if (topKQuery.k > candidates.size()) continue;
+            answeredQueries++;
+            Helpers::Timer queryTimer;
+            const int onlineResult = onlineQuery.runQuery(topKQuery.l, topKQuery.k, candidates);
+            onlineQueryTime += queryTimer.getMicroseconds();
+            queryTimer.restart();
+            const int rebuildResult = query.runQuery(topKQuery.l, topKQuery.k, candidates);
+            rebuildQueryTime += queryTimer.getMicroseconds();
+            identical &= (onlineResult == rebuildResult);
+        }
+        std::cout << "RESULT algo=onlineAppendExperiment"
+                  << " prefixLength=" << online.length()
+                  << " chunkSize=" << length
+                  << " appendTime=" << appendTime << "us"
+                  << " amortizedAppendTime=" << totalAppendTime * 1000.0 / online.length() << "ns/char"
+                  << " sealTime=" << sealTime << "us"
+                  << " rebuildTime=" << rebuildTime << "us"
+                  << " queries=" << answeredQueries
+                  << " onlineQueryTime=" << onlineQueryTime << "us"
+                  << " rebuildQueryTime=" << rebuildQueryTime << "us"
+                  << " identical=" << (identical ? "yes" : "no")
                   << " inputType=" << argv[3]
-                  << " inputLength=" << prefix.length()
                   << " file=" << inputFileName << std::endl;
     }
 }
@@ -267,21 +1194,70 @@ int main(int argc, char *argv[]) {
         return 1;
     }
 
+    //Optional arguments, e.g., --backend=sa to answer the queries with the suffix array instead of the suffix tree
+    //or --construction=parallel --threads=4 to build the suffix tree with 4 threads.
+    Helpers::CommandLine options(argc, argv);
+    const std::string backend = options.get("backend", "tree");
+    if (backend != "tree" && backend != "sa" && backend != "cst") {
+        std::cout << "Unknown backend, expecting tree, sa or cst." << std::endl;
+        return 1;
+    }
+    const std::string construction = options.get("construction", "ukkonen");
+    if (construction != "ukkonen" && construction != "parallel") {
+        std::cout << "Unknown construction, expecting ukkonen or parallel." << std::endl;
+        return 1;
+    }
+    const std::string repeatEngine = options.get("repeat", "smallerhalf");
+    if (repeatEngine != "smallerhalf" && repeatEngine != "merge" && repeatEngine != "lz") {
+        std::cout << "Unknown repeat engine, expecting smallerhalf, merge or lz." << std::endl;
+        return 1;
+    }
+    const std::string layout = options.get("layout", "frozen");
+    if (layout != "frozen" && layout != "pointer") {
+        std::cout << "Unknown layout, expecting frozen or pointer." << std::endl;
+        return 1;
+    }
+
+    //The phases per inner node of the repeat queries are sampled, see Query::RepeatTraceProfiler.
+    Query::RepeatTraceProfiler::setNodeSampleRate(options.getNumber("trace-sample-rate", Query::RepeatTraceProfiler::DefaultNodeSampleRate));
+
     std::string queryChoice(argv[1]);
     if (queryChoice.compare("topk") == 0) {
-        handleTopKQuery(argv);
+        handleTopKQuery(options, argv);
     } else if (queryChoice.compare("repeat") == 0) {
-        handleRepeatQuery(argv);
-    } else if (queryChoice.compare("preprocessingExperiment") == 0) {
-        preprocessingExperiment(argv);
-    } else if (queryChoice.compare("topKQueryExperiment") == 0) {
-        topKQueryExperiment(argv);
-    } else  if (queryChoice.compare("repeatQueryExperiment") == 0) {
-        repeatQueryExperiment(argv);
+        handleRepeatQuery(options, argv);
+    } else if (queryChoice.compare("preprocessingExperiment") == 0 || queryChoice.compare("topKQueryExperiment") == 0 || queryChoice.compare("repeatQueryExperiment") == 0) {
+        std::cout << "The experiment moved to the benchmark suite: ./build/Benchmark [preprocessing|topk|repeat] path_to_input_file input_type" << std::endl;
+        return 1;
+    } else if (queryChoice.compare("childContainerExperiment") == 0) {
+        std::cout << "The experiment moved to the benchmark suite: ./build/Benchmark children path_to_input_file input_type" << std::endl;
+        return 1;
+    } else if (queryChoice.compare("build-index") == 0) {
+        handleBuildIndex(options, argv);
+    } else if (queryChoice.compare("query-index") == 0) {
+        handleQueryIndex(options, argv);
+    } else if (queryChoice.compare("parallelConstructionExperiment") == 0) {
+        std::cout << "The experiment moved to the benchmark suite: ./build/Benchmark parallel-construction path_to_input_file input_type" << std::endl;
+        return 1;
+    } else if (queryChoice.compare("parallelRepeatExperiment") == 0) {
+        std::cout << "The experiment moved to the benchmark suite: ./build/Benchmark parallel-repeat path_to_input_file input_type" << std::endl;
+        return 1;
+    } else  if (queryChoice.compare("topKThroughputExperiment") == 0) {
+        topKThroughputExperiment(options, argv);
+    } else if (queryChoice.compare("serve") == 0) {
+        handleServe(options, argv);
+    } else if (queryChoice.compare("count") == 0 || queryChoice.compare("locate") == 0) {
+        handlePatternQuery(options, argv);
+    } else if (queryChoice.compare("doctopk") == 0) {
+        handleDocumentTopKQuery(options, argv);
+    } else  if (queryChoice.compare("onlineAppendExperiment") == 0) {
+        onlineAppendExperiment(options, argv);
     } else {
         std::cout << "Unknown query choice." << std::endl;
         return 1;
     }
+    //The server reports the traces after every connection.
+    if (queryChoice.compare("serve") != 0) reportTraces(options, std::cout);
 
     return 0;
 }